@@ -0,0 +1,65 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+#include <SupabaseAsync.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+// Up to 8 requests in flight, run one by one on a background task
+SupabaseAsync async(db, 8);
+SupabaseAsyncRequest *pendingSelect = nullptr;
+
+// Runs on the worker task: keep it short
+void onInserted(int httpCode, const String &response, void *ctx) {
+  Serial.printf("insert -> %d\n", httpCode);
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  Serial.print("Connecting to WiFi");
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  // Beginning Supabase Connection
+  db.begin(supabase_url, anon_key);
+
+  // Worker task with 8 KB stack, priority 1, on core 0 (the control loop runs on core 1)
+  async.begin(8192, 1, 0);
+}
+
+void loop() {
+  unsigned long start = millis();
+
+  char row[64];
+  snprintf(row, sizeof(row), "{\"sensor\":1,\"value\":%d}", analogRead(A0));
+  // Returns immediately; nullptr when all 8 slots are busy
+  if (!async.insert("readings", row, false, onInserted)) {
+    Serial.println("queue full, reading dropped");
+  }
+
+  // Polled request: submit once, check on later iterations
+  if (pendingSelect == nullptr) {
+    pendingSelect = async.select("settings?select=*&limit=1");
+  } else if (pendingSelect->done()) {
+    Serial.printf("settings -> %d %s\n", pendingSelect->httpCode(), pendingSelect->response().c_str());
+    async.release(pendingSelect);
+    pendingSelect = nullptr;
+  }
+
+  // The control loop keeps its 100 ms period however slow the network is
+  delay(100 - (millis() - start) % 100);
+}
@@ -0,0 +1,50 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+#include <SupabaseInsertBatcher.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+// Rows are sent as one bulk insert when 4 KB or 50 rows are buffered,
+// or at the latest 2 s after the first buffered row
+SupabaseInsertBatcher readings(db, "readings", 4096, 50, 2000);
+
+void onBatch(const String &table, uint32_t firstRow, size_t rowCount, int httpCode, void *ctx) {
+  Serial.printf("%s rows %u..%u -> %d\n", table.c_str(), firstRow, firstRow + rowCount - 1, httpCode);
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  Serial.print("Connecting to WiFi");
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  // Beginning Supabase Connection
+  db.begin(supabase_url, anon_key);
+
+  readings.onFlush(onBatch);
+}
+
+void loop() {
+  char row[64];
+  snprintf(row, sizeof(row), "{\"sensor\":1,\"value\":%d}", analogRead(A0));
+  readings.add(row, strlen(row));
+
+  // Sends the batch once its deadline passed
+  readings.loop();
+  delay(100);
+}
@@ -0,0 +1,61 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+// Flash the same sketch on several boards: each one hears the others
+int peers = -1;
+unsigned long lastSent = 0;
+
+void onPeer(const SupabaseChangeEvent &event, void *ctx) {
+  if (event.type == SUPABASE_CHANGE_BROADCAST) {
+    Serial.printf("%s from %s: %d\n", event.event, event.record["from"].as<const char *>(),
+                  event.record["value"].as<int>());
+  }
+}
+
+void onAck(int subscription, int message, bool ok, void *ctx) {
+  if (!ok) {
+    Serial.printf("message %d not confirmed\n", message);
+  }
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  Serial.print("Connecting to WiFi");
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  db.begin(supabase_url, anon_key);
+  db.beginRealtime(443);
+  // Every board joining "peers" gets the messages of the others, no table involved
+  peers = db.subscribeBroadcast("peers", onPeer, nullptr, onAck);
+}
+
+void loop() {
+  // Sends what broadcast() queued, delivers what the peers sent
+  db.realtimeLoop();
+
+  if (millis() - lastSent > 1000) {
+    lastSent = millis();
+    String json = "{\"from\":\"" + WiFi.macAddress() + "\",\"value\":" + String(analogRead(A0)) + "}";
+    if (db.broadcast(peers, "reading", json) == SUPABASE_ERR_QUEUE_FULL) {
+      Serial.println("queue full");
+    }
+  }
+}
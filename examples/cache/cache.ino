@@ -0,0 +1,53 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+#include <SupabaseCache.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+// Up to 16 responses in 8 KB, fresh for one minute
+SupabaseCache cache(8192, 16, 60000);
+
+void setup() {
+  Serial.begin(9600);
+
+  Serial.print("Connecting to WiFi");
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  // Beginning Supabase Connection
+  db.begin(supabase_url, anon_key);
+  db.setCache(&cache);
+
+  // Changes of "config" drop its cached queries right away
+  db.beginRealtime(443);
+  db.subscribe("config", "", nullptr);
+}
+
+void loop() {
+  db.realtimeLoop();
+
+  unsigned long t0 = micros();
+  // Same query every time: only the first one (and one per minute after
+  // that, answered with 304 when unchanged) goes to the server
+  String config = db.from("config").select("*").eq("device", "1").doSelect();
+  Serial.printf("config in %lu us: %s\n", micros() - t0, config.c_str());
+
+  // Rarely changing lookup table: keep it for ten minutes
+  String units = db.cacheFor(600000).from("units").select("*").doSelect();
+
+  delay(1000);
+}
@@ -0,0 +1,51 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+#include <SupabaseWriteCoalescer.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+// At most one PATCH per device row every 2 seconds, however often the
+// sensors are read
+SupabaseWriteCoalescer devices(db, "devices", 2000);
+
+void flushed(const char *filter, int httpCode, void *ctx) {
+  Serial.printf("%s -> %d\n", filter, httpCode);
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  Serial.print("Connecting to WiFi");
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  db.begin(supabase_url, anon_key);
+
+  devices.onFlush(flushed);
+  // A jump of half a degree is written right away
+  devices.setThreshold("temp", 0.5);
+}
+
+void loop() {
+  char json[64];
+  snprintf(json, sizeof(json), "{\"temp\":%.1f,\"fan\":%d}",
+           analogRead(A0) / 100.0, digitalRead(4));
+  devices.set("id=eq.1", json, strlen(json));
+
+  devices.loop();
+  delay(50);
+}
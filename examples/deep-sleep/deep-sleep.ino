@@ -0,0 +1,82 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+const unsigned long sleepMs = 5 * 60 * 1000UL;
+
+#if defined(ESP8266)
+// The RTC user memory is too small for it: kept in a file instead
+SupabaseWarmStart warm;
+
+void loadWarmStart() {
+  LittleFS.begin();
+  File f = LittleFS.open("/warm.bin", "r");
+  if (f) {
+    f.read((uint8_t *)&warm, sizeof(warm));
+    f.close();
+  }
+}
+
+void storeWarmStart() {
+  File f = LittleFS.open("/warm.bin", "w");
+  if (f) {
+    f.write((const uint8_t *)&warm, sizeof(warm));
+    f.close();
+  }
+}
+#else
+// Survives deep sleep, lost on power-off (then it is simply not valid)
+RTC_DATA_ATTR SupabaseWarmStart warm;
+#endif
+
+void goToSleep() {
+  db.saveWarmStart();
+#if defined(ESP8266)
+  storeWarmStart();
+  ESP.deepSleep(sleepMs * 1000ULL);
+#else
+  esp_deep_sleep(sleepMs * 1000ULL);
+#endif
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(10);
+  }
+
+#if defined(ESP8266)
+  loadWarmStart();
+  // The ESP8266 clock stops while asleep: tell it how long it was
+  db.setWarmStart(&warm, sleepMs);
+#else
+  db.setWarmStart(&warm);
+#endif
+  db.begin(supabase_url, anon_key);
+
+  // Sends the password only when there is no saved session of this user
+  db.login_email("email", "password");
+
+  int httpCode = db.insert("readings", "{\"device\":1,\"value\":" + String(analogRead(A0)) + "}", false);
+  // Time since wake-up: what the battery pays for
+  Serial.printf("insert -> %d after %lu ms\n", httpCode, millis());
+
+  goToSleep();
+}
+
+void loop() {
+}
@@ -0,0 +1,493 @@
+/**
+ * Host-native benchmarks of library code paths.
+ *
+ *   pio run -e native-bench && .pio/build/native-bench/program [prefix]
+ *
+ * With `prefix` only the benchmarks whose name starts with it run.
+ *
+ * One JSON object per line on stdout: name, ops, ops_per_s, us_per_op,
+ * p50_us and p99_us (latency of single ops), allocs_per_op (heap
+ * allocations counted by the host shim) and tx/rx_bytes_per_op
+ * (request/response bodies as sent over the transport). Inputs are
+ * generated deterministically, the stand-in server adds no latency
+ * (except for `parallel/`, which needs some to overlap) and every
+ * benchmark runs a warm-up pass first, so runs of two library versions
+ * can be compared line by line by name.
+ */
+
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+#include <SupabasePaginator.h>
+#include <SupabaseTable.h>
+#include <SupabaseWriteCoalescer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static Supabase db;
+static SupabaseLocalSocket realtimeSocket;
+static const char *only = "";
+static std::vector<unsigned long> samples;
+
+template <typename Fn>
+static void bench(const char *name, unsigned long ops, Fn fn)
+{
+  typedef std::chrono::steady_clock Clock;
+  if (strncmp(name, only, strlen(only)) != 0)
+  {
+    return;
+  }
+
+  // First-use allocations and connection setup stay out of the numbers
+  unsigned long warmup = ops / 10 ? ops / 10 : 1;
+  for (unsigned long i = 0; i < warmup; i++)
+  {
+    fn(i);
+  }
+  samples.assign(ops, 0);
+
+  unsigned long allocs0 = hostAllocations();
+  SupabaseConnectionStats conn0 = db.getConnectionStats();
+  Clock::time_point t0 = Clock::now();
+  for (unsigned long i = 0; i < ops; i++)
+  {
+    Clock::time_point start = Clock::now();
+    fn(i);
+    samples[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+  }
+  double us = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count() / 1e3;
+  unsigned long allocs = hostAllocations() - allocs0;
+  const SupabaseConnectionStats &conn = db.getConnectionStats();
+
+  std::sort(samples.begin(), samples.end());
+  double p50 = samples[ops / 2] / 1e3;
+  double p99 = samples[std::min(ops - 1, ops * 99 / 100)] / 1e3;
+
+  Serial.printf("{\"name\":\"%s\",\"ops\":%lu,\"ops_per_s\":%.0f,\"us_per_op\":%.3f,\"p50_us\":%.3f,\"p99_us\":%.3f,"
+                "\"allocs_per_op\":%.2f,\"tx_bytes_per_op\":%.0f,\"rx_bytes_per_op\":%.0f}\n",
+                name, ops, us > 0 ? ops * 1e6 / us : 0.0, us / ops, p50, p99, (double)allocs / ops,
+                (double)(conn.bytesSent - conn0.bytesSent) / ops, (double)(conn.bytesReceived - conn0.bytesReceived) / ops);
+}
+
+/** Row of `fields` columns, about 25 bytes per column: ids, timestamps,
+ * numbers and short text, as in typical sensor and config tables */
+static String makeRow(int fields, long id)
+{
+  char column[96];
+  String row = "{\"id\":" + String(id);
+  for (int f = 1; f < fields; f++)
+  {
+    switch (f % 4)
+    {
+    case 0:
+      snprintf(column, sizeof(column), ",\"c%d\":%ld", f, (id * 31 + f) % 100000);
+      break;
+    case 1:
+      snprintf(column, sizeof(column), ",\"c%d\":\"2024-05-%02ldT12:%02d:00\"", f, 1 + id % 28, f % 60);
+      break;
+    case 2:
+      snprintf(column, sizeof(column), ",\"c%d\":%ld.%02d", f, id % 50, f);
+      break;
+    default:
+      snprintf(column, sizeof(column), ",\"c%d\":\"device-%03ld\"", f, id % 500);
+      break;
+    }
+    row += column;
+  }
+  row += "}";
+  return row;
+}
+
+static void benchQueryBuilder()
+{
+  const unsigned long ops = 100000;
+
+  bench("query_builder/string", ops, [](unsigned long i)
+        {
+    db.from("sensors").select("id,ts,value").eq("device", "42").gt("ts", "2024-01-01").order("ts", "desc", true).limit(10);
+    String url = db.getQuery(); });
+
+  bench("query_builder/fixed_buffer", ops, [](unsigned long i)
+        {
+    SupabaseQueryBuffer<160> q;
+    q.from("sensors").select("id,ts,value").eq("device", 42L).gt("ts", "2024-01-01").order("ts", "desc", true).limit(10); });
+
+  bench("query_builder/fixed_buffer_flash", ops, [](unsigned long i)
+        {
+    SupabaseQueryBuffer<160> q;
+    q.from(F("sensors")).select(F("id,ts,value")).eq(F("device"), 42L).gt(F("ts"), F("2024-01-01")).order(F("ts"), F("desc"), true).limit(10); });
+
+  // Same query, compiled once: each op binds the values and rebuilds the URL
+  SupabaseQueryBuffer<160> q;
+  q.from("sensors").select("id,ts,value").eq("device", SUPABASE_PARAM).gt("ts", SUPABASE_PARAM).order("ts", "desc", true).limit(10);
+  static SupabasePrepared prepared(q);
+  static const String prefix = "http://127.0.0.1/rest/v1/";
+  bench("query_builder/prepared", ops, [](unsigned long i)
+        {
+    prepared.bind(0, (long)(i % 100)).bind(1, "2024-01-01T00:00:00+00:00");
+    prepared.url(prefix); });
+}
+
+static bool countRow(JsonObjectConst row, void *ctx)
+{
+  (*(unsigned long *)ctx)++;
+  return true;
+}
+
+struct ReadingRows
+{
+  int next;
+  int rows;
+  bool csv;
+};
+
+// The rows of `insert_batch/`, written while the body is sent: as many
+// whole rows as fit into each chunk
+static size_t produceReadings(uint8_t *buffer, size_t size, void *ctx)
+{
+  ReadingRows *src = (ReadingRows *)ctx;
+  size_t n = 0;
+  if (src->next == 0)
+  {
+    n = src->csv ? snprintf((char *)buffer, size, "device,ts,value\n") : snprintf((char *)buffer, size, "[");
+  }
+  while (src->next < src->rows)
+  {
+    int i = src->next;
+    int length = src->csv ? snprintf((char *)buffer + n, size - n, "sensor-%02d,2024-05-01T12:%02d:%02d,%d.%d\n",
+                                     i % 8, i / 60, i % 60, 20 + i % 7, i % 10)
+                          : snprintf((char *)buffer + n, size - n,
+                                     "%s{\"device\":\"sensor-%02d\",\"ts\":\"2024-05-01T12:%02d:%02d\",\"value\":%d.%d}%s",
+                                     i ? "," : "", i % 8, i / 60, i % 60, 20 + i % 7, i % 10,
+                                     i == src->rows - 1 ? "]" : "");
+    if ((size_t)length >= size - n)
+    {
+      break;
+    }
+    n += length;
+    src->next++;
+  }
+  return n;
+}
+
+// Bytes on air and decode cost per row of a select, plain and gzipped.
+// us_per_op / rows is the decode cost of one row
+static void benchCompression()
+{
+  const unsigned long ops = 200;
+  const int rows = 200;
+  char row[128];
+  String batch = "[";
+  for (int i = 0; i < rows; i++)
+  {
+    snprintf(row, sizeof(row), "%s{\"device\":\"sensor-%02d\",\"ts\":\"2024-05-01T12:%02d:%02d\",\"value\":%d.%d}",
+             i ? "," : "", i % 8, i / 60, i % 60, 20 + i % 7, i % 10);
+    batch += row;
+  }
+  batch += "]";
+
+  db.setCompression(false);
+  bench("insert_batch/identity", 1, [&](unsigned long i)
+        { db.insert("readings", batch, false); });
+  db.setCompression(false, 1);
+  bench("insert_batch/gzip", 1, [&](unsigned long i)
+        { db.insert("readings", batch, false); });
+  // Same rows without the body in memory: chunked, as JSON and as CSV
+  db.setCompression(false);
+  bench("insert_batch/stream_json", 1, [&](unsigned long i)
+        {
+    ReadingRows src = {0, rows, false};
+    db.insertStream("readings", produceReadings, &src); });
+  bench("insert_batch/stream_csv", 1, [&](unsigned long i)
+        {
+    ReadingRows src = {0, rows, true};
+    db.insertStream("readings", produceReadings, &src, SUPABASE_BODY_CSV); });
+
+  unsigned long seen = 0;
+  db.setCompression(false);
+  bench("select_stream_200_rows/identity", ops, [&](unsigned long i)
+        { db.from("readings").select("*").limit(rows).doSelectStream(countRow, &seen); });
+  db.setCompression(true);
+  bench("select_stream_200_rows/gzip", ops, [&](unsigned long i)
+        { db.from("readings").select("*").limit(rows).doSelectStream(countRow, &seen); });
+  bench("select_string_200_rows/gzip", ops, [&](unsigned long i)
+        { String json = db.from("readings").select("*").limit(rows).doSelect(); });
+  db.setCompression(false);
+}
+
+// deserializeJson / serializeJson of single rows, as done for every
+// streamed row, realtime record and insert body
+static void benchJson()
+{
+  const unsigned long ops = 50000;
+  static const struct
+  {
+    const char *decode;
+    const char *decodeFiltered;
+    const char *encode;
+    int fields;
+  } sizes[] = {
+      {"json/decode/row_4", "json/decode_filtered/row_4", "json/encode/row_4", 4},
+      {"json/decode/row_12", "json/decode_filtered/row_12", "json/encode/row_12", 12},
+      {"json/decode/row_40", "json/decode_filtered/row_40", "json/encode/row_40", 40},
+  };
+
+  for (const auto &size : sizes)
+  {
+    String text = makeRow(size.fields, 4711);
+    JsonDocument doc;
+    bench(size.decode, ops, [&](unsigned long i)
+          { deserializeJson(doc, text); });
+
+    // Only two columns kept, like `subscribe(..., columns)` does
+    JsonDocument filter;
+    filter["id"] = true;
+    filter["c2"] = true;
+    bench(size.decodeFiltered, ops, [&](unsigned long i)
+          { deserializeJson(doc, text, DeserializationOption::Filter(filter)); });
+
+    deserializeJson(doc, text);
+    char out[2048];
+    bench(size.encode, ops, [&](unsigned long i)
+          { serializeJson(doc, out, sizeof(out)); });
+  }
+}
+
+static unsigned long changesSeen = 0;
+
+static void onChange(const SupabaseChangeEvent &event, void *ctx)
+{
+  changesSeen++;
+}
+
+// Frames pushed by the stand-in and routed to a subscription handler by
+// `realtimeLoop()`: parse with the column filter, topic lookup, dispatch
+static void benchRealtime()
+{
+  const unsigned long ops = 20000;
+  // Skipped with its setup when filtered out
+  if (strncmp("realtime/", only, strlen(only)) != 0 && strncmp(only, "realtime/", 9) != 0)
+  {
+    return;
+  }
+
+  db.setSocketTransport(&realtimeSocket);
+  db.setHeartbeat(0);
+  // First subscription of `db`, so its topic is "realtime:sub1"
+  db.subscribe("readings", "", onChange, nullptr, "*", "public", "id,c2");
+  db.beginRealtime(443);
+  for (int i = 0; i < 4; i++)
+  {
+    db.realtimeLoop();
+  }
+
+  String record = makeRow(12, 99);
+  String frame = "{\"event\":\"postgres_changes\",\"topic\":\"realtime:sub1\",\"payload\":{\"data\":"
+                 "{\"type\":\"INSERT\",\"schema\":\"public\",\"table\":\"readings\","
+                 "\"commit_timestamp\":\"2024-05-01T12:00:00.000Z\",\"columns\":[{\"name\":\"id\",\"type\":\"int8\"}],"
+                 "\"record\":" + record + ",\"old_record\":{},\"errors\":null},\"ids\":[1]},\"ref\":null}";
+  changesSeen = 0;
+  bench("realtime/dispatch_row_12", ops, [&](unsigned long i)
+        {
+    realtimeSocket.push(frame);
+    db.realtimeLoop(); });
+  if (changesSeen != ops + ops / 10)
+  {
+    fprintf(stderr, "realtime/dispatch_row_12: %lu of %lu frames reached the handler\n", changesSeen, ops + ops / 10);
+  }
+
+  // One device telling another: a row inserted and delivered as a change,
+  // against one broadcast frame. One op = the message reached the peer
+  static Supabase peer;
+  static SupabaseLocalSocket peerSocket;
+  peer.begin("http://localhost", "anon");
+  peer.setSocketTransport(&peerSocket);
+  peer.setHeartbeat(0);
+  peer.subscribe("peer_messages", "", onChange);
+  peer.subscribeBroadcast("peers", onChange);
+  peer.beginRealtime(443);
+  int channel = db.subscribeBroadcast("peers", nullptr);
+  for (int i = 0; i < 4; i++)
+  {
+    db.realtimeLoop();
+    peer.realtimeLoop();
+  }
+  String message = makeRow(4, 7);
+  changesSeen = 0;
+  bench("realtime/peer_via_insert", ops / 10, [&](unsigned long i)
+        {
+    db.insert("peer_messages", message, false);
+    peer.realtimeLoop(); });
+  bench("realtime/peer_via_broadcast", ops / 10, [&](unsigned long i)
+        {
+    db.broadcast(channel, "reading", message);
+    db.realtimeLoop();
+    peer.realtimeLoop(); });
+  if (changesSeen != 2 * (ops / 10 + ops / 100))
+  {
+    fprintf(stderr, "realtime/peer_*: %lu of %lu messages reached the peer\n", changesSeen, 2 * (ops / 10 + ops / 100));
+  }
+  peer.unsubscribeFromRealtime();
+  db.unsubscribeFromRealtime();
+}
+
+// The columns of `bench_rows` read by `e2e/select_20_rows`
+struct BenchRow
+{
+  long id;
+  char c1[24];
+  double c2;
+};
+
+static const SupabaseRowColumn<BenchRow> benchRowColumns[] = {
+    SUPABASE_COLUMN_READ(BenchRow, id),
+    SUPABASE_COLUMN(BenchRow, c1),
+    SUPABASE_COLUMN(BenchRow, c2),
+};
+
+// Whole requests through the client and the loopback stand-in: URL and
+// headers, the transport, the server's PostgREST subset and the response
+static void benchEndToEnd()
+{
+  const unsigned long ops = 5000;
+  const long rows = 1000;
+  SupabaseLocalServer &server = SupabaseLocalServer::instance();
+  String seed = "[";
+  for (long id = 1; id <= rows; id++)
+  {
+    seed += (id > 1 ? "," : "") + makeRow(8, id);
+  }
+  seed += "]";
+  server.seed("bench_rows", seed);
+
+  bench("e2e/select_by_id", ops, [](unsigned long i)
+        { String json = db.from("bench_rows").select("*").eq("id", String(1 + i % rows)).doSelect(); });
+  bench("e2e/select_20_rows", ops, [](unsigned long i)
+        { String json = db.from("bench_rows").select("id,c1,c2").gt("id", String(1 + i % (rows - 20))).limit(20).doSelect(); });
+  // Same rows parsed into structs while they arrive
+  SupabaseTable<BenchRow> table(db, "bench_rows", benchRowColumns);
+  bench("e2e/select_20_rows_typed", ops, [&](unsigned long i)
+        {
+    BenchRow found[20];
+    size_t count;
+    char filters[24];
+    snprintf(filters, sizeof(filters), "id=gt.%ld", 1 + (long)(i % (rows - 20)));
+    table.select(filters, found, 20, count); });
+  bench("e2e/update_by_id", ops, [](unsigned long i)
+        {
+    db.update("bench_rows").eq("id", String(1 + i % rows));
+    db.doUpdate("{\"c2\":" + String(i % 100) + "}"); });
+  // Same stream of updates over 10 rows, merged into one PATCH per row
+  // every 20 ms: compare tx_bytes_per_op with the line above
+  SupabaseWriteCoalescer coalescer(db, "bench_rows", 20);
+  bench("e2e/update_by_id_coalesced_20ms", ops, [&](unsigned long i)
+        {
+    char filter[16];
+    snprintf(filter, sizeof(filter), "id=eq.%lu", 1 + i % 10);
+    coalescer.set(filter, "{\"c2\":" + String(i % 100) + "}");
+    coalescer.loop(); });
+  coalescer.flush();
+  // Whole table in pages of 100, one op per table scan
+  unsigned long scanned = 0;
+  bench("e2e/scan_1000_rows_keyset_100", 50, [&](unsigned long i)
+        {
+    SupabasePaginator pages(db, "bench_rows", "id", 100);
+    pages.run(countRow, &scanned); });
+
+  bench("e2e/insert", ops, [](unsigned long i)
+        { db.insert("bench_inserts", makeRow(8, i), false); });
+  // What every insert cost before `return=minimal` became the default
+  bench("e2e/insert_representation", ops, [](unsigned long i)
+        {
+    SupabasePrefer prefer;
+    prefer.returning = SUPABASE_RETURN_REPRESENTATION;
+    String row = makeRow(8, i);
+    db.insert("bench_inserts", row.c_str(), row.length(), false, prefer); });
+}
+
+// Four tasks selecting at once through one client, one op = one select
+// per task. With a pool of one connection they queue behind each other
+static void selectFromTasks()
+{
+  std::thread tasks[4];
+  for (int t = 0; t < 4; t++)
+  {
+    tasks[t] = std::thread([t]
+                           {
+      SupabaseQueryBuffer<64> query;
+      query.from("bench_rows").select("id,c1").eq("id", (long)(1 + t));
+      String json = db.doSelect(query); });
+  }
+  for (int t = 0; t < 4; t++)
+  {
+    tasks[t].join();
+  }
+}
+
+static void benchParallel()
+{
+  const unsigned long ops = 200;
+  SupabaseLocalServer &server = SupabaseLocalServer::instance();
+  server.setLatency(1000);
+  db.setPoolSize(1);
+  bench("parallel/select_4_tasks/pool_1", ops, [](unsigned long i)
+        { selectFromTasks(); });
+  db.setPoolSize(4);
+  bench("parallel/select_4_tasks/pool_4", ops, [](unsigned long i)
+        { selectFromTasks(); });
+  db.setPoolSize(1);
+  server.setLatency(0);
+}
+
+// Time to first write of a node waking from deep sleep: a fresh client
+// per op, as after a reboot. Cold pays a full handshake and a password
+// login; warm restores the record the previous op saved
+static SupabaseWarmStart warm;
+
+static void wake(bool warmStart)
+{
+  Supabase node;
+  if (warmStart)
+  {
+    node.setWarmStart(&warm, 60000);
+  }
+  node.begin("http://localhost", "anon");
+  node.login_email("node@example.com", "secret");
+  node.insert("bench_inserts", "{\"c1\":1}", false);
+  node.saveWarmStart();
+}
+
+static void benchWakeUp()
+{
+  const unsigned long ops = 100;
+  SupabaseLocalServer &server = SupabaseLocalServer::instance();
+  server.setLatency(1000);
+  server.setHandshakeLatency(20000, 5000);
+  bench("wake/cold_first_write", ops, [](unsigned long i)
+        { wake(false); });
+  bench("wake/warm_first_write", ops, [](unsigned long i)
+        { wake(true); });
+  server.setHandshakeLatency(0, 0);
+  server.setLatency(0);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+  {
+    only = argv[1];
+  }
+  db.begin("http://localhost", "anon");
+  benchQueryBuilder();
+  benchJson();
+  benchRealtime();
+  benchEndToEnd();
+  benchParallel();
+  benchCompression();
+  // Last: the clients it creates and destroys stay registered for WiFi events
+  benchWakeUp();
+  return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * Host-native run of the library against the in-process Supabase stand-in.
+ *
+ * Build and run on Linux with:
+ *   pio run -e native && .pio/build/native/program
+ *
+ * Every call below goes through the same `Supabase` code as on the board;
+ * only the transports are swapped for `SupabaseLocalHttp`/`SupabaseLocalSocket`.
+ */
+
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+#include <SupabaseCache.h>
+#include <LittleFS.h>
+#include <SupabaseJournal.h>
+
+Supabase db;
+
+static int realtimeMessages = 0;
+
+void onRealtime(uint8_t *payload, size_t length)
+{
+  realtimeMessages++;
+}
+
+static int insertsSeen = 0;
+
+void onInsert(const SupabaseChangeEvent &event, void *ctx)
+{
+  insertsSeen++;
+  Serial.printf("%s: inserted id %ld\n", event.table, event.record["id"].as<long>());
+}
+
+int main()
+{
+  SupabaseLocalServer &server = SupabaseLocalServer::instance();
+  // Roughly what a TLS handshake and a resumed session cost on the board
+  server.setHandshakeLatency(600000, 150000);
+  server.seed("examples", "[{\"id\":1,\"column\":\"value\"},{\"id\":2,\"column\":\"other\"}]");
+
+  db.begin("http://localhost", "anon", &Serial);
+  // Short-lived tokens, so the run below crosses a background refresh
+  server.setTokenLifetime(3);
+  db.login_email("device@example.com", "secret");
+
+  unsigned long t0 = micros();
+  String read = db.from("examples").select("*").eq("column", "value").limit(1).doSelect();
+  Serial.printf("select: %lu us -> %s\n", micros() - t0, read.c_str());
+
+  // Repeated lookups: the second is answered from memory, the third is
+  // revalidated after the TTL and confirmed by a 304
+  SupabaseCache cache(4096, 8, 50);
+  db.setCache(&cache);
+  for (int i = 0; i < 3; i++)
+  {
+    if (i == 2)
+    {
+      delay(60);
+    }
+    t0 = micros();
+    read = db.from("examples").select("*").eq("id", "2").doSelect();
+    Serial.printf("cached select %d: %lu us\n", i, micros() - t0);
+  }
+
+  t0 = micros();
+  int code = db.insert("examples", "{\"column\":\"inserted\"}", false);
+  Serial.printf("insert: %lu us -> %d\n", micros() - t0, code);
+
+  db.realtimeTXTHandler = onRealtime;
+  db.beginRealtime(443, "examples", "1");
+  // Second topic on the same socket
+  int inserts = db.subscribe("examples", "", onInsert, nullptr, "INSERT", "public", "id");
+  db.realtimeLoop();
+
+  t0 = micros();
+  code = db.update("examples").eq("id", "1").doUpdate("{\"column\":\"changed\"}");
+  Serial.printf("update: %lu us -> %d\n", micros() - t0, code);
+
+  db.insert("examples", "{\"column\":\"watched\"}", false);
+  db.realtimeLoop();
+  Serial.printf("realtime frames received: %d, inserts seen: %d\n", realtimeMessages, insertsSeen);
+  db.unsubscribe(inserts);
+
+  // Half-dead link: the server stops answering, heartbeats go unanswered
+  // and the client reconnects with backoff, then rejoins its subscription
+  db.setHeartbeat(200, 2);
+  db.setReconnectBackoff(100, 1000);
+  server.setRealtimeStalled(true);
+  for (unsigned long start = millis(); millis() - start < 1000;)
+  {
+    db.realtimeLoop();
+    delay(10);
+  }
+  server.setRealtimeStalled(false);
+  for (unsigned long start = millis(); millis() - start < 2000;)
+  {
+    db.realtimeLoop();
+    delay(10);
+  }
+  const SupabaseRealtimeStats &rt = db.getRealtimeStats();
+  Serial.printf("realtime: connected %d, rtt %lu us, %lu heartbeats, %lu missed, %lu reconnects\n",
+                rt.connected, rt.rttUs, rt.heartbeats, rt.missed, rt.reconnects);
+
+  t0 = micros();
+  code = db.update("examples").eq("id", "2").doUpdate("{\"column\":\"late\"}");
+  Serial.printf("update after the refresh window: %lu us -> %d (%lu token refreshes)\n",
+                micros() - t0, code, server.refreshCount());
+
+  // Offline writes go to the journal (files under ./littlefs) and are
+  // replayed in order by the worker task once WiFi has an IP again
+  LittleFS.begin(true);
+  SupabaseJournal journal(LittleFS);
+  journal.begin();
+  db.setJournal(&journal);
+  WiFi.simulateEvent(SYSTEM_EVENT_STA_DISCONNECTED);
+  for (int i = 0; i < 5; i++)
+  {
+    char row[40];
+    snprintf(row, sizeof(row), "{\"column\":\"offline %d\"}", i);
+    code = db.insert("examples", row, false);
+  }
+  Serial.printf("insert while offline -> %d, %u bytes journaled\n", code, (unsigned)journal.pendingBytes());
+  WiFi.simulateEvent(SYSTEM_EVENT_STA_GOT_IP);
+  for (unsigned long start = millis(); !journal.empty() && millis() - start < 2000;)
+  {
+    delay(10);
+  }
+  const SupabaseJournalStats &js = journal.stats();
+  Serial.printf("journal: %lu appended, %lu replayed in %lu requests, %lu dropped\n",
+                js.appended, js.replayed, js.batches, js.dropped);
+  db.setJournal(nullptr);
+
+  const SupabaseCacheStats &cs = cache.stats();
+  Serial.printf("cache: %lu hits, %lu misses, %lu revalidated, %lu invalidated, %u bytes\n",
+                cs.hits, cs.misses, cs.revalidated, cs.invalidations, (unsigned)cache.bytes());
+  db.setCache(nullptr);
+
+  SupabaseMetrics metrics;
+  db.getMetrics(metrics);
+  for (uint8_t i = 0; i < SUPABASE_OP_COUNT; i++)
+  {
+    const SupabaseOpMetrics &m = metrics.op[i];
+    if (m.calls)
+    {
+      Serial.printf("%s: %lu calls, p50 %lu ms, request %llu us, response %llu us, %lu/%lu bytes, heap low %u\n",
+                    SupabaseMetrics::name((SupabaseOp)i), m.calls, m.percentileMs(50),
+                    (unsigned long long)(m.requestUs / m.calls), (unsigned long long)(m.responseUs / m.calls),
+                    m.bytesSent, m.bytesReceived, (unsigned)m.heapLow);
+    }
+  }
+
+  const SupabaseConnectionStats &conn = db.getConnectionStats();
+  Serial.printf("connection: %lu requests, %lu reused, %lu handshakes (%lu resumed), %lu drops\n",
+                conn.requests, conn.reused, conn.handshakes, conn.resumed, conn.drops);
+
+  db.unsubscribeFromRealtime();
+  return 0;
+}
@@ -0,0 +1,52 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+#include <LittleFS.h>
+#include <SupabaseJournal.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+// 64 KB of flash in 4 segments; the oldest segment goes when it is full
+SupabaseJournal journal(LittleFS, "/supabase", 65536, 4, SUPABASE_JOURNAL_DROP_OLDEST);
+
+void setup() {
+  Serial.begin(9600);
+
+  // Format on first use
+  LittleFS.begin(true);
+  journal.begin();
+  // Readings are not precious: flush every 4 records to save flash wear
+  journal.setSyncEvery(4);
+
+  // No need to wait for WiFi: writes are stored until it connects
+  WiFi.begin("ssid", "password");
+
+  // Beginning Supabase Connection
+  db.begin(supabase_url, anon_key);
+  db.setJournal(&journal);
+}
+
+void loop() {
+  char row[64];
+  snprintf(row, sizeof(row), "{\"sensor\":1,\"value\":%d}", analogRead(A0));
+
+  // Sent right away when online; otherwise stored and replayed in order,
+  // batched, from a background task once WiFi has an IP
+  int code = db.insert("readings", row, false);
+  if (code == SUPABASE_JOURNALED) {
+    Serial.printf("stored, %u bytes waiting\n", (unsigned)journal.pendingBytes());
+  } else {
+    Serial.println(code);
+  }
+
+  delay(10000);
+}
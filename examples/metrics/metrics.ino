@@ -0,0 +1,83 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+unsigned long lastReport = 0;
+
+// One telemetry row per report: where the time of each operation went
+void report() {
+  SupabaseMetrics metrics;
+  db.getMetrics(metrics);
+  db.resetMetrics();
+
+  JsonDocument doc;
+  doc["device"] = "1";
+  doc["seconds"] = (millis() - metrics.since) / 1000;
+  for (uint8_t i = 0; i < SUPABASE_OP_COUNT; i++) {
+    const SupabaseOpMetrics &m = metrics.op[i];
+    if (m.calls == 0 && m.networkErrors == 0) {
+      continue;
+    }
+    JsonObject op = doc[SupabaseMetrics::name((SupabaseOp)i)].to<JsonObject>();
+    op["calls"] = m.calls;
+    op["net_err"] = m.networkErrors;
+    op["http_err"] = m.httpErrors;
+    op["retries"] = m.retries;
+    op["tx"] = m.bytesSent;
+    op["rx"] = m.bytesReceived;
+    if (m.calls) {
+      // Mean of each phase: DNS, TCP + TLS, server, body read
+      op["dns_ms"] = (float)m.dnsUs / m.calls / 1000;
+      op["connect_ms"] = (float)m.connectUs / m.calls / 1000;
+      op["request_ms"] = (float)m.requestUs / m.calls / 1000;
+      op["response_ms"] = (float)m.responseUs / m.calls / 1000;
+      op["p50_ms"] = m.percentileMs(50);
+      op["p95_ms"] = m.percentileMs(95);
+      op["max_ms"] = m.maxUs / 1000;
+    }
+    op["heap_low"] = m.heapLow;
+  }
+
+  String row;
+  serializeJson(doc, row);
+  Serial.println(row);
+  // Sent after the snapshot: it shows up in the next report
+  db.insert("telemetry", row, false);
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  Serial.print("Connecting to WiFi");
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  // Beginning Supabase Connection
+  db.begin(supabase_url, anon_key);
+}
+
+void loop() {
+  String read = db.from("table").select("*").eq("column", "value").limit(1).doSelect();
+  db.insert("table", "{\"column\":\"value\"}", false);
+
+  if (millis() - lastReport >= 60000) {
+    lastReport = millis();
+    report();
+  }
+  delay(1000);
+}
@@ -0,0 +1,60 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+#include <SupabasePaginator.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+// 200 rows per request, ordered by the primary key
+SupabasePaginator pages(db, "readings", "id", 200);
+
+unsigned long synced = 0;
+
+// Called once per row while the page streams in: only one row is in RAM
+bool onRow(JsonObjectConst row, void *ctx) {
+  synced++;
+  // e.g. append to a file on flash
+  return true;
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  Serial.print("Connecting to WiFi");
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  // Beginning Supabase Connection
+  db.begin(supabase_url, anon_key);
+
+  pages.select("id,ts,value").where("device=eq.7");
+
+  // Resume where the last sync stopped, e.g. after a reset:
+  // pages.startAfter(savedKey);
+
+  int code = pages.run(onRow);
+  while (!pages.done()) {
+    // Interrupted (no link, server error): continues after the last row
+    // that was delivered, nothing is fetched twice
+    Serial.printf("stopped at id %s with %d, retrying\n", pages.lastKey(), code);
+    delay(5000);
+    code = pages.run(onRow);
+  }
+  Serial.printf("%lu rows in %lu pages, last id %s\n", pages.rows(), pages.pages(), pages.lastKey());
+}
+
+void loop() {
+}
@@ -0,0 +1,61 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+// Polls the settings row on core 0
+void settingsTask(void *arg) {
+  // Each task builds its own query: the `db.from(...)` builder is shared
+  SupabaseQueryBuffer<96> query;
+  query.from("settings").select("interval,threshold").eq("device", 1L).limit(1);
+  while (true) {
+    String settings = db.doSelect(query);
+    Serial.printf("settings: %s\n", settings.c_str());
+    vTaskDelay(pdMS_TO_TICKS(5000));
+  }
+}
+
+// Uploads a reading every second on core 1, not held up by the poll
+void uploadTask(void *arg) {
+  char row[64];
+  while (true) {
+    snprintf(row, sizeof(row), "{\"device\":1,\"value\":%d}", analogRead(A0));
+    int httpCode = db.insert("readings", row, strlen(row), false);
+    Serial.printf("insert -> %d\n", httpCode);
+    vTaskDelay(pdMS_TO_TICKS(1000));
+  }
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  Serial.print("Connecting to WiFi");
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  // Two connections: the tasks' requests run at the same time instead of
+  // taking turns. Set before any request runs
+  db.setPoolSize(2);
+  db.begin(supabase_url, anon_key);
+
+  xTaskCreatePinnedToCore(settingsTask, "settings", 8192, nullptr, 1, nullptr, 0);
+  xTaskCreatePinnedToCore(uploadTask, "upload", 8192, nullptr, 1, nullptr, 1);
+}
+
+void loop() {
+  delay(1000);
+}
@@ -0,0 +1,58 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+int settings = -1;
+int alarms = -1;
+
+void onSettings(const SupabaseChangeEvent &event, void *ctx) {
+  if (event.type == SUPABASE_CHANGE_UPDATE) {
+    Serial.printf("interval is now %d s\n", event.record["interval"].as<int>());
+  }
+}
+
+void onAlarm(const SupabaseChangeEvent &event, void *ctx) {
+  Serial.printf("alarm %s at %s\n", event.record["message"].as<const char *>(), event.commitTimestamp);
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  Serial.print("Connecting to WiFi");
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  // Beginning Supabase Connection
+  db.begin(supabase_url, anon_key);
+
+  // One socket, several topics
+  db.beginRealtime(443);
+  // Only `interval` / `message` are parsed out of the changed rows
+  settings = db.subscribe("settings", "device=eq.42", onSettings, nullptr, "UPDATE", "public", "interval");
+  alarms = db.subscribe("alarms", "", onAlarm, nullptr, "INSERT", "public", "message");
+}
+
+void loop() {
+  db.realtimeLoop();
+
+  // Subscriptions can come and go without reconnecting
+  if (alarms >= 0 && millis() > 600000) {
+    db.unsubscribe(alarms);
+    alarms = -1;
+  }
+}
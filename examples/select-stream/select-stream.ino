@@ -0,0 +1,60 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+// put your WiFi credentials (SSID and Password) here
+const char *ssid = "";
+const char *psswd = "";
+
+// Called once per row while the response is still being received
+bool onRow(JsonObjectConst row, void *ctx)
+{
+  int *count = (int *)ctx;
+  (*count)++;
+  Serial.printf("%s = %s\n", row["key"].as<const char *>(), row["value"].as<const char *>());
+  return true; // return false to stop reading
+}
+
+void setup()
+{
+  Serial.begin(9600);
+
+  // Connecting to Wi-Fi
+  Serial.print("Connecting to WiFi");
+  WiFi.begin(ssid, psswd);
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  // Beginning Supabase Connection
+  db.begin(supabase_url, anon_key);
+
+  // Only "key" and "value" of each row are kept in memory
+  JsonDocument filter;
+  filter["key"] = true;
+  filter["value"] = true;
+
+  // No .limit() needed: rows are parsed one by one, memory use stays constant
+  int rows = 0;
+  int code = db.from("config").select("*").doSelectStream(onRow, &rows, &filter);
+  Serial.printf("HTTP %d, %d rows\n", code, rows);
+}
+
+void loop()
+{
+  delay(10);
+}
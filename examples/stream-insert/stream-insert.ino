@@ -0,0 +1,72 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+#include <LittleFS.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+// Rows generated while they are sent: only one chunk is ever in memory
+struct Readings {
+  int next;
+  int count;
+};
+
+size_t produceReadings(uint8_t *buffer, size_t size, void *ctx) {
+  Readings *readings = (Readings *)ctx;
+  size_t n = 0;
+  if (readings->next == 0) {
+    n = snprintf((char *)buffer, size, "device,value\n");
+  }
+  // Whole rows only: a row that does not fit goes into the next chunk
+  while (readings->next < readings->count) {
+    int length = snprintf((char *)buffer + n, size - n, "1,%d\n", readings->next % 100);
+    if ((size_t)length >= size - n) {
+      break;
+    }
+    n += length;
+    readings->next++;
+  }
+  return n;
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  Serial.print("Connecting to WiFi");
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  db.begin(supabase_url, anon_key);
+  LittleFS.begin();
+
+  // Upload "database-example/example data.csv" copied to the flash as-is:
+  // the header line names the columns
+  File csv = LittleFS.open("/example data.csv", "r");
+  if (csv) {
+    int httpCode = db.insertStream("examples", csv, SUPABASE_BODY_CSV);
+    Serial.printf("csv upload -> %d\n", httpCode);
+    csv.close();
+  }
+
+  // 50000 generated rows in one request
+  Readings readings = {0, 50000};
+  int httpCode = db.insertStream("readings", produceReadings, &readings, SUPABASE_BODY_CSV);
+  Serial.printf("generated upload -> %d\n", httpCode);
+}
+
+void loop() {
+  delay(1000);
+}
@@ -0,0 +1,80 @@
+#include <Arduino.h>
+#include <ESP32_Supabase.h>
+#include <SupabaseTable.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+Supabase db;
+
+// Put your supabase URL and Anon key here...
+String supabase_url = "";
+String anon_key = "";
+
+// One row of the table `readings`
+struct Reading {
+  long id;
+  char device[16];
+  float value;
+  bool alarm;
+};
+
+// Declared once: the select list, the JSON written and the fields parsed
+// all come from here. A typo in a member name does not compile
+static const SupabaseRowColumn<Reading> readingColumns[] = {
+  // Assigned by the database: selected, never written
+  SUPABASE_COLUMN_READ(Reading, id),
+  SUPABASE_COLUMN(Reading, device),
+  SUPABASE_COLUMN(Reading, value),
+  SUPABASE_COLUMN(Reading, alarm),
+};
+
+SupabaseTable<Reading> readings(db, "readings", readingColumns);
+
+bool printReading(const Reading &r, void *ctx) {
+  Serial.printf("#%ld %s %.1f%s\n", r.id, r.device, r.value, r.alarm ? " ALARM" : "");
+  return true;
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  Serial.print("Connecting to WiFi");
+  WiFi.begin("ssid", "password");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+    Serial.print(".");
+  }
+  Serial.println("Connected!");
+
+  db.begin(supabase_url, anon_key);
+
+  Reading batch[3] = {
+    {0, "sensor-1", 21.5, false},
+    {0, "sensor-2", 48.0, true},
+    {0, "sensor-3", 19.0, false},
+  };
+  int httpCode = readings.insert(batch, 3);
+  Serial.printf("insert -> %d\n", httpCode);
+
+  // Straight into structs, one row at a time
+  readings.select("alarm=is.true&order=id.desc", printReading, nullptr, 10);
+
+  Reading latest[5];
+  size_t count;
+  readings.select("device=eq.sensor-1&order=id.desc", latest, 5, count);
+  if (count > 0) {
+    // Send back just the changed column
+    char filter[24];
+    snprintf(filter, sizeof(filter), "id=eq.%ld", latest[0].id);
+    latest[0].alarm = true;
+    readings.update(filter, latest[0], "alarm");
+  }
+}
+
+void loop() {
+  delay(1000);
+}
@@ -7,11 +7,12 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
-#include <WiFiClientSecure.h>
-#include <WebSocketsClient.h>
 #include <esp_timer.h>
 
-#if defined(ESP8266)
+#if defined(SUPABASE_HOST)
+#include <WiFi.h>
+#include "host/SupabaseLocalServer.h"
+#elif defined(ESP8266)
 #include <ESP8266HTTPClient.h>
 #elif defined(ESP32)
 #include <HTTPClient.h>
@@ -19,12 +20,204 @@
 #error "This library is not supported for your board! ESP32 and ESP8266"
 #endif
 
-/** Need this for the trampoline */
+#include "SupabaseTransport.h"
+#include "SupabaseQuery.h"
+#include "SupabaseMetrics.h"
+#include "SupabaseWarmStart.h"
+
+/** First client created, for sketches that reached it through this. The
+ * library keeps all state per instance and does not use it */
 class Supabase;
 extern Supabase* globalSupabase;
+class SupabaseAsync;
+class SupabaseJournal;
+class SupabaseCache;
+class SupabaseInflateStream;
 
 typedef void (*RealtimeTXTHandler)(uint8_t * payload, size_t length);
-typedef void (*WebSocketEventHandler)(WStype_t type, uint8_t * payload, size_t length);
+
+enum SupabaseChangeType
+{
+    SUPABASE_CHANGE_INSERT,
+    SUPABASE_CHANGE_UPDATE,
+    SUPABASE_CHANGE_DELETE,
+    SUPABASE_CHANGE_UNKNOWN,
+    /** A message of a peer on a broadcast channel: `event` is its name,
+     * `record` its payload */
+    SUPABASE_CHANGE_BROADCAST
+};
+
+/** One decoded `postgres_changes` or `broadcast` message. Strings and
+ * record views point into the parsed frame and are only valid during the
+ * handler call */
+struct SupabaseChangeEvent
+{
+    /** Id returned by `Supabase::subscribe()` */
+    int subscription;
+    SupabaseChangeType type;
+    const char *schema;
+    const char *table;
+    const char *commitTimestamp;
+    /** New row (INSERT, UPDATE), null for DELETE */
+    JsonObjectConst record;
+    /** Previous row (UPDATE, DELETE): only the primary key unless the
+     * table has `REPLICA IDENTITY FULL` */
+    JsonObjectConst oldRecord;
+    /** Name of a broadcast message, empty otherwise */
+    const char *event;
+};
+
+/** Called for every change of the subscription. Protocol messages (join
+ * replies, heartbeats, presence) never reach it */
+typedef void (*SupabaseChangeHandler)(const SupabaseChangeEvent &event, void *ctx);
+
+/** Realtime subscriptions sharing the single socket */
+#ifndef SUPABASE_MAX_CHANNELS
+#define SUPABASE_MAX_CHANNELS 4
+#endif
+
+/** Broadcast messages queued or waiting for their ack, over all channels */
+#ifndef SUPABASE_BROADCAST_QUEUE
+#define SUPABASE_BROADCAST_QUEUE 8
+#endif
+
+/** A broadcast not acknowledged within this (ms) is reported as failed */
+#ifndef SUPABASE_BROADCAST_ACK_TIMEOUT
+#define SUPABASE_BROADCAST_ACK_TIMEOUT 5000
+#endif
+
+/** Outcome of broadcast `message` (the id returned by
+ * `Supabase::broadcast()`) on a channel joined with an ack handler:
+ * `ok` once the server confirmed it, `false` if it refused it, did not
+ * answer in `SUPABASE_BROADCAST_ACK_TIMEOUT` or the link dropped first
+ * (the message may still have gone out) */
+typedef void (*SupabaseAckHandler)(int subscription, int message, bool ok, void *ctx);
+
+/** REST connections a client can have open, see `Supabase::setPoolSize()` */
+#ifndef SUPABASE_MAX_CONNECTIONS
+#define SUPABASE_MAX_CONNECTIONS 4
+#endif
+
+/** Health of the realtime link, see `Supabase::getRealtimeStats()` */
+struct SupabaseRealtimeStats
+{
+    bool connected;
+    /** Round trip of the last answered heartbeat */
+    unsigned long rttUs;
+    /** Moving average of `rttUs` */
+    unsigned long rttAvgUs;
+    /** Heartbeats answered / not answered in time */
+    unsigned long heartbeats;
+    unsigned long missed;
+    /** Reconnect attempts after a drop */
+    unsigned long reconnects;
+    /** Delay before the pending reconnect, 0 while connected */
+    unsigned long backoffMs;
+    /** Broadcast messages written to the socket, and those reported to
+     * an ack handler as failed */
+    unsigned long broadcasts;
+    unsigned long broadcastsFailed;
+};
+
+/** How REST calls are retried, see `Supabase::setRetryPolicy()`.
+ *
+ * Reads (selects), updates and upserts are retried after transport errors
+ * and 408, 429, 502, 503 or 504. Inserts, rpc calls and token refreshes
+ * may not be safe to repeat, so they are only retried when the request
+ * never left the device (connect failed) */
+struct SupabaseRetryPolicy
+{
+    /** Requests per call, the first one included */
+    uint8_t maxAttempts = 3;
+    /** No retry is started after a call has run this long (ms), 0 = no
+     * limit. A single request is bounded by the transport's own timeout */
+    unsigned long deadlineMs = 10000;
+    /** Wait before a retry: doubles from `backoffMinMs` up to
+     * `backoffMaxMs`, randomized to between half and all of it */
+    unsigned long backoffMinMs = 200;
+    unsigned long backoffMaxMs = 2000;
+    /** Consecutive failed calls (no response, or 5xx) that open the
+     * circuit, 0 = never open it */
+    uint8_t breakerThreshold = 5;
+    /** While open, calls fail with `SUPABASE_ERR_CIRCUIT_OPEN` without
+     * being sent. Afterwards one call is let through to probe the server */
+    unsigned long breakerCooldownMs = 30000;
+};
+
+/** Outcome of the last REST call, see `Supabase::lastStatus()` */
+struct SupabaseStatus
+{
+    /** HTTP status, or a negative transport / `SUPABASE_ERR_*` code */
+    int code;
+    /** Requests sent, 0 if the circuit was open */
+    uint8_t attempts;
+    /** Time spent in the call, backoff included */
+    unsigned long elapsedMs;
+    /** Retries stopped because the deadline would have passed */
+    bool deadlineExceeded;
+
+    bool ok() const { return code >= 200 && code < 300; }
+};
+
+/** What a write sends back (`Prefer: return=...`) */
+enum SupabaseReturn : uint8_t
+{
+    /** Same as `SUPABASE_RETURN_MINIMAL` */
+    SUPABASE_RETURN_DEFAULT = 0,
+    /** Status code only, no body */
+    SUPABASE_RETURN_MINIMAL = 1,
+    /** No body, a `Location` header for the inserted row */
+    SUPABASE_RETURN_HEADERS_ONLY = 2,
+    /** The written rows, see `Supabase::lastResponse()` */
+    SUPABASE_RETURN_REPRESENTATION = 3
+};
+
+/** How the server counts the affected / matching rows (`Prefer: count=...`) */
+enum SupabaseCount : uint8_t
+{
+    SUPABASE_COUNT_NONE = 0,
+    /** `count(*)`, slow on big tables */
+    SUPABASE_COUNT_EXACT = 1,
+    /** The planner's estimate */
+    SUPABASE_COUNT_PLANNED = 2,
+    /** Exact up to the server's max rows, estimated above */
+    SUPABASE_COUNT_ESTIMATED = 3
+};
+
+/** `Prefer` options of one request, see `Supabase::setPrefer()` */
+struct SupabasePrefer
+{
+    SupabaseReturn returning = SUPABASE_RETURN_DEFAULT;
+    /** Read back with `Supabase::lastCount()` */
+    SupabaseCount count = SUPABASE_COUNT_NONE;
+    /** Inserts: columns missing from a row get their default value
+     * instead of null (`missing=default`) */
+    bool missingDefault = false;
+    /** Upserts: comma-separated unique columns to match rows on
+     * (`on_conflict=`), `nullptr` for the primary key */
+    const char *onConflict = nullptr;
+};
+
+/** Body of a streamed insert, see `Supabase::insertStream()` */
+enum SupabaseBodyFormat : uint8_t
+{
+    /** A JSON array of row objects */
+    SUPABASE_BODY_JSON = 0,
+    /** CSV, the first line naming the columns (`text/csv`). Every column
+     * name is sent once instead of once per row */
+    SUPABASE_BODY_CSV = 1
+};
+
+/** Writes stored by a `SupabaseJournal` */
+enum SupabaseJournalOp : uint8_t
+{
+    SUPABASE_JOURNAL_INSERT = 1,
+    SUPABASE_JOURNAL_UPSERT = 2,
+    SUPABASE_JOURNAL_UPDATE = 3
+};
+
+/** Called by `doSelectStream()` for every row. Return `false` to stop */
+typedef bool (*SupabaseRowCallback)(JsonObjectConst row, void *ctx);
 
 class Supabase
 {
@@ -34,43 +227,323 @@ private:
     Stream* debugSerial;
 
     String hostname;
+    /** `hostname/rest/v1/`, the start of every REST URL */
+    String restPrefix;
     String key;
     String USER_TOKEN;
 
     String url_query;
 
-    WiFiClientSecure client;
-    HTTPClient https;
+    SupabaseDefaultHttp defaultHttp;
+
+    /** One REST connection of the pool and the state of its response */
+    struct Connection
+    {
+        SupabaseHttpTransport *http;
+        /** Created for the first gzipped response read from it */
+        SupabaseInflateStream *inflater;
+        /** `http` was created by `setPoolSize()` */
+        bool owned;
+        /** Task holding it, and how often: a request may log in first */
+        TaskHandle_t owner;
+        uint8_t depth;
+        /** WiFi went down while it was in use: close it once released */
+        bool stopPending;
+    };
+    Connection pool[SUPABASE_MAX_CONNECTIONS];
+    uint8_t poolSize;
+    unsigned long idleTimeout;
+    /** Counts the idle connections */
+    SemaphoreHandle_t poolFree;
+    /** Guards `owner`, `depth` and `stopPending` */
+    SemaphoreHandle_t poolLock;
+    /** Wait for an idle connection. A task already holding one gets the
+     * same one again */
+    Connection *_acquire();
+    void _release(Connection *conn);
+    /** Only while no request runs. `transports == nullptr` for the
+     * default transport */
+    void _set_pool(SupabaseHttpTransport *const *transports, uint8_t count);
+    /** Holds a connection for the duration of a call */
+    struct Lease
+    {
+        Supabase &db;
+        Connection *conn;
+        Lease(Supabase &d) : db(d), conn(d._acquire()) {}
+        ~Lease() { db._release(conn); }
+    };
+
+    /** Serializes logins and token refreshes. Always taken after a
+     * connection, never before: a refresh must not wait for a connection
+     * held by a task that waits for the refresh */
+    SemaphoreHandle_t authLock;
+    struct RecursiveGuard
+    {
+        SemaphoreHandle_t sem;
+        RecursiveGuard(SemaphoreHandle_t s) : sem(s) { xSemaphoreTakeRecursive(sem, portMAX_DELAY); }
+        ~RecursiveGuard() { xSemaphoreGiveRecursive(sem); }
+    };
+    /** Guards what calls of any task report back: `status`, the breaker,
+     * `resultCount` and `data` */
+    SemaphoreHandle_t stateLock;
 
     bool useAuth;
     unsigned long loginTime;
+    /** Single-use token from the last login/refresh, replaces the password */
+    String refreshToken;
+    /** Token age (ms) after which it is refreshed in the background */
+    unsigned long refreshAfter;
+    bool refreshQueued;
+    /** Guards `USER_TOKEN`, read by every request and the realtime loop */
+    SemaphoreHandle_t tokenLock;
     String phone_or_email;
     String password;
+    /** Rows of the last write with `SUPABASE_RETURN_REPRESENTATION` */
     String data;
     String loginMethod;
     String filter;
 
-    unsigned int authTimeout = 0;
+    unsigned long authTimeout = 0;
 
     // Websocktes
     bool realtimeInitialized;
     bool realtimeStarted;
     int realtimePort;
+    bool realtimeConnected;
+    bool realtimeDropped;
+    /** Set by a login/refresh, sent to the channels by `realtimeLoop()` */
+    volatile bool realtimeTokenPending;
+    /** Set by `connect()` / `disconnect()`, carried out by `realtimeLoop()` */
+    enum : uint8_t
+    {
+        REALTIME_KEEP,
+        REALTIME_OPEN,
+        REALTIME_CLOSE
+    };
+    volatile uint8_t realtimeRequest;
     String realtimeTable;
     String realtimeId;
-    static String realtimeConfigJson;
-    static String realtimeHeartbeatJson;
-    static WebSocketsClient webSocket;
-    static void webSocketEvent(WStype_t type, uint8_t * payload, size_t length);
-    static esp_timer_handle_t heartbeat_timer;
-    static void heartbeat(void *arg);
+    int realtimeLegacy;
+    unsigned long realtimeRef;
+
+    // Heartbeats are sent and their replies matched by `ref`
+    unsigned long heartbeatInterval;
+    uint8_t heartbeatMaxMissed;
+    uint8_t heartbeatMissed;
+    unsigned long heartbeatRef;
+    unsigned long heartbeatSent;
+    unsigned long heartbeatSentUs;
+
+    // Reconnect after a drop
+    unsigned long backoffMin;
+    unsigned long backoffMax;
+    uint8_t reconnectAttempt;
+    bool reconnectPending;
+    unsigned long reconnectAt;
+    unsigned long connectStarted;
+    SupabaseRealtimeStats realtimeStats;
+
+    // Per-operation counters, see `getMetrics()`. Written by the request
+    // functions (any task) and the realtime loop
+    SupabaseMetrics metrics;
+    SemaphoreHandle_t metricsLock;
+    /** Transport counters at the start of the REST call being timed */
+    struct CallStart
+    {
+        unsigned long us;
+        unsigned long sent;
+        unsigned long received;
+    };
+    CallStart _call_start(SupabaseHttpTransport *https);
+    /** Add the call begun at `start` to the metrics, after `https->end()` */
+    void _record(SupabaseHttpTransport *https, SupabaseOp op, int httpCode, const CallStart &start, uint8_t retries = 0);
+    /** A heartbeat answered after `us`, or missed */
+    void _record_realtime(bool answered, unsigned long us);
+    void _count_realtime(size_t sent, size_t received);
+    /** `false` if the socket refused the frame */
+    bool _realtimeSend(const String &frame);
+
+    // Retries and circuit breaker, see `setRetryPolicy()`
+    SupabaseRetryPolicy retryPolicy;
+    SupabaseStatus status;
+    uint8_t breakerFailures;
+    bool breakerOpen;
+    unsigned long breakerOpenedAt;
+    struct CallRetry
+    {
+        unsigned long started;
+        uint8_t attempt;
+        bool idempotent;
+        bool deadlineHit;
+    };
+    /** Start a call. `false` if the circuit breaker rejects it */
+    bool _call_begin(CallRetry &call, bool idempotent);
+    /** After an attempt answered `httpCode`: waits out the backoff and
+     * returns `true` if the request is to be sent again */
+    bool _call_retry(CallRetry &call, int httpCode);
+    /** Finish the call: updates the breaker and `lastStatus()` */
+    int _call_end(const CallRetry &call, int httpCode);
+
+    enum ChannelState : uint8_t
+    {
+        CHANNEL_FREE,
+        /** Join to be sent by `realtimeLoop()` */
+        CHANNEL_JOIN,
+        /** Join sent, waiting for the reply */
+        CHANNEL_JOINING,
+        CHANNEL_JOINED,
+        /** Leave to be sent by `realtimeLoop()` */
+        CHANNEL_LEAVE
+    };
+
+    /** One Phoenix topic joined over the shared socket */
+    struct RealtimeChannel
+    {
+        ChannelState state;
+        /** Joined by name for broadcast messages, not for table changes */
+        bool broadcast;
+        /** Broadcast config: receive our own messages, have them acked */
+        bool self;
+        SupabaseAckHandler ackHandler;
+        String topic;
+        String table;
+        String filter;
+        String event;
+        String schema;
+        String columns;
+        SupabaseChangeHandler handler;
+        void *ctx;
+    };
+    RealtimeChannel channels[SUPABASE_MAX_CHANNELS];
+    JsonDocument realtimeFilter;
+    /** Broadcast message waiting to be sent, or for its ack */
+    struct Outgoing
+    {
+        enum : uint8_t
+        {
+            FREE,
+            QUEUED,
+            SENT
+        } state;
+        int8_t subscription;
+        int id;
+        /** Queue order */
+        uint32_t seq;
+        /** `ref` it went out with, and when */
+        unsigned long ref;
+        unsigned long sentAt;
+        String event;
+        String json;
+    };
+    Outgoing outgoing[SUPABASE_BROADCAST_QUEUE];
+    int broadcastId;
+    uint32_t broadcastSeq;
+    /** Guards `outgoing`: `broadcast()` runs on any task */
+    SemaphoreHandle_t broadcastLock;
+    /** Send the queued messages of joined channels, oldest first */
+    void _broadcastFlush();
+    /** Report messages of `subscription` (-1: all) awaiting an ack and not
+     * answered in time (or all of them if `lost`) as failed. With
+     * `dropQueued` also unsent ones */
+    void _broadcastExpire(int subscription, bool lost, bool dropQueued);
+    /** Ack reply of the message sent with `ref` */
+    void _broadcastAck(int subscription, unsigned long ref, bool ok);
+    void _realtimeJoin(int subscription);
+    void _realtimeLeave(int subscription);
+    void _realtimeRoute(uint8_t *payload, size_t length);
+    void _realtimeFilter();
+    void _realtimeHeartbeat();
+    void _realtimeDrop();
+    void _realtimeOpen();
+    SupabaseDefaultSocket defaultSocket;
+    SupabaseSocketTransport *webSocket;
+    static void webSocketEvent(void *ctx, SupabaseSocketEvent type, uint8_t * payload, size_t length);
 
     void _check_last_string();
+    /** `coll=<op><value><close>`, the value percent-encoded */
+    Supabase &_filter(const String &coll, const char *op, const String &value, const char *close);
     int _login_process();
-
-    // Asynchronous functions
-    static void asyncUpdateTask(void *pvParameters);
-    TaskHandle_t asyncUpdateTaskHandle;
+    int _refresh_process();
+    bool _token_response(const String &data);
+    /** Before a request: refresh inline if the token expired, or queue a
+     * background refresh if it is about to. `false` if the token expired
+     * and could not be refreshed: the caller returns `SUPABASE_ERR_AUTH` */
+    bool _auth_check();
+    void _auth_header(SupabaseHttpTransport *https);
+    String _access_token();
+    SupabaseAsync *_async_engine();
+
+    String _rest_url(const SupabaseQuery &query) { return _rest_url(query.c_str(), query.length()); }
+    String _rest_url(const char *path, size_t length);
+    /** With `etag`, sends it as `If-None-Match` and returns the new one;
+     * `response` is left alone on 304, whatever earlier attempts got */
+    int _select(const String &url, String &response, String *etag = nullptr, SupabaseCount count = SUPABASE_COUNT_NONE);
+    /** `ttl`: -1 for the cache default, 0 bypasses it. `url`: the full URL
+     * of `path` if the caller has it already */
+    int _cachedSelect(const char *path, size_t length, String &response, long ttl, const String *url = nullptr);
+    int _selectStream(const String &url, SupabaseRowCallback callback, void *ctx, const JsonDocument *filter);
+    int _insert(const char *table, const char *json, size_t length, bool upsert, const SupabasePrefer &prefer);
+    int _update(const String &url, const char *json, size_t length, const SupabasePrefer &prefer);
+    int _insertStream(const String &table, SupabaseBodyProducer producer, void *ctx, SupabaseBodyFormat format,
+                      bool upsert, const SupabasePrefer &prefer);
+
+    // `Prefer` handling, see `setPrefer()`
+    SupabasePrefer preferDefaults;
+    /** From the `Content-Range` of the last request that asked for a count */
+    long resultCount;
+    /** Defaults without a body or count: for writes nobody waits for
+     * (journal replay, `SupabaseAsync`) */
+    SupabasePrefer _background_prefer() const;
+    void _prefer_header(SupabaseHttpTransport *https, const SupabasePrefer &prefer, bool write, bool upsert);
+    /** Read the body of a write if it was asked for, the count too */
+    void _write_result(Connection &conn, const SupabasePrefer &prefer, int httpCode);
+    void _read_count(SupabaseHttpTransport *https);
+    int _rpc(const String &func_name, const String &json_param, String &response);
+
+    // Worker behind `asyncUpdate()`, started on first use
+    SupabaseAsync *asyncEngine;
+    friend class SupabaseAsync;
+
+    // Offline writes, see `setJournal()`
+    SupabaseJournal *journal;
+    bool replayQueued;
+    unsigned long replayFailedAt;
+    /** Send a write, or store it in the journal when it cannot go out now */
+    int _write(SupabaseJournalOp op, const char *target, size_t targetLength, const char *json, size_t length,
+               const SupabasePrefer &prefer);
+    /** Without `prefer`, `_background_prefer()` */
+    int _send(SupabaseJournalOp op, const char *target, size_t targetLength, const char *json, size_t length,
+              const SupabasePrefer *prefer = nullptr);
+    void _schedule_replay();
+    int _replay();
+    friend class SupabaseJournal;
+
+    // `doSelect()` responses, see `setCache()`
+    SupabaseCache *cache;
+    /** TTL of the builder's `doSelect()`, -1 for the cache default */
+    long nextTtl;
+
+    // Deep sleep state, see `setWarmStart()`
+    SupabaseWarmStart *warmStart;
+    unsigned long warmSleptMs;
+    /** Whose tokens are held (`_user_hash()`), 0 if none */
+    uint32_t sessionUser;
+    /** The tokens came from `warmStart` and no login has run since */
+    bool sessionRestored;
+    uint32_t _project_hash();
+    uint32_t _user_hash();
+    void _warm_restore();
+    /** Keep the restored session if it is this user's, log in otherwise */
+    int _login_start();
+
+    // Compressed transfer, see `setCompression()`
+    bool gzipResponses;
+    size_t gzipRequestMin;
+    void _accept_gzip(SupabaseHttpTransport *https);
+    /** Body of the response on `conn`, decompressed if it was sent gzipped */
+    Stream *_response_stream(Connection &conn);
+    /** `false` (and `text` empty) if a gzipped body was corrupt or cut */
+    bool _response_string(Connection &conn, String &text);
 
     /** This function is connected to WiFi events
      * It ensures that client and realtime connections are stopped and
@@ -110,7 +583,7 @@ public:
     bool initialized;
 
     Supabase();
-    ~Supabase() {};
+    ~Supabase();
 
     /** Initialize supabase. Call this first. When WiFi is connected, it
      * directly creates supabase client. Otherwise, it will wait for WiFi
@@ -120,18 +593,106 @@ public:
      * */
     void begin(String hostname_a, String key_a, Stream* debugSerial_a = nullptr);
 
-    /** Start both supabase client and realtime (if initialized) */
+    /** Replace the REST transport (default: WiFiClientSecure + HTTPClient,
+     * or the in-process stand-in on the host build). Call before `begin()`.
+     * Leaves a pool of this one connection */
+    void setTransport(SupabaseHttpTransport *transport);
+    /** Pool of `count` custom transports, one connection each */
+    void setTransports(SupabaseHttpTransport *const *transports, uint8_t count);
+    /** Open up to `size` (max `SUPABASE_MAX_CONNECTIONS`) REST connections
+     * with the default transport, so that calls from different tasks run
+     * in parallel instead of waiting for each other. Each connection keeps
+     * its own TLS session and buffers (some 40 KB on ESP32): only worth it
+     * for tasks that really overlap. Default 1. Call while no request runs */
+    void setPoolSize(uint8_t size) { _set_pool(nullptr, size); }
+    /** Replace the realtime socket transport. Call before `beginRealtime()` */
+    void setSocketTransport(SupabaseSocketTransport *transport);
+
+    /** Keep-alive and TLS handshake counters, summed over the pool */
+    SupabaseConnectionStats getConnectionStats();
+    /** Copy of the per-operation counters since the last reset: calls,
+     * errors, retries, bytes, time spent in DNS / connect+TLS / request /
+     * response read, heap low-water mark and a latency histogram. Cheap
+     * enough to call for every telemetry report */
+    void getMetrics(SupabaseMetrics &snapshot);
+    void resetMetrics();
+    /** Close the REST connection after `ms` of inactivity (0 = only when
+     * the server closes it). Use a value below the server keep-alive
+     * timeout to avoid writing to a connection the server just dropped */
+    void setIdleTimeout(unsigned long ms);
+
+    /** Keep the state of this client in `state` across deep sleep (RTC
+     * memory or a file, see `SupabaseWarmStart`). Call before `begin()`,
+     * which restores it if it is valid: the first connection skips the
+     * DNS lookup (ESP32) or resumes the TLS session (ESP8266), and a
+     * `login_email()` / `login_phone()` of the same user takes the saved
+     * tokens instead of sending the password. `sleptMs`: how long the node
+     * slept, for boards whose clock stops in deep sleep (ESP8266); without
+     * it there the access token is refreshed first */
+    void setWarmStart(SupabaseWarmStart *state, unsigned long sleptMs = 0);
+    /** Write the current state into the `setWarmStart()` record. Call it
+     * right before going to sleep: refresh tokens are single-use, and an
+     * older record may hold one that was spent since. Returns `false`
+     * without a record */
+    bool saveWarmStart();
+
+    /** Start both supabase client and realtime (if initialized). Safe from
+     * the WiFi event task: the socket is opened by the next
+     * `realtimeLoop()` */
     void connect();
-    /** Stop both supabase client and realtime */
+    /** Stop both supabase client and realtime; the socket is closed by
+     * the next `realtimeLoop()` */
     void disconnect();
 
-    /** Init Supabase realtime. Port = 443 */
+    /** Init Supabase realtime without subscriptions. Port = 443 */
+    void beginRealtime(int port);
+    /** Init Supabase realtime with one subscription to changes of the row
+     * `id` of `table`, delivered to `realtimeTXTHandler`. Port = 443 */
     void beginRealtime(int port, String table, String id);
+    /** Watch `table` (optionally rows matching `filter`, e.g. `id=eq.1`)
+     * for `event` (`*`, `INSERT`, `UPDATE` or `DELETE`). Joins a new topic on
+     * the shared socket right away if it is connected, otherwise on connect.
+     * `columns` (e.g. `"id,value"`) limits what is parsed from the records;
+     * empty keeps every column.
+     * Returns the subscription id passed to `handler`, or -1 if all
+     * `SUPABASE_MAX_CHANNELS` are in use */
+    int subscribe(const String &table, const String &filter, SupabaseChangeHandler handler, void *ctx = nullptr,
+                  const String &event = "*", const String &schema = "public", const String &columns = "");
+    /** Join the broadcast channel `channel`, shared by name with the peers
+     * that join it too, and pass its messages to `handler`
+     * (`SUPABASE_CHANGE_BROADCAST`). With `ackHandler` the server confirms
+     * each message sent with `broadcast()`; `self` also delivers our own.
+     * Returns the subscription id, or -1 if all `SUPABASE_MAX_CHANNELS`
+     * are in use */
+    int subscribeBroadcast(const String &channel, SupabaseChangeHandler handler, void *ctx = nullptr,
+                           SupabaseAckHandler ackHandler = nullptr, bool self = false);
+    /** Queue `json` (a JSON object) as message `event` on
+     * the broadcast channel `subscription`. Sent as one frame by
+     * `realtimeLoop()` once the channel is joined, without a database
+     * write. Callable from any task. Returns the message id passed to the
+     * ack handler, `SUPABASE_ERR_QUEUE_FULL` while the queue is full (try
+     * again later) or `SUPABASE_ERR_CHANNEL` if `subscription` is not a
+     * subscribed broadcast channel */
+    int broadcast(int subscription, const String &event, const String &json);
+    /** Leave the topic of `subscription`; the socket stays open */
+    bool unsubscribe(int subscription);
+    /** Send a heartbeat every `intervalMs` (default 30000, 0 = never) and
+     * reconnect after `maxMissed` (default 2) heartbeats went unanswered.
+     * After a miss the next heartbeat goes out at a quarter interval */
+    void setHeartbeat(unsigned long intervalMs, uint8_t maxMissed = 2);
+    /** Delay before reconnecting a dropped realtime link: doubles from
+     * `minMs` (default 1000) up to `maxMs` (default 60000) per failed
+     * attempt, randomized to between half and all of it */
+    void setReconnectBackoff(unsigned long minMs, unsigned long maxMs);
+    /** Heartbeat round trip and reconnect counters */
+    const SupabaseRealtimeStats &getRealtimeStats() const { return realtimeStats; }
     /** Subscribe to realtime */
     void subscribeToRealtime();
-    /** Unsubscribe (and stop the periodic heartbeat timer) */
+    /** Unsubscribe (close the socket, no reconnect) */
     void unsubscribeFromRealtime();
-    /** Call this function periodically within loop() to listen to responses */
+    /** Call this function periodically within loop() to listen to responses.
+     * All realtime socket writes (joins, leaves, heartbeats) are sent from
+     * here, reconnects too */
     void realtimeLoop();
 
     String getQuery();
@@ -139,8 +700,26 @@ public:
     void urlQuery_reset();
 
     // membuat Query Builder
+    // The builder keeps its query in the client: use it from one task
+    // only. Tasks sharing a client each build their own `SupabaseQuery`
     Supabase &from(String table);
     int insert(String table, String json, bool upsert);
+    /** Same as above, `json` is a buffer of `length` bytes (no `String` copy) */
+    int insert(const String &table, const char *json, size_t length, bool upsert);
+    /** Same as above with the `Prefer` options of this insert only */
+    int insert(const String &table, const char *json, size_t length, bool upsert, const SupabasePrefer &prefer);
+    /** Insert a body of any size: it is sent with chunked transfer encoding
+     * while `producer` writes it, so only one `SUPABASE_UPLOAD_CHUNK`
+     * buffer is held. Not compressed and not journaled; retried only if
+     * the connection failed before the producer was called */
+    int insertStream(const String &table, SupabaseBodyProducer producer, void *ctx,
+                     SupabaseBodyFormat format = SUPABASE_BODY_JSON, bool upsert = false);
+    int insertStream(const String &table, SupabaseBodyProducer producer, void *ctx, SupabaseBodyFormat format,
+                     bool upsert, const SupabasePrefer &prefer);
+    /** Same as above, the body read from `source` (e.g. a `File`) until
+     * nothing is `available()`. A leading UTF-8 byte order mark is skipped */
+    int insertStream(const String &table, Stream &source, SupabaseBodyFormat format = SUPABASE_BODY_JSON,
+                     bool upsert = false);
     Supabase &select(String colls);
     Supabase &update(String table);
 
@@ -170,16 +749,111 @@ public:
     // do select. execute this after building your query
     String doSelect();
 
+    /** Streaming select: parses the response array straight from the
+     * connection and calls `callback` once per row, so memory use does not
+     * depend on the number of rows. With `filter` (an ArduinoJson filter
+     * document) only the listed fields are kept in memory.
+     * Returns HTTP response code, or `SUPABASE_ERR_PARSE` if the body is
+     * not a JSON array of objects */
+    int doSelectStream(SupabaseRowCallback callback, void *ctx = nullptr, const JsonDocument *filter = nullptr);
+
     // do update. execute this after querying your update
     int doUpdate(String json);
 
-    // Asynchronous update which does not block the code
-    void asyncUpdate(String json);
-
+    /** Same as above for a query built with `SupabaseQuery` (fixed buffer,
+     * no allocations while building). The query is not reset */
+    String doSelect(const SupabaseQuery &query);
+    /** With the cache TTL of this response (0 bypasses the cache, -1 the
+     * cache default): unlike `cacheFor()`, safe from several tasks */
+    String doSelect(const SupabaseQuery &query, long cacheTtlMs);
+    int doSelectStream(const SupabaseQuery &query, SupabaseRowCallback callback, void *ctx = nullptr, const JsonDocument *filter = nullptr);
+    int doUpdate(const SupabaseQuery &query, const String &json);
+    /** With `Prefer` options for this request only. A count bypasses the
+     * cache of `doSelect()` */
+    String doSelect(const SupabaseQuery &query, const SupabasePrefer &prefer);
+    int doUpdate(const SupabaseQuery &query, const String &json, const SupabasePrefer &prefer);
+    /** Same as above, `json` is a buffer of `length` bytes (no `String` copy) */
+    int doUpdate(const SupabaseQuery &query, const char *json, size_t length, const SupabasePrefer &prefer);
+
+    /** Compile the query built so far (filter values may be
+     * `SUPABASE_PARAM`) and reset the builder, see `SupabasePrepared` */
+    SupabasePrepared prepare();
+    /** Same as above for a prepared query with its values bound. Returns
+     * `SUPABASE_ERR_OVERFLOW` (or an empty string) if it `overflowed()` */
+    String doSelect(SupabasePrepared &query, long cacheTtlMs = -1);
+    int doSelectStream(SupabasePrepared &query, SupabaseRowCallback callback, void *ctx = nullptr, const JsonDocument *filter = nullptr);
+    int doUpdate(SupabasePrepared &query, const String &json);
+
+    /** Asynchronous update which does not block the code: queued on a
+     * background `SupabaseAsync` worker (started on first use), result
+     * discarded. Returns `false` if the queue is full. Use `SupabaseAsync`
+     * directly for results, selects, inserts and rpc */
+    bool asyncUpdate(String json);
+
+    /** Keep inserts, upserts and updates that cannot be sent (WiFi down,
+     * network error, 5xx) in `journal` on flash; they return
+     * `SUPABASE_JOURNALED` and are replayed in order on the worker task
+     * once WiFi has an IP again. A plain insert that may have reached the
+     * server (5xx, connection lost after sending) returns its error
+     * instead, a replay could store it twice. `nullptr` detaches it */
+    void setJournal(SupabaseJournal *journal);
+    /** Queue a replay of the journal now, e.g. after it stopped on a 5xx */
+    void replayJournal();
+
+    /** Answer `doSelect()` from `cache` while fresh, revalidate with
+     * `If-None-Match` once expired. `nullptr` detaches it */
+    void setCache(SupabaseCache *cache);
+    /** TTL of the select built in this chain only; 0 bypasses the cache.
+     * Builder state like the query itself: tasks sharing the client pass
+     * the TTL to `doSelect(query, ttlMs)` instead */
+    Supabase &cacheFor(unsigned long ttlMs);
+
+    /** Ask for gzip responses on selects, rpc and inserts; they are
+     * decompressed while being parsed (32 KB window per connection,
+     * allocated on first use). A corrupt or truncated gzip body returns
+     * `SUPABASE_ERR_PARSE` and is not cached. With `requestMin`, insert
+     * bodies of at least that many bytes are sent gzipped
+     * (`Content-Encoding: gzip`), only useful if a proxy in front of
+     * PostgREST decompresses them. 0 = never. Turning responses off frees
+     * the windows */
+    void setCompression(bool responses, size_t requestMin = 0);
+    /** Free the decompression windows of idle connections; the next
+     * gzipped response allocates one again */
+    void releaseCompression();
+
+    /** `Prefer` options of inserts, upserts and updates sent without
+     * their own. By default writes return no body (`return=minimal`):
+     * nothing is serialized, sent back or read for them */
+    void setPrefer(const SupabasePrefer &prefer) { preferDefaults = prefer; }
+    const SupabasePrefer &getPrefer() const { return preferDefaults; }
+    /** Rows counted by the last request (of any task) that asked for a
+     * count: affected by a write, matching the filters of a select
+     * (regardless of `limit`). -1 if the server did not report it */
+    long lastCount() const { return resultCount; }
+    /** Rows of the last write (of any task) sent with
+     * `SUPABASE_RETURN_REPRESENTATION` */
+    String lastResponse();
+
+    /** Retry policy of REST calls: attempts, deadline, backoff and the
+     * circuit breaker. Without a response every call used to be repeated
+     * until one came, now it gives up as configured */
+    void setRetryPolicy(const SupabaseRetryPolicy &policy) { retryPolicy = policy; }
+    const SupabaseRetryPolicy &getRetryPolicy() const { return retryPolicy; }
+    /** Code, attempts and duration of the last REST call (of any task) */
+    SupabaseStatus lastStatus();
+    /** `true` while calls fail fast with `SUPABASE_ERR_CIRCUIT_OPEN` */
+    bool circuitOpen() const { return breakerOpen; }
+
+    /** Log in with a password grant. The password is dropped once the
+     * login succeeded: the session is then renewed with its refresh token,
+     * in the background before the access token expires. If the refresh
+     * token is rejected, requests fail with 401 until you log in again.
+     * Retried per `setRetryPolicy()`; returns the last status code */
     int login_email(String email_a, String password_a);
     int login_phone(String phone_a, String password_a);
 
-    static RealtimeTXTHandler realtimeTXTHandler;
+    /** Gets every realtime frame of this client as it arrived */
+    RealtimeTXTHandler realtimeTXTHandler;
 
     String rpc(String func_name, String json_param = "");
 };
@@ -1,13 +1,12 @@
 #include "ESP32_Supabase.h"
+#include "SupabaseAsync.h"
+#include "SupabaseCache.h"
+#include "SupabaseGzip.h"
+#include "SupabaseJournal.h"
 
-Supabase *globalSupabase = nullptr;
+#include <time.h>
 
-// Define static variables here
-String Supabase::realtimeConfigJson;
-String Supabase::realtimeHeartbeatJson;
-WebSocketsClient Supabase::webSocket;
-esp_timer_handle_t Supabase::heartbeat_timer;
-RealtimeTXTHandler Supabase::realtimeTXTHandler;
+Supabase *globalSupabase = nullptr;
 
 void hexdump(const void *mem, uint32_t len, uint8_t cols = 16)
 {
@@ -34,31 +33,68 @@ void Supabase::_check_last_string()
     }
 }
 
+Supabase &Supabase::_filter(const String &coll, const char *op, const String &value, const char *close)
+{
+    _check_last_string();
+    url_query += coll;
+    url_query += '=';
+    url_query += op;
+    if (value == SUPABASE_PARAM)
+    {
+        url_query += value;
+    }
+    else
+    {
+        supabaseEncode(url_query, value.c_str());
+    }
+    if (close)
+    {
+        url_query += close;
+    }
+    return *this;
+}
+
 int Supabase::_login_process()
 {
     int httpCode;
-    JsonDocument doc;
+    Lease lease(*this);
+    SupabaseHttpTransport *https = lease.conn->http;
+    RecursiveGuard auth(authLock);
     debugPrintln("Beginning to login..");
 
-    if (https.begin(client, hostname + "/auth/v1/token?grant_type=password"))
+    CallRetry call;
+    if (!_call_begin(call, true))
+    {
+        return SUPABASE_ERR_CIRCUIT_OPEN;
+    }
+    do
     {
-        https.addHeader("apikey", key);
-        https.addHeader("Content-Type", "application/json");
+        if (!https->begin(hostname + "/auth/v1/token?grant_type=password"))
+        {
+            return _call_end(call, SUPABASE_ERR_BEGIN);
+        }
+        https->addHeader("apikey", key);
+        https->addHeader("Content-Type", "application/json");
 
         String query = "{\"" + loginMethod + "\": \"" + phone_or_email + "\", \"password\": \"" + password + "\"}";
-        httpCode = https.POST(query);
+        CallStart start = _call_start(https);
+        httpCode = https->sendRequest("POST", query);
 
         if (httpCode > 0)
         {
-            String data = https.getString();
-            deserializeJson(doc, data);
-            if (doc.containsKey("access_token") && !doc["access_token"].isNull() && doc["access_token"].is<String>() && !doc["access_token"].as<String>().isEmpty())
+            String data = https->getString();
+            if (_token_response(data))
             {
-                USER_TOKEN = doc["access_token"].as<String>();
-                authTimeout = doc["expires_in"].as<int>() * 1000;
+                // From now on the session is kept alive with the refresh token
+                password = String();
+                sessionUser = _user_hash();
+                sessionRestored = false;
+                // Cached rows were read with another user's permissions
+                if (cache)
+                {
+                    cache->clear();
+                }
                 debugPrintln("Login Success");
-                debugPrintln(USER_TOKEN);
-                debugPrintln(data);
             }
             else
             {
@@ -68,37 +104,437 @@ int Supabase::_login_process()
         else
         {
             debugPrintln(phone_or_email);
-            debugPrintln(password);
 
             debugPrint("Login Failed : ");
             // debugPrintln(httpCode);
         }
 
-        https.end();
-        loginTime = millis();
+        https->end();
+        _record(https, SUPABASE_OP_LOGIN, httpCode, start, call.attempt > 1);
+    } while (_call_retry(call, httpCode));
+
+    return _call_end(call, httpCode);
+}
+
+int Supabase::_refresh_process()
+{
+    Lease lease(*this);
+    SupabaseHttpTransport *https = lease.conn->http;
+    RecursiveGuard auth(authLock);
+    refreshQueued = false;
+    // Whoever held the lock before may have refreshed already
+    if (millis() - loginTime < refreshAfter)
+    {
+        return 200;
     }
-    else
+    if (refreshToken.length() == 0)
     {
-        return -100;
+        // Only while the first login has not succeeded yet
+        return password.length() > 0 ? _login_process() : SUPABASE_ERR_AUTH;
     }
 
+    debugPrintln("Refreshing access token..");
+    // Refresh tokens are single-use: only resent if it never went out
+    CallRetry call;
+    if (!_call_begin(call, false))
+    {
+        return SUPABASE_ERR_CIRCUIT_OPEN;
+    }
+    int httpCode;
+    do
+    {
+        if (!https->begin(hostname + "/auth/v1/token?grant_type=refresh_token"))
+        {
+            return _call_end(call, SUPABASE_ERR_BEGIN);
+        }
+        https->addHeader("apikey", key);
+        https->addHeader("Content-Type", "application/json");
+        CallStart start = _call_start(https);
+        httpCode = https->sendRequest("POST", "{\"refresh_token\": \"" + refreshToken + "\"}");
+        if (httpCode > 0)
+        {
+            String data = https->getString();
+            if (_token_response(data))
+            {
+                // Kept by a login that resumed a saved session, not needed now
+                password = String();
+            }
+            else if (httpCode >= 400 && httpCode < 500)
+            {
+                // Revoked or already used: stop retrying, a new login is needed
+                debugPrintln("Token refresh rejected, call login_email()/login_phone() again");
+                refreshToken = String();
+            }
+        }
+        https->end();
+        _record(https, SUPABASE_OP_LOGIN, httpCode, start, call.attempt > 1);
+    } while (_call_retry(call, httpCode));
+    httpCode = _call_end(call, httpCode);
+    // A restored refresh token spent after it was saved: the password of
+    // the login that resumed it is still there for this
+    if (refreshToken.length() == 0 && password.length() > 0)
+    {
+        return _login_process();
+    }
     return httpCode;
 }
 
+bool Supabase::_token_response(const String &data)
+{
+    JsonDocument doc;
+    if (deserializeJson(doc, data))
+    {
+        return false;
+    }
+    const char *token = doc["access_token"];
+    if (token == nullptr || *token == '\0')
+    {
+        return false;
+    }
+
+    xSemaphoreTake(tokenLock, portMAX_DELAY);
+    USER_TOKEN = token;
+    xSemaphoreGive(tokenLock);
+
+    refreshToken = doc["refresh_token"] | "";
+    authTimeout = doc["expires_in"].as<unsigned long>() * 1000;
+    // Refresh in the background once 90% of the lifetime has passed
+    refreshAfter = authTimeout - authTimeout / 10;
+    loginTime = millis();
+    realtimeTokenPending = true;
+    return true;
+}
+
+bool Supabase::_auth_check()
+{
+    if (!useAuth)
+    {
+        return true;
+    }
+    unsigned long age = millis() - loginTime;
+    if (age >= authTimeout)
+    {
+        // Expired (e.g. after a long idle period): refresh inline. Requests
+        // waiting on `authLock` find the new token and skip theirs. Without
+        // a new one the request would only earn a 401
+        int httpCode = _refresh_process();
+        return httpCode >= 200 && httpCode < 300;
+    }
+    if (age >= refreshAfter && !refreshQueued)
+    {
+        // Still valid: this request goes out with it, the refresh runs on
+        // the worker task afterwards. Set first: the worker may run
+        // `_refresh_process()` before `submit()` returns
+        refreshQueued = true;
+        SupabaseAsync *engine = _async_engine();
+        SupabaseAsyncRequest *request = engine ? engine->submit(SUPABASE_ASYNC_REFRESH, String(), String(), nullptr, nullptr, 0) : nullptr;
+        if (request)
+        {
+            engine->release(request);
+        }
+        else
+        {
+            refreshQueued = false;
+        }
+    }
+    return true;
+}
+
+void Supabase::_auth_header(SupabaseHttpTransport *https)
+{
+    if (useAuth)
+    {
+        https->addHeader("Authorization", "Bearer " + _access_token());
+    }
+}
+
+String Supabase::_access_token()
+{
+    xSemaphoreTake(tokenLock, portMAX_DELAY);
+    String token = USER_TOKEN;
+    xSemaphoreGive(tokenLock);
+    return token;
+}
+
+SupabaseAsync *Supabase::_async_engine()
+{
+    // Requests of two tasks may both be the first to need it
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    if (asyncEngine == nullptr)
+    {
+        asyncEngine = new SupabaseAsync(*this);
+    }
+    bool running = asyncEngine->running() || asyncEngine->begin();
+    xSemaphoreGive(stateLock);
+    return running ? asyncEngine : nullptr;
+}
+
 Supabase::Supabase()
 {
     initialized = false;
     realtimeInitialized = false;
     realtimeStarted = false;
+    realtimeConnected = false;
+    realtimeDropped = false;
+    realtimeRequest = REALTIME_KEEP;
+    realtimeLegacy = -1;
+    realtimeRef = 0;
+    for (int i = 0; i < SUPABASE_MAX_CHANNELS; i++)
+    {
+        channels[i].state = CHANNEL_FREE;
+        channels[i].handler = nullptr;
+        channels[i].broadcast = false;
+        channels[i].ackHandler = nullptr;
+    }
+    heartbeatInterval = 30000;
+    heartbeatMaxMissed = 2;
+    heartbeatRef = 0;
+    heartbeatMissed = 0;
+    backoffMin = 1000;
+    backoffMax = 60000;
+    reconnectAttempt = 0;
+    reconnectPending = false;
+    memset(&realtimeStats, 0, sizeof(realtimeStats));
+    metrics.reset();
+    metricsLock = xSemaphoreCreateMutex();
+    for (int i = 0; i < SUPABASE_BROADCAST_QUEUE; i++)
+    {
+        outgoing[i].state = Outgoing::FREE;
+    }
+    broadcastId = 0;
+    broadcastSeq = 0;
+    broadcastLock = xSemaphoreCreateMutex();
+    memset(&status, 0, sizeof(status));
+    breakerFailures = 0;
+    breakerOpen = false;
+    breakerOpenedAt = 0;
     realtimeTXTHandler = nullptr;
-    globalSupabase = this;
+    webSocket = &defaultSocket;
+    memset(pool, 0, sizeof(pool));
+    poolSize = 0;
+    idleTimeout = 0;
+    poolFree = nullptr;
+    poolLock = xSemaphoreCreateMutex();
+    _set_pool(nullptr, 1);
+    authLock = xSemaphoreCreateRecursiveMutex();
+    stateLock = xSemaphoreCreateMutex();
+    tokenLock = xSemaphoreCreateMutex();
+    useAuth = false;
+    loginTime = 0;
+    refreshAfter = 0;
+    refreshQueued = false;
+    realtimeTokenPending = false;
+    asyncEngine = nullptr;
+    journal = nullptr;
+    cache = nullptr;
+    nextTtl = -1;
+    resultCount = -1;
+    gzipResponses = false;
+    gzipRequestMin = 0;
+    replayQueued = false;
+    replayFailedAt = 0;
+    warmStart = nullptr;
+    warmSleptMs = 0;
+    sessionUser = 0;
+    sessionRestored = false;
+    if (globalSupabase == nullptr)
+    {
+        globalSupabase = this;
+    }
+}
+
+Supabase::~Supabase()
+{
+    delete asyncEngine;
+    // Closes the connections and frees the ones the pool created
+    _set_pool(nullptr, 0);
+    vSemaphoreDelete(poolLock);
+    vSemaphoreDelete(authLock);
+    vSemaphoreDelete(stateLock);
+    vSemaphoreDelete(tokenLock);
+    vSemaphoreDelete(metricsLock);
+    vSemaphoreDelete(broadcastLock);
+    if (globalSupabase == this)
+    {
+        globalSupabase = nullptr;
+    }
+}
+
+void Supabase::setTransport(SupabaseHttpTransport *transport)
+{
+    if (transport)
+    {
+        _set_pool(&transport, 1);
+    }
+    else
+    {
+        _set_pool(nullptr, 1);
+    }
+}
+
+void Supabase::setTransports(SupabaseHttpTransport *const *transports, uint8_t count)
+{
+    _set_pool(transports, count);
+}
+
+void Supabase::_set_pool(SupabaseHttpTransport *const *transports, uint8_t count)
+{
+    if (count > SUPABASE_MAX_CONNECTIONS)
+    {
+        count = SUPABASE_MAX_CONNECTIONS;
+    }
+    for (uint8_t i = 0; i < SUPABASE_MAX_CONNECTIONS; i++)
+    {
+        Connection &conn = pool[i];
+        SupabaseHttpTransport *http = nullptr;
+        bool owned = false;
+        if (i < count)
+        {
+            if (transports && transports[i])
+            {
+                http = transports[i];
+            }
+            else if (i == 0)
+            {
+                http = &defaultHttp;
+            }
+            else
+            {
+                // A connection created earlier is kept with its session
+                http = conn.owned ? conn.http : new SupabaseDefaultHttp();
+                owned = true;
+            }
+        }
+        if (conn.http && conn.http != http)
+        {
+            conn.http->stop();
+            if (conn.owned)
+            {
+                delete conn.http;
+            }
+        }
+        if (http != conn.http)
+        {
+            delete conn.inflater;
+            conn.inflater = nullptr;
+            if (http)
+            {
+                if (idleTimeout)
+                {
+                    http->setIdleTimeout(idleTimeout);
+                }
+                if (initialized)
+                {
+                    http->setInsecure();
+                }
+            }
+        }
+        conn.http = http;
+        conn.owned = owned;
+        conn.depth = 0;
+        conn.stopPending = false;
+    }
+    if (poolFree == nullptr || count != poolSize)
+    {
+        if (poolFree)
+        {
+            vSemaphoreDelete(poolFree);
+        }
+        poolFree = count ? xSemaphoreCreateCounting(count, count) : nullptr;
+    }
+    poolSize = count;
+}
+
+Supabase::Connection *Supabase::_acquire()
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    xSemaphoreTake(poolLock, portMAX_DELAY);
+    for (uint8_t i = 0; i < poolSize; i++)
+    {
+        if (pool[i].depth && pool[i].owner == self)
+        {
+            // Nested call (login before a request): same connection
+            pool[i].depth++;
+            xSemaphoreGive(poolLock);
+            return &pool[i];
+        }
+    }
+    xSemaphoreGive(poolLock);
+
+    xSemaphoreTake(poolFree, portMAX_DELAY);
+    xSemaphoreTake(poolLock, portMAX_DELAY);
+    // The lowest idle one: its keep-alive connection is the most likely
+    // to still be open
+    Connection *conn = &pool[0];
+    for (uint8_t i = 0; i < poolSize; i++)
+    {
+        if (pool[i].depth == 0)
+        {
+            conn = &pool[i];
+            break;
+        }
+    }
+    conn->owner = self;
+    conn->depth = 1;
+    xSemaphoreGive(poolLock);
+    return conn;
+}
+
+void Supabase::_release(Connection *conn)
+{
+    xSemaphoreTake(poolLock, portMAX_DELAY);
+    if (--conn->depth == 0)
+    {
+        conn->owner = nullptr;
+        if (conn->stopPending)
+        {
+            conn->stopPending = false;
+            conn->http->stop();
+        }
+        xSemaphoreGive(poolFree);
+    }
+    xSemaphoreGive(poolLock);
+}
+
+SupabaseConnectionStats Supabase::getConnectionStats()
+{
+    SupabaseConnectionStats total;
+    memset(&total, 0, sizeof(total));
+    for (uint8_t i = 0; i < poolSize; i++)
+    {
+        const SupabaseConnectionStats &conn = pool[i].http->stats();
+        total.requests += conn.requests;
+        total.reused += conn.reused;
+        total.handshakes += conn.handshakes;
+        total.resumed += conn.resumed;
+        total.drops += conn.drops;
+        total.bytesSent += conn.bytesSent;
+        total.bytesReceived += conn.bytesReceived;
+    }
+    return total;
+}
+
+void Supabase::setIdleTimeout(unsigned long ms)
+{
+    idleTimeout = ms;
+    for (uint8_t i = 0; i < poolSize; i++)
+    {
+        pool[i].http->setIdleTimeout(ms);
+    }
+}
+
+void Supabase::setSocketTransport(SupabaseSocketTransport *transport)
+{
+    webSocket = transport ? transport : &defaultSocket;
 }
 
 void Supabase::begin(String hostname_a, String key_a, Stream* debugSerial_a)
 {
     hostname = hostname_a;
+    restPrefix = hostname + "/rest/v1/";
     key = key_a;
     debugSerial = debugSerial_a;
+    _warm_restore();
     WiFi.onEvent(std::bind(&Supabase::onWiFiEvent, this, std::placeholders::_1, std::placeholders::_2));
     initialized = true;
 
@@ -107,6 +543,123 @@ void Supabase::begin(String hostname_a, String key_a, Stream* debugSerial_a)
     }
 }
 
+// Changes with the layout, so a record of another build is ignored
+static const uint32_t warmMagic = 0x53425701u ^ (uint32_t)sizeof(SupabaseWarmStart);
+
+static uint32_t warmCheck(const SupabaseWarmStart &state)
+{
+    const size_t from = offsetof(SupabaseWarmStart, project);
+    return supabaseCrc32(0, (const uint8_t *)&state + from, sizeof(state) - from);
+}
+
+uint32_t Supabase::_project_hash()
+{
+    uint32_t hash = supabaseCrc32(0, (const uint8_t *)hostname.c_str(), hostname.length());
+    return supabaseCrc32(hash, (const uint8_t *)key.c_str(), key.length());
+}
+
+uint32_t Supabase::_user_hash()
+{
+    uint32_t hash = supabaseCrc32(0, (const uint8_t *)loginMethod.c_str(), loginMethod.length());
+    hash = supabaseCrc32(hash, (const uint8_t *)phone_or_email.c_str(), phone_or_email.length());
+    // 0 stands for no session
+    return hash ? hash : 1;
+}
+
+void Supabase::setWarmStart(SupabaseWarmStart *state, unsigned long sleptMs)
+{
+    warmStart = state;
+    warmSleptMs = sleptMs;
+}
+
+void Supabase::_warm_restore()
+{
+    SupabaseWarmStart *w = warmStart;
+    if (w == nullptr)
+    {
+        return;
+    }
+    if (w->magic != warmMagic || w->check != warmCheck(*w) || w->project != _project_hash())
+    {
+        debugPrintln("Warm start: no saved state");
+        return;
+    }
+    for (uint8_t i = 0; i < poolSize; i++)
+    {
+        pool[i].http->restoreState(w->transport);
+    }
+    if (w->user == 0 || w->refreshToken[0] == '\0')
+    {
+        return;
+    }
+
+    // The clock keeps running through deep sleep on ESP32, not on ESP8266,
+    // where `sleptMs` has to tell. A clock that went back tells nothing:
+    // without `sleptMs` the token then counts as expired
+    uint64_t slept = warmSleptMs;
+    uint32_t now = (uint32_t)time(nullptr);
+    bool clockRan = now >= w->savedAt;
+    if (clockRan && (uint64_t)(now - w->savedAt) * 1000 > slept)
+    {
+        slept = (uint64_t)(now - w->savedAt) * 1000;
+    }
+    unsigned long age = w->tokenLifetime;
+    if ((clockRan || warmSleptMs) && w->accessToken[0] && slept < w->tokenLeft)
+    {
+        age = w->tokenLifetime - w->tokenLeft + (unsigned long)slept;
+    }
+
+    RecursiveGuard auth(authLock);
+    xSemaphoreTake(tokenLock, portMAX_DELAY);
+    USER_TOKEN = w->accessToken;
+    xSemaphoreGive(tokenLock);
+    refreshToken = w->refreshToken;
+    authTimeout = w->tokenLifetime;
+    refreshAfter = authTimeout - authTimeout / 10;
+    // Wraps around right after boot, `millis() - loginTime` is still the age
+    loginTime = millis() - age;
+    useAuth = true;
+    sessionUser = w->user;
+    sessionRestored = true;
+    realtimeTokenPending = true;
+    debugPrintln(age < authTimeout ? "Warm start: session restored" : "Warm start: session restored, refresh due");
+}
+
+bool Supabase::saveWarmStart()
+{
+    SupabaseWarmStart *w = warmStart;
+    if (w == nullptr)
+    {
+        return false;
+    }
+    memset(w, 0, sizeof(*w));
+    w->project = _project_hash();
+    // Not while a call uses it. Any connection's session will do: on wake
+    // it is restored into all of them
+    Lease lease(*this);
+    lease.conn->http->saveState(w->transport);
+
+    // Not while a refresh replaces the tokens; after the connection
+    RecursiveGuard auth(authLock);
+    String token = _access_token();
+    if (useAuth && sessionUser && refreshToken.length() > 0 && refreshToken.length() < sizeof(w->refreshToken))
+    {
+        w->user = sessionUser;
+        memcpy(w->refreshToken, refreshToken.c_str(), refreshToken.length());
+        w->tokenLifetime = authTimeout;
+        unsigned long age = millis() - loginTime;
+        if (age < authTimeout && token.length() < sizeof(w->accessToken))
+        {
+            memcpy(w->accessToken, token.c_str(), token.length());
+            w->tokenLeft = authTimeout - age;
+        }
+    }
+    w->savedAt = (uint32_t)time(nullptr);
+    w->magic = warmMagic;
+    w->check = warmCheck(*w);
+    return true;
+}
+
 void Supabase::onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
 {
     switch (event)
@@ -124,401 +677,1928 @@ void Supabase::onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
 
 void Supabase::connect() {
     if (initialized) {
-        client.setInsecure();
+        for (uint8_t i = 0; i < poolSize; i++) {
+            pool[i].http->setInsecure();
+        }
     }
     if (realtimeInitialized) {
-        subscribeToRealtime();
+        // Opened by `realtimeLoop()`: this may run on the WiFi event task
+        realtimeRequest = REALTIME_OPEN;
     }
+    // Writes stored while offline go out first
+    replayFailedAt = 0;
+    _schedule_replay();
 }
 
 void Supabase::disconnect() {
-    client.stop();
+    // Idle connections are closed now, busy ones by their task when done
+    xSemaphoreTake(poolLock, portMAX_DELAY);
+    for (uint8_t i = 0; i < poolSize; i++) {
+        if (pool[i].depth) {
+            pool[i].stopPending = true;
+        } else {
+            pool[i].http->stop();
+        }
+    }
+    xSemaphoreGive(poolLock);
 
-    if (realtimeStarted) {
-        unsubscribeFromRealtime();
+    if (realtimeInitialized) {
+        realtimeRequest = REALTIME_CLOSE;
     }
 }
 
 
-void Supabase::beginRealtime(int port, String table, String id)
+void Supabase::beginRealtime(int port)
 {
     realtimePort = port;
-    realtimeTable = table;
-    realtimeId = id;
 
-    realtimeConfigJson = 
-    "{"
-        "\"event\": \"phx_join\","
-        "\"topic\": \"realtime:[channel-name]\","
-        "\"payload\": {"
-            "\"config\": {"
-                "\"broadcast\": {"
-                    "\"self\": false"
-                "},"
-                "\"presence\": {"
-                    "\"key\": \"\""
-                "},"
-                "\"postgres_changes\": ["
-                    "{"
-                        "\"event\": \"*\","
-                        "\"schema\": \"public\","
-                        "\"table\": \"" + table + "\","
-                        "\"filter\": \"id=eq." + id + "\""
-                    "}"
-                "]"
-            "}"
-        "},"
-        "\"ref\": \"sentRef\""
-    "}";
-
-    realtimeHeartbeatJson = 
-    "{"
-        "\"event\": \"heartbeat\","
-        "\"topic\": \"phoenix\","
-        "\"payload\": {},"
-        "\"ref\": \"\""
-    "}";
+    _realtimeFilter();
 
     realtimeInitialized = true;
 
-    if (initialized && WiFi.status() == WL_CONNECTED) {
+    if (initialized && WiFi.status() == WL_CONNECTED && !realtimeStarted) {
         subscribeToRealtime();
     }
-    
 }
 
-void Supabase::subscribeToRealtime() {
-    if (!realtimeInitialized) {
-        debugPrintln("Realtime not initialized! Call `beginRealtime` first");
-        return;
-    }
-    String pureHostname = hostname;
-    if (pureHostname.startsWith("https://")) {
-        // Remove "https://" string from the `hostname` (if exists)
-        pureHostname = pureHostname.substring(8);
+void Supabase::beginRealtime(int port, String table, String id)
+{
+    realtimeTable = table;
+    realtimeId = id;
+
+    if (realtimeLegacy >= 0) {
+        unsubscribe(realtimeLegacy);
     }
-    webSocket.beginSSL(
-        pureHostname,
-        realtimePort,
-        "/realtime/v1/websocket?apikey=" + key + "&vsn=1.0.0");
-    webSocket.onEvent(webSocketEvent);
-    realtimeStarted = true;
+    // Frames reach `realtimeTXTHandler`, which sees every frame anyway
+    realtimeLegacy = subscribe(table, "id=eq." + id, nullptr);
+
+    beginRealtime(port);
 }
 
-void Supabase::unsubscribeFromRealtime()
+void Supabase::setHeartbeat(unsigned long intervalMs, uint8_t maxMissed)
 {
-    webSocket.disconnect();
-    realtimeStarted = false;
-    
-    if (heartbeat_timer != NULL) {
-        esp_timer_stop(heartbeat_timer);
-        esp_timer_delete(heartbeat_timer);
-        heartbeat_timer = NULL;
-    }
+    heartbeatInterval = intervalMs;
+    heartbeatMaxMissed = maxMissed ? maxMissed : 1;
 }
 
-void Supabase::webSocketEvent(WStype_t type, uint8_t *payload, size_t length)
+void Supabase::setReconnectBackoff(unsigned long minMs, unsigned long maxMs)
 {
+    backoffMin = minMs ? minMs : 1;
+    backoffMax = maxMs < backoffMin ? backoffMin : maxMs;
+}
 
-    switch (type)
+int Supabase::subscribe(const String &table, const String &filter, SupabaseChangeHandler handler, void *ctx,
+                        const String &event, const String &schema, const String &columns)
+{
+    for (int i = 0; i < SUPABASE_MAX_CHANNELS; i++)
     {
-    case WStype_DISCONNECTED:
-        // debugPrintf("[WSc] Disconnected!\n");
-        // Stop the timer
-        if (heartbeat_timer != NULL)
+        RealtimeChannel &channel = channels[i];
+        if (channel.state != CHANNEL_FREE)
         {
-            esp_timer_stop(heartbeat_timer);
-            esp_timer_delete(heartbeat_timer);
-            heartbeat_timer = NULL;
+            continue;
         }
-        break;
-    case WStype_CONNECTED:
-        // debugPrintf("[WSc] Connected to url: %s\n", payload);
-        // Create periodic timer to send heartbeat message
-        esp_timer_create_args_t timer_args;
-        timer_args.callback = &heartbeat;
-        timer_args.arg = nullptr;
-        timer_args.dispatch_method = ESP_TIMER_TASK;
-        timer_args.name = "heartbeat_timer";
-        esp_timer_create(&timer_args, &heartbeat_timer);
-        esp_timer_start_periodic(heartbeat_timer, 30 * 1000000);
-        // send message to server when Connected
-        webSocket.sendTXT(realtimeConfigJson);
-        break;
-    case WStype_TEXT:
-        // debugPrintf("[WSc] get text: %s\n", payload);
-        if (realtimeTXTHandler != nullptr)
+        // Joined from `realtimeLoop()`, so all socket writes stay on its task
+        channel.state = CHANNEL_JOIN;
+        // A fresh topic per subscription, so late frames of a removed one
+        // never reach its successor in the same slot
+        channel.topic = "realtime:sub" + String(++realtimeRef);
+        channel.table = table;
+        channel.filter = filter;
+        channel.event = event;
+        channel.schema = schema;
+        channel.columns = columns;
+        channel.handler = handler;
+        channel.ctx = ctx;
+        channel.broadcast = false;
+        channel.self = false;
+        channel.ackHandler = nullptr;
+        _realtimeFilter();
+        return i;
+    }
+    debugPrintln("subscribe: no free realtime channel (SUPABASE_MAX_CHANNELS)");
+    return -1;
+}
+
+int Supabase::subscribeBroadcast(const String &name, SupabaseChangeHandler handler, void *ctx,
+                                 SupabaseAckHandler ackHandler, bool self)
+{
+    // Peers meet on the topic: it is the channel name, not a fresh one
+    String topic = "realtime:" + name;
+    int slot = -1;
+    for (int i = 0; i < SUPABASE_MAX_CHANNELS; i++)
+    {
+        RealtimeChannel &channel = channels[i];
+        if (channel.state == CHANNEL_FREE)
         {
-            realtimeTXTHandler(payload, length);
+            slot = slot < 0 ? i : slot;
         }
-        break;
-    default:
-        // debugPrintf("[WSc] unknown type: %s\n", payload);
-        break;
+        else if (channel.state != CHANNEL_LEAVE && channel.topic == topic)
+        {
+            debugPrintln("subscribeBroadcast: channel already joined");
+            return -1;
+        }
+    }
+    if (slot < 0)
+    {
+        debugPrintln("subscribeBroadcast: no free realtime channel (SUPABASE_MAX_CHANNELS)");
+        return -1;
     }
+    RealtimeChannel &channel = channels[slot];
+    channel.state = CHANNEL_JOIN;
+    channel.topic = topic;
+    channel.table = name;
+    channel.filter = String();
+    channel.event = String();
+    channel.schema = String();
+    channel.columns = String();
+    channel.handler = handler;
+    channel.ctx = ctx;
+    channel.self = self;
+    channel.ackHandler = ackHandler;
+    // Last: from here on `broadcast()` of other tasks queues for it
+    xSemaphoreTake(broadcastLock, portMAX_DELAY);
+    channel.broadcast = true;
+    xSemaphoreGive(broadcastLock);
+    _realtimeFilter();
+    return slot;
 }
 
-void Supabase::heartbeat(void *arg)
+int Supabase::broadcast(int subscription, const String &event, const String &json)
 {
-    // debugPrintln("[WS] Sending Heartbeat message");
-    
-    webSocket.sendTXT(realtimeHeartbeatJson);
+    if (subscription < 0 || subscription >= SUPABASE_MAX_CHANNELS)
+    {
+        return SUPABASE_ERR_CHANNEL;
+    }
+    // Under the lock `unsubscribe()` changes the state with: nothing is
+    // queued for a channel that is going away
+    xSemaphoreTake(broadcastLock, portMAX_DELAY);
+    const RealtimeChannel &channel = channels[subscription];
+    if (!channel.broadcast || channel.state == CHANNEL_FREE || channel.state == CHANNEL_LEAVE)
+    {
+        xSemaphoreGive(broadcastLock);
+        return SUPABASE_ERR_CHANNEL;
+    }
+    int id = SUPABASE_ERR_QUEUE_FULL;
+    for (int i = 0; i < SUPABASE_BROADCAST_QUEUE; i++)
+    {
+        Outgoing &message = outgoing[i];
+        if (message.state != Outgoing::FREE)
+        {
+            continue;
+        }
+        // Positive, so it never reads as an error code
+        broadcastId = broadcastId < 0x7FFFFFFF ? broadcastId + 1 : 1;
+        id = broadcastId;
+        message.state = Outgoing::QUEUED;
+        message.subscription = subscription;
+        message.id = id;
+        message.seq = broadcastSeq++;
+        message.event = event;
+        message.json = json;
+        break;
+    }
+    xSemaphoreGive(broadcastLock);
+    if (id < 0)
+    {
+        debugPrintln("broadcast: queue full (SUPABASE_BROADCAST_QUEUE)");
+    }
+    return id;
+}
+
+void Supabase::_broadcastFlush()
+{
+    while (true)
+    {
+        // Oldest first, one at a time: the lock is not held while writing
+        xSemaphoreTake(broadcastLock, portMAX_DELAY);
+        Outgoing *next = nullptr;
+        for (int i = 0; i < SUPABASE_BROADCAST_QUEUE; i++)
+        {
+            Outgoing &message = outgoing[i];
+            // Wraps around: compared by their distance
+            if (message.state == Outgoing::QUEUED && channels[message.subscription].state == CHANNEL_JOINED &&
+                (next == nullptr || (int32_t)(message.seq - next->seq) < 0))
+            {
+                next = &message;
+            }
+        }
+        if (next == nullptr)
+        {
+            xSemaphoreGive(broadcastLock);
+            return;
+        }
+        const RealtimeChannel &channel = channels[next->subscription];
+        next->ref = ++realtimeRef;
+        next->sentAt = millis();
+
+        JsonDocument doc;
+        doc["event"] = "broadcast";
+        doc["topic"] = channel.topic;
+        doc["payload"]["type"] = "broadcast";
+        doc["payload"]["event"] = next->event;
+        doc["payload"]["payload"] = serialized(next->json);
+        doc["ref"] = String(next->ref);
+        String frame;
+        serializeJson(doc, frame);
+
+        // Kept until the write succeeded, `broadcast()` does not reuse it
+        next->state = Outgoing::SENT;
+        unsigned long ref = next->ref;
+        bool acked = channel.ackHandler != nullptr;
+        xSemaphoreGive(broadcastLock);
+
+        bool sent = _realtimeSend(frame);
+
+        xSemaphoreTake(broadcastLock, portMAX_DELAY);
+        // Unless `unsubscribe()` dropped it meanwhile
+        if (next->state == Outgoing::SENT && next->ref == ref)
+        {
+            if (!sent)
+            {
+                // Goes out again, in its place, once the socket is back
+                next->state = Outgoing::QUEUED;
+            }
+            else
+            {
+                // Without an ack there is nothing more to wait for
+                if (!acked)
+                {
+                    next->state = Outgoing::FREE;
+                }
+                next->event = String();
+                next->json = String();
+            }
+        }
+        if (sent)
+        {
+            realtimeStats.broadcasts++;
+        }
+        xSemaphoreGive(broadcastLock);
+        if (!sent)
+        {
+            return;
+        }
+    }
+}
+
+void Supabase::_broadcastExpire(int subscription, bool lost, bool dropQueued)
+{
+    unsigned long now = millis();
+    for (int i = 0; i < SUPABASE_BROADCAST_QUEUE; i++)
+    {
+        xSemaphoreTake(broadcastLock, portMAX_DELAY);
+        Outgoing &message = outgoing[i];
+        bool mine = message.state != Outgoing::FREE && (subscription < 0 || message.subscription == subscription);
+        bool failed = mine && message.state == Outgoing::SENT && (lost || now - message.sentAt >= SUPABASE_BROADCAST_ACK_TIMEOUT);
+        bool dropped = mine && message.state == Outgoing::QUEUED && dropQueued;
+        int sub = message.subscription;
+        int id = message.id;
+        SupabaseAckHandler handler = nullptr;
+        void *ctx = nullptr;
+        if (failed || dropped)
+        {
+            message.state = Outgoing::FREE;
+            message.event = String();
+            message.json = String();
+            handler = channels[sub].ackHandler;
+            ctx = channels[sub].ctx;
+            if (handler)
+            {
+                realtimeStats.broadcastsFailed++;
+            }
+        }
+        xSemaphoreGive(broadcastLock);
+
+        // Outside the lock: the handler may queue the message again
+        if (handler)
+        {
+            handler(sub, id, false, ctx);
+        }
+    }
+}
+
+void Supabase::_broadcastAck(int subscription, unsigned long ref, bool ok)
+{
+    int id = -1;
+    SupabaseAckHandler handler = nullptr;
+    void *ctx = nullptr;
+    xSemaphoreTake(broadcastLock, portMAX_DELAY);
+    for (int i = 0; i < SUPABASE_BROADCAST_QUEUE; i++)
+    {
+        Outgoing &message = outgoing[i];
+        if (message.state == Outgoing::SENT && message.subscription == subscription && message.ref == ref)
+        {
+            message.state = Outgoing::FREE;
+            id = message.id;
+            handler = channels[subscription].ackHandler;
+            ctx = channels[subscription].ctx;
+            if (handler && !ok)
+            {
+                realtimeStats.broadcastsFailed++;
+            }
+            break;
+        }
+    }
+    xSemaphoreGive(broadcastLock);
+
+    // Replies to joins and token updates match no message
+    if (handler)
+    {
+        handler(subscription, id, ok, ctx);
+    }
+}
+
+bool Supabase::unsubscribe(int subscription)
+{
+    if (subscription < 0 || subscription >= SUPABASE_MAX_CHANNELS)
+    {
+        return false;
+    }
+    RealtimeChannel &channel = channels[subscription];
+    if (channel.state == CHANNEL_FREE || channel.state == CHANNEL_LEAVE)
+    {
+        return false;
+    }
+    // Never joined: nothing to tell the server. Under the lock
+    // `broadcast()` checks it with, so nothing is queued after the expiry
+    xSemaphoreTake(broadcastLock, portMAX_DELAY);
+    channel.state = channel.state == CHANNEL_JOIN ? CHANNEL_FREE : CHANNEL_LEAVE;
+    channel.broadcast = false;
+    xSemaphoreGive(broadcastLock);
+    // Its messages will never be sent or acknowledged
+    _broadcastExpire(subscription, true, true);
+    channel.handler = nullptr;
+    channel.ackHandler = nullptr;
+    if (subscription == realtimeLegacy)
+    {
+        realtimeLegacy = -1;
+    }
+    _realtimeFilter();
+    return true;
+}
+
+void Supabase::_realtimeFilter()
+{
+    // Routing fields, plus the union of the record columns the handlers
+    // asked for. Everything else (e.g. the `columns` type list) is skipped
+    // by the parser without being stored
+    realtimeFilter.clear();
+    realtimeFilter["topic"] = true;
+    realtimeFilter["event"] = true;
+    realtimeFilter["ref"] = true;
+    realtimeFilter["payload"]["status"] = true;
+    JsonObject data = realtimeFilter["payload"]["data"].to<JsonObject>();
+    data["type"] = true;
+    data["schema"] = true;
+    data["table"] = true;
+    data["commit_timestamp"] = true;
+
+    for (int i = 0; i < SUPABASE_MAX_CHANNELS; i++)
+    {
+        const RealtimeChannel &channel = channels[i];
+        if (channel.state != CHANNEL_FREE && channel.broadcast && channel.handler)
+        {
+            // Broadcast messages are kept whole: their payload is the peer's
+            realtimeFilter["payload"]["event"] = true;
+            realtimeFilter["payload"]["payload"] = true;
+            break;
+        }
+    }
+
+    for (int i = 0; i < SUPABASE_MAX_CHANNELS; i++)
+    {
+        const RealtimeChannel &channel = channels[i];
+        if (channel.state == CHANNEL_FREE || channel.broadcast || !channel.handler)
+        {
+            continue;
+        }
+        if (channel.columns.length() == 0)
+        {
+            data["record"] = true;
+            data["old_record"] = true;
+            return;
+        }
+        int start = 0;
+        while (start < (int)channel.columns.length())
+        {
+            int end = channel.columns.indexOf(',', start);
+            if (end < 0)
+            {
+                end = channel.columns.length();
+            }
+            String column = channel.columns.substring(start, end);
+            column.trim();
+            if (column.length() > 0)
+            {
+                data["record"][column] = true;
+                data["old_record"][column] = true;
+            }
+            start = end + 1;
+        }
+    }
+}
+
+void Supabase::_realtimeJoin(int subscription)
+{
+    const RealtimeChannel &channel = channels[subscription];
+    String ref(++realtimeRef);
+
+    JsonDocument doc;
+    doc["event"] = "phx_join";
+    doc["topic"] = channel.topic;
+    JsonObject config = doc["payload"]["config"].to<JsonObject>();
+    config["broadcast"]["self"] = channel.self;
+    if (channel.ackHandler)
+    {
+        config["broadcast"]["ack"] = true;
+    }
+    config["presence"]["key"] = "";
+    JsonArray changes = config["postgres_changes"].to<JsonArray>();
+    if (!channel.broadcast)
+    {
+        JsonObject change = changes.add<JsonObject>();
+        change["event"] = channel.event;
+        change["schema"] = channel.schema;
+        change["table"] = channel.table;
+        if (channel.filter.length() > 0)
+        {
+            change["filter"] = channel.filter;
+        }
+    }
+    if (useAuth)
+    {
+        doc["payload"]["access_token"] = _access_token();
+    }
+    doc["ref"] = ref;
+    doc["join_ref"] = ref;
+
+    String frame;
+    serializeJson(doc, frame);
+    _realtimeSend(frame);
+}
+
+bool Supabase::_realtimeSend(const String &frame)
+{
+    if (!webSocket->sendTXT(frame))
+    {
+        return false;
+    }
+    _count_realtime(frame.length(), 0);
+    return true;
+}
+
+void Supabase::_realtimeLeave(int subscription)
+{
+    String frame = "{\"event\":\"phx_leave\",\"topic\":\"" + channels[subscription].topic +
+                   "\",\"payload\":{},\"ref\":\"" + String(++realtimeRef) + "\"}";
+    _realtimeSend(frame);
+}
+
+void Supabase::_realtimeHeartbeat()
+{
+    unsigned long now = millis();
+    // Probe faster while a reply is missing, so a dead link is found in
+    // about `interval + (maxMissed - 1) * interval / 4` instead of
+    // `maxMissed * interval`
+    unsigned long due = heartbeatMissed ? heartbeatInterval / 4 : heartbeatInterval;
+    if (heartbeatInterval == 0 || now - heartbeatSent < due)
+    {
+        return;
+    }
+    if (heartbeatRef != 0)
+    {
+        heartbeatMissed++;
+        realtimeStats.missed++;
+        _record_realtime(false, 0);
+        if (heartbeatMissed >= heartbeatMaxMissed)
+        {
+            debugPrintln("Realtime: heartbeat not answered, reconnecting");
+            _realtimeDrop();
+            return;
+        }
+    }
+    heartbeatRef = ++realtimeRef;
+    heartbeatSent = now;
+    heartbeatSentUs = micros();
+    _realtimeSend("{\"event\":\"heartbeat\",\"topic\":\"phoenix\",\"payload\":{},\"ref\":\"" +
+                       String(heartbeatRef) + "\"}");
+}
+
+void Supabase::_realtimeDrop()
+{
+    // Cleared first so the DISCONNECTED event of our own disconnect() is
+    // not taken for another drop
+    realtimeConnected = false;
+    realtimeDropped = false;
+    webSocket->disconnect();
+    // Acks of the old socket never come; unsent messages wait for the rejoin
+    _broadcastExpire(-1, true, false);
+    for (int i = 0; i < SUPABASE_MAX_CHANNELS; i++)
+    {
+        RealtimeChannel &channel = channels[i];
+        if (channel.state == CHANNEL_LEAVE)
+        {
+            channel.state = CHANNEL_FREE;
+        }
+        else if (channel.state != CHANNEL_FREE)
+        {
+            channel.state = CHANNEL_JOIN;
+        }
+    }
+
+    // Exponential backoff with jitter in [backoff / 2, backoff], so a fleet
+    // that lost the same server does not come back in lockstep
+    unsigned long backoff = backoffMin;
+    for (uint8_t i = 0; i < reconnectAttempt && backoff < backoffMax; i++)
+    {
+        backoff *= 2;
+    }
+    if (backoff > backoffMax)
+    {
+        backoff = backoffMax;
+    }
+    if (reconnectAttempt < 255)
+    {
+        reconnectAttempt++;
+    }
+    realtimeStats.connected = false;
+    realtimeStats.backoffMs = backoff / 2 + random(backoff / 2 + 1);
+    reconnectAt = millis() + realtimeStats.backoffMs;
+    reconnectPending = true;
+}
+
+void Supabase::_realtimeOpen()
+{
+    String pureHostname = hostname;
+    if (pureHostname.startsWith("https://")) {
+        // Remove "https://" string from the `hostname` (if exists)
+        pureHostname = pureHostname.substring(8);
+    }
+    webSocket->onEvent(webSocketEvent, this);
+    webSocket->begin(
+        pureHostname,
+        realtimePort,
+        "/realtime/v1/websocket?apikey=" + key + "&vsn=1.0.0");
+    connectStarted = millis();
+}
+
+void Supabase::_realtimeRoute(uint8_t *payload, size_t length)
+{
+    JsonDocument frame;
+    if (deserializeJson(frame, (const char *)payload, length, DeserializationOption::Filter(realtimeFilter)))
+    {
+        return;
+    }
+    const char *topic = frame["topic"];
+    if (topic == nullptr)
+    {
+        return;
+    }
+    JsonVariantConst event = frame["event"];
+
+    if (strcmp(topic, "phoenix") == 0)
+    {
+        const char *ref = frame["ref"] | "";
+        if (event == "phx_reply" && heartbeatRef != 0 && strtoul(ref, nullptr, 10) == heartbeatRef)
+        {
+            unsigned long rtt = micros() - heartbeatSentUs;
+            realtimeStats.rttUs = rtt;
+            // Moving average over ~8 heartbeats
+            realtimeStats.rttAvgUs = realtimeStats.rttAvgUs ? realtimeStats.rttAvgUs - realtimeStats.rttAvgUs / 8 + rtt / 8 : rtt;
+            realtimeStats.heartbeats++;
+            _record_realtime(true, rtt);
+            heartbeatRef = 0;
+            heartbeatMissed = 0;
+            // The link carried a full round trip: start backoff from scratch
+            reconnectAttempt = 0;
+        }
+        return;
+    }
+
+    for (int i = 0; i < SUPABASE_MAX_CHANNELS; i++)
+    {
+        RealtimeChannel &channel = channels[i];
+        if ((channel.state != CHANNEL_JOINING && channel.state != CHANNEL_JOINED) || !channel.topic.equals(topic))
+        {
+            continue;
+        }
+        if (event == "phx_reply")
+        {
+            if (channel.state == CHANNEL_JOINING)
+            {
+                if (frame["payload"]["status"] == "ok")
+                {
+                    channel.state = CHANNEL_JOINED;
+                }
+                else
+                {
+                    debugPrintf("Realtime: join of %s refused\n", channel.table.c_str());
+                }
+            }
+            else if (channel.broadcast)
+            {
+                _broadcastAck(i, strtoul(frame["ref"] | "", nullptr, 10), frame["payload"]["status"] == "ok");
+            }
+        }
+        else if (event == "broadcast")
+        {
+            if (!channel.broadcast || channel.handler == nullptr)
+            {
+                break;
+            }
+            JsonObjectConst payload = frame["payload"];
+            SupabaseChangeEvent message;
+            message.subscription = i;
+            message.type = SUPABASE_CHANGE_BROADCAST;
+            message.schema = "";
+            message.table = channel.table.c_str();
+            message.commitTimestamp = "";
+            message.record = payload["payload"];
+            message.event = payload["event"] | "";
+            channel.handler(message, channel.ctx);
+        }
+        else if (event == "phx_error" || event == "phx_close")
+        {
+            // Rejoined by the next `realtimeLoop()`
+            channel.state = CHANNEL_JOIN;
+        }
+        else if (event == "postgres_changes")
+        {
+            if (cache)
+            {
+                cache->invalidate(channel.table);
+            }
+            if (channel.handler == nullptr)
+            {
+                break;
+            }
+            JsonObjectConst data = frame["payload"]["data"];
+            const char *type = data["type"] | "";
+            SupabaseChangeEvent change;
+            change.subscription = i;
+            change.type = strcmp(type, "INSERT") == 0   ? SUPABASE_CHANGE_INSERT
+                          : strcmp(type, "UPDATE") == 0 ? SUPABASE_CHANGE_UPDATE
+                          : strcmp(type, "DELETE") == 0 ? SUPABASE_CHANGE_DELETE
+                                                        : SUPABASE_CHANGE_UNKNOWN;
+            change.schema = data["schema"] | "";
+            change.table = data["table"] | "";
+            change.commitTimestamp = data["commit_timestamp"] | "";
+            change.record = data["record"];
+            change.oldRecord = data["old_record"];
+            change.event = "";
+            channel.handler(change, channel.ctx);
+        }
+        break;
+    }
+}
+
+void Supabase::subscribeToRealtime() {
+    if (!realtimeInitialized) {
+        debugPrintln("Realtime not initialized! Call `beginRealtime` first");
+        return;
+    }
+    realtimeStarted = true;
+    reconnectPending = false;
+    _realtimeOpen();
+}
+
+void Supabase::unsubscribeFromRealtime()
+{
+    // Cleared first: this disconnect is not a drop to recover from
+    realtimeStarted = false;
+    realtimeConnected = false;
+    reconnectPending = false;
+    webSocket->disconnect();
+    realtimeStats.connected = false;
+    _broadcastExpire(-1, true, false);
+    for (int i = 0; i < SUPABASE_MAX_CHANNELS; i++)
+    {
+        RealtimeChannel &channel = channels[i];
+        if (channel.state == CHANNEL_LEAVE)
+        {
+            channel.state = CHANNEL_FREE;
+        }
+        else if (channel.state != CHANNEL_FREE)
+        {
+            channel.state = CHANNEL_JOIN;
+        }
+    }
+}
+
+void Supabase::webSocketEvent(void *ctx, SupabaseSocketEvent type, uint8_t *payload, size_t length)
+{
+    Supabase *self = (Supabase *)ctx;
+
+    switch (type)
+    {
+    case SUPABASE_SOCKET_DISCONNECTED:
+        // debugPrintf("[WSc] Disconnected!\n");
+        // Handled by `realtimeLoop()` once the socket's own loop returned
+        if (self->realtimeStarted && self->realtimeConnected)
+        {
+            self->realtimeDropped = true;
+        }
+        self->realtimeConnected = false;
+        break;
+    case SUPABASE_SOCKET_CONNECTED:
+        // debugPrintf("[WSc] Connected to url: %s\n", payload);
+        // Subscriptions are (re)joined by `realtimeLoop()`
+        self->realtimeConnected = true;
+        self->realtimeStats.connected = true;
+        self->realtimeStats.backoffMs = 0;
+        self->heartbeatSent = millis();
+        self->heartbeatRef = 0;
+        self->heartbeatMissed = 0;
+        break;
+    case SUPABASE_SOCKET_TEXT:
+        // debugPrintf("[WSc] get text: %s\n", payload);
+        if (self->realtimeTXTHandler != nullptr)
+        {
+            self->realtimeTXTHandler(payload, length);
+        }
+        self->_count_realtime(0, length);
+        self->_realtimeRoute(payload, length);
+        break;
+    default:
+        // debugPrintf("[WSc] unknown type: %s\n", payload);
+        break;
+    }
+}
+
+void Supabase::realtimeLoop()
+{
+    // From `connect()` / `disconnect()`, acted on here so that the socket
+    // is only touched by this task
+    uint8_t request = realtimeRequest;
+    realtimeRequest = REALTIME_KEEP;
+    if (request == REALTIME_OPEN) {
+        subscribeToRealtime();
+    } else if (request == REALTIME_CLOSE && realtimeStarted) {
+        unsubscribeFromRealtime();
+    }
+
+    if (!realtimeStarted) {
+        return;
+    }
+
+    if (reconnectPending) {
+        if ((long)(millis() - reconnectAt) < 0) {
+            return;
+        }
+        reconnectPending = false;
+        realtimeStats.reconnects++;
+        _realtimeOpen();
+    }
+
+    webSocket->loop();
+
+    if (realtimeDropped) {
+        _realtimeDrop();
+        return;
+    }
+    if (!realtimeConnected) {
+        // A connect attempt that hangs counts as a drop, so it backs off too
+        if (millis() - connectStarted >= SUPABASE_REALTIME_CONNECT_TIMEOUT) {
+            debugPrintln("Realtime: connect timed out");
+            _realtimeDrop();
+        }
+        return;
+    }
+
+    // Every socket write happens here, on the task that runs the loop
+    bool pushToken = realtimeTokenPending;
+    realtimeTokenPending = false;
+    String token = pushToken ? _access_token() : String();
+    for (int i = 0; i < SUPABASE_MAX_CHANNELS; i++)
+    {
+        RealtimeChannel &channel = channels[i];
+        if (channel.state == CHANNEL_JOIN)
+        {
+            channel.state = CHANNEL_JOINING;
+            _realtimeJoin(i);
+        }
+        else if (channel.state == CHANNEL_LEAVE)
+        {
+            channel.state = CHANNEL_FREE;
+            _realtimeLeave(i);
+        }
+        else if (pushToken && useAuth && channel.state != CHANNEL_FREE)
+        {
+            // Keeps the channel authorized past the old token's expiry
+            _realtimeSend("{\"event\":\"access_token\",\"topic\":\"" + channel.topic +
+                               "\",\"payload\":{\"access_token\":\"" + token + "\"},\"ref\":\"" +
+                               String(++realtimeRef) + "\"}");
+        }
+    }
+    _broadcastFlush();
+    _broadcastExpire(-1, false, false);
+    _realtimeHeartbeat();
+}
+
+String Supabase::getQuery()
+{
+    String temp = url_query;
+    urlQuery_reset();
+    return restPrefix + temp;
+}
+// query reset
+void Supabase::urlQuery_reset()
+{
+    url_query = "";
+    nextTtl = -1;
+}
+// membuat Query Builder
+Supabase &Supabase::Supabase::from(String table)
+{
+    url_query += (table + "?");
+    return *this;
+}
+
+int Supabase::insert(String table, String json, bool upsert)
+{
+    return insert(table, json.c_str(), json.length(), upsert);
+}
+
+int Supabase::insert(const String &table, const char *json, size_t length, bool upsert)
+{
+    return insert(table, json, length, upsert, preferDefaults);
+}
+
+int Supabase::insert(const String &table, const char *json, size_t length, bool upsert, const SupabasePrefer &prefer)
+{
+    return _write(upsert ? SUPABASE_JOURNAL_UPSERT : SUPABASE_JOURNAL_INSERT, table.c_str(), table.length(), json, length,
+                  prefer);
+}
+
+int Supabase::_insert(const char *table, const char *json, size_t length, bool upsert, const SupabasePrefer &prefer)
+{
+    int httpCode;
+    // Compressed before taking the lock: other requests need not wait
+    uint8_t *packed = nullptr;
+    size_t packedLength = 0;
+    if (gzipRequestMin && length >= gzipRequestMin && (packed = (uint8_t *)malloc(length)) != nullptr)
+    {
+        packedLength = supabaseGzip((const uint8_t *)json, length, packed, length);
+    }
+
+    String url = restPrefix + table;
+    if (upsert && prefer.onConflict)
+    {
+        url += "?on_conflict=";
+        url += prefer.onConflict;
+    }
+
+    Lease lease(*this);
+    SupabaseHttpTransport *https = lease.conn->http;
+    // Upserts can be repeated safely, plain inserts could duplicate rows
+    CallRetry call;
+    if (!_call_begin(call, upsert))
+    {
+        free(packed);
+        return SUPABASE_ERR_CIRCUIT_OPEN;
+    }
+    do
+    {
+        if (!_auth_check())
+        {
+            httpCode = SUPABASE_ERR_AUTH;
+            break;
+        }
+        if (!https->begin(url))
+        {
+            httpCode = SUPABASE_ERR_BEGIN;
+            break;
+        }
+        https->addHeader("apikey", key);
+        https->addHeader("Content-Type", "application/json");
+        _accept_gzip(https);
+        if (packedLength)
+        {
+            https->addHeader("Content-Encoding", "gzip");
+        }
+
+        _prefer_header(https, prefer, true, upsert);
+
+        _auth_header(https);
+        CallStart start = _call_start(https);
+        httpCode = packedLength ? https->sendRequest("POST", packed, packedLength)
+                                : https->sendRequest("POST", (const uint8_t *)json, length);
+        // Without a representation there is no body: nothing is allocated
+        _write_result(*lease.conn, prefer, httpCode);
+        https->end();
+        _record(https, SUPABASE_OP_INSERT, httpCode, start, call.attempt > 1);
+    } while (_call_retry(call, httpCode));
+    free(packed);
+    return _call_end(call, httpCode);
+}
+
+int Supabase::insertStream(const String &table, SupabaseBodyProducer producer, void *ctx, SupabaseBodyFormat format,
+                           bool upsert)
+{
+    return _insertStream(table, producer, ctx, format, upsert, preferDefaults);
+}
+
+int Supabase::insertStream(const String &table, SupabaseBodyProducer producer, void *ctx, SupabaseBodyFormat format,
+                           bool upsert, const SupabasePrefer &prefer)
+{
+    return _insertStream(table, producer, ctx, format, upsert, prefer);
+}
+
+struct StreamSource
+{
+    Stream *stream;
+    bool started;
+};
+
+static size_t readSource(uint8_t *buffer, size_t size, void *ctx)
+{
+    StreamSource *source = (StreamSource *)ctx;
+    int available = source->stream->available();
+    if (available <= 0)
+    {
+        return 0;
+    }
+    size_t n = source->stream->readBytes(buffer, (size_t)available < size ? (size_t)available : size);
+    // Spreadsheet tools save CSV with a byte order mark, which would
+    // end up in the name of the first column
+    if (!source->started && n >= 3 && memcmp(buffer, "\xEF\xBB\xBF", 3) == 0)
+    {
+        n -= 3;
+        memmove(buffer, buffer + 3, n);
+    }
+    source->started = true;
+    return n;
+}
+
+int Supabase::insertStream(const String &table, Stream &source, SupabaseBodyFormat format, bool upsert)
+{
+    StreamSource ctx = {&source, false};
+    return _insertStream(table, readSource, &ctx, format, upsert, preferDefaults);
+}
+
+int Supabase::_insertStream(const String &table, SupabaseBodyProducer producer, void *ctx, SupabaseBodyFormat format,
+                            bool upsert, const SupabasePrefer &prefer)
+{
+    int httpCode;
+    String url = restPrefix + table;
+    if (upsert && prefer.onConflict)
+    {
+        url += "?on_conflict=";
+        url += prefer.onConflict;
+    }
+
+    Lease lease(*this);
+    SupabaseHttpTransport *https = lease.conn->http;
+    // The body cannot be produced twice: only a request that never left
+    // is sent again, as for plain inserts
+    CallRetry call;
+    if (!_call_begin(call, false))
+    {
+        return SUPABASE_ERR_CIRCUIT_OPEN;
+    }
+    do
+    {
+        if (!_auth_check())
+        {
+            httpCode = SUPABASE_ERR_AUTH;
+            break;
+        }
+        if (!https->begin(url))
+        {
+            httpCode = SUPABASE_ERR_BEGIN;
+            break;
+        }
+        https->addHeader("apikey", key);
+        https->addHeader("Content-Type", format == SUPABASE_BODY_CSV ? "text/csv" : "application/json");
+        _accept_gzip(https);
+        _prefer_header(https, prefer, true, upsert);
+        _auth_header(https);
+        CallStart start = _call_start(https);
+        httpCode = https->sendChunked("POST", producer, ctx);
+        _write_result(*lease.conn, prefer, httpCode);
+        https->end();
+        _record(https, SUPABASE_OP_INSERT, httpCode, start, call.attempt > 1);
+    } while (_call_retry(call, httpCode));
+
+    if (cache && httpCode >= 200 && httpCode < 300)
+    {
+        cache->invalidate(table);
+    }
+    return _call_end(call, httpCode);
+}
+
+// HTTPClient's HTTPC_ERROR_CONNECTION_REFUSED and
+// HTTPC_ERROR_SEND_HEADER_FAILED: nothing reached the server
+static bool notSent(int httpCode)
+{
+    return httpCode == -1 || httpCode == -2;
+}
+
+int Supabase::_write(SupabaseJournalOp op, const char *target, size_t targetLength, const char *json, size_t length,
+                     const SupabasePrefer &prefer)
+{
+    if (journal == nullptr)
+    {
+        return _send(op, target, targetLength, json, length, &prefer);
+    }
+
+    // While older writes wait in the journal, newer ones queue behind them.
+    // Replayed later, they are sent with `_background_prefer()`
+    if (WiFi.status() == WL_CONNECTED && journal->empty())
+    {
+        int httpCode = _send(op, target, targetLength, json, length, &prefer);
+        if (httpCode > 0 && httpCode < 500 && httpCode != 408 && httpCode != 429)
+        {
+            return httpCode;
+        }
+        // A plain insert the server may have run already would be stored
+        // twice by the replay. Upserts and updates can run again
+        bool unsent = notSent(httpCode) || httpCode == SUPABASE_ERR_BEGIN || httpCode == SUPABASE_ERR_AUTH ||
+                      httpCode == SUPABASE_ERR_CIRCUIT_OPEN || httpCode == 408 || httpCode == 429;
+        if (op == SUPABASE_JOURNAL_INSERT && !unsent)
+        {
+            return httpCode;
+        }
+    }
+
+    if (!journal->append(op, target, targetLength, json, length))
+    {
+        return SUPABASE_ERR_JOURNAL;
+    }
+    if (WiFi.status() == WL_CONNECTED)
+    {
+        _schedule_replay();
+    }
+    return SUPABASE_JOURNALED;
+}
+
+int Supabase::_send(SupabaseJournalOp op, const char *target, size_t targetLength, const char *json, size_t length,
+                    const SupabasePrefer *prefer)
+{
+    SupabasePrefer background;
+    if (prefer == nullptr)
+    {
+        background = _background_prefer();
+        prefer = &background;
+    }
+    int httpCode;
+    if (op == SUPABASE_JOURNAL_UPDATE)
+    {
+        httpCode = _update(_rest_url(target, targetLength), json, length, *prefer);
+    }
+    else
+    {
+        httpCode = _insert(target, json, length, op == SUPABASE_JOURNAL_UPSERT, *prefer);
+    }
+    if (cache && httpCode >= 200 && httpCode < 300)
+    {
+        // Cached selects of the table may no longer match it
+        const char *query = (const char *)memchr(target, '?', targetLength);
+        cache->invalidate(target, query ? query - target : targetLength);
+    }
+    return httpCode;
+}
+
+void Supabase::setJournal(SupabaseJournal *journal_a)
+{
+    journal = journal_a;
+    if (journal && WiFi.status() == WL_CONNECTED)
+    {
+        _schedule_replay();
+    }
+}
+
+void Supabase::replayJournal()
+{
+    replayFailedAt = 0;
+    _schedule_replay();
+}
+
+void Supabase::_schedule_replay()
+{
+    if (journal == nullptr || replayQueued || journal->empty())
+    {
+        return;
+    }
+    // After a failed replay, wait before hammering a struggling server
+    if (replayFailedAt && millis() - replayFailedAt < SUPABASE_JOURNAL_RETRY_MS)
+    {
+        return;
+    }
+    // Set first: the worker may run `_replay()` before `submit()` returns
+    replayQueued = true;
+    SupabaseAsync *engine = _async_engine();
+    SupabaseAsyncRequest *request = engine ? engine->submit(SUPABASE_ASYNC_REPLAY, String(), String(), nullptr, nullptr, 0) : nullptr;
+    if (request)
+    {
+        engine->release(request);
+    }
+    else
+    {
+        replayQueued = false;
+    }
+}
+
+// Runs on the worker task
+int Supabase::_replay()
+{
+    replayQueued = false;
+    if (journal == nullptr || WiFi.status() != WL_CONNECTED)
+    {
+        return 0;
+    }
+    int httpCode = journal->replay(*this);
+    replayFailedAt = journal->empty() ? 0 : millis();
+    return httpCode;
+}
+
+Supabase &Supabase::select(String colls)
+{
+    url_query += ("select=" + colls);
+    return *this;
+}
+Supabase &Supabase::update(String table)
+{
+    url_query += (table + "?");
+    return *this;
+}
+// Supabase& Supabase::drop(String table){
+//   url_query += (table+"?");
+//   return *this;
+// }
+
+// Comparison Operator
+Supabase &Supabase::eq(String coll, String conditions)
+{
+    return _filter(coll, "eq.", conditions, nullptr);
+}
+Supabase &Supabase::gt(String coll, String conditions)
+{
+    return _filter(coll, "gt.", conditions, nullptr);
+}
+Supabase &Supabase::gte(String coll, String conditions)
+{
+    return _filter(coll, "gte.", conditions, nullptr);
+}
+Supabase &Supabase::lt(String coll, String conditions)
+{
+    return _filter(coll, "lt.", conditions, nullptr);
+}
+Supabase &Supabase::lte(String coll, String conditions)
+{
+    return _filter(coll, "lte.", conditions, nullptr);
+}
+Supabase &Supabase::neq(String coll, String conditions)
+{
+    return _filter(coll, "neq.", conditions, nullptr);
+}
+Supabase &Supabase::in(String coll, String conditions)
+{
+    return _filter(coll, "in.(", conditions, ")");
+}
+Supabase &Supabase::is(String coll, String conditions)
+{
+    return _filter(coll, "is.", conditions, nullptr);
+}
+Supabase &Supabase::cs(String coll, String conditions)
+{
+    return _filter(coll, "cs.{", conditions, "}");
+}
+Supabase &Supabase::cd(String coll, String conditions)
+{
+    return _filter(coll, "cd.{", conditions, "}");
+}
+Supabase &Supabase::ov(String coll, String conditions)
+{
+    return _filter(coll, "ov.{", conditions, "}");
+}
+Supabase &Supabase::sl(String coll, String conditions)
+{
+    return _filter(coll, "sl.(", conditions, ")");
+}
+Supabase &Supabase::sr(String coll, String conditions)
+{
+    return _filter(coll, "sr.(", conditions, ")");
+}
+Supabase &Supabase::nxr(String coll, String conditions)
+{
+    return _filter(coll, "nxr.(", conditions, ")");
+}
+Supabase &Supabase::nxl(String coll, String conditions)
+{
+    return _filter(coll, "nxl.(", conditions, ")");
+}
+Supabase &Supabase::adj(String coll, String conditions)
+{
+    return _filter(coll, "adj.(", conditions, ")");
+}
+// Supabase& Supabase::logic(String mylogic){
+//   url_query += (mylogic);
+// }
+
+// Ordering
+Supabase &Supabase::order(String coll, String by, bool nulls = 1)
+{
+    String subq[] = {"nullsfirst", "nullslast"};
+    _check_last_string();
+    url_query += ("order=" + coll + "." + by + "." + subq[(int)nulls]);
+    return *this;
+}
+Supabase &Supabase::limit(unsigned int by)
+{
+    _check_last_string();
+    url_query += ("limit=" + String(by));
+    return *this;
+}
+Supabase &Supabase::offset(int by)
+{
+    _check_last_string();
+    url_query += ("offset=" + String(by));
+    return *this;
+}
+// do select. execute this after building your query
+String Supabase::doSelect()
+{
+    String response;
+    _cachedSelect(url_query.c_str(), url_query.length(), response, nextTtl);
+    urlQuery_reset();
+    return response;
+}
+
+String Supabase::doSelect(const SupabaseQuery &query)
+{
+    return doSelect(query, -1);
+}
+
+String Supabase::doSelect(const SupabaseQuery &query, long cacheTtlMs)
+{
+    if (query.overflowed())
+    {
+        debugPrintln("doSelect: query overflowed its buffer");
+        return String();
+    }
+    // Into a string of this call: tasks sharing the client do not
+    // overwrite each other's rows
+    String response;
+    _cachedSelect(query.c_str(), query.length(), response, cacheTtlMs);
+    return response;
+}
+
+String Supabase::doSelect(const SupabaseQuery &query, const SupabasePrefer &prefer)
+{
+    if (prefer.count == SUPABASE_COUNT_NONE)
+    {
+        return doSelect(query);
+    }
+    if (query.overflowed())
+    {
+        debugPrintln("doSelect: query overflowed its buffer");
+        return String();
+    }
+    // A cached body carries no count
+    String response;
+    _select(_rest_url(query), response, nullptr, prefer.count);
+    return response;
+}
+
+void Supabase::setCache(SupabaseCache *cache_a)
+{
+    cache = cache_a;
+}
+
+Supabase &Supabase::cacheFor(unsigned long ttlMs)
+{
+    nextTtl = (long)ttlMs;
+    return *this;
+}
+
+void Supabase::getMetrics(SupabaseMetrics &snapshot)
+{
+    xSemaphoreTake(metricsLock, portMAX_DELAY);
+    snapshot = metrics;
+    xSemaphoreGive(metricsLock);
+}
+
+void Supabase::resetMetrics()
+{
+    xSemaphoreTake(metricsLock, portMAX_DELAY);
+    metrics.reset();
+    xSemaphoreGive(metricsLock);
+}
+
+Supabase::CallStart Supabase::_call_start(SupabaseHttpTransport *https)
+{
+    const SupabaseConnectionStats &conn = https->stats();
+    CallStart start = {micros(), conn.bytesSent, conn.bytesReceived};
+    return start;
+}
+
+void Supabase::_record(SupabaseHttpTransport *https, SupabaseOp op, int httpCode, const CallStart &start, uint8_t retries)
+{
+    unsigned long us = micros() - start.us;
+    const SupabaseConnectionStats &conn = https->stats();
+    SupabaseRequestTiming timing = https->timing();
+    timing.retries += retries;
+    xSemaphoreTake(metricsLock, portMAX_DELAY);
+    metrics.record(op, httpCode, us, timing, conn.bytesSent - start.sent, conn.bytesReceived - start.received);
+    xSemaphoreGive(metricsLock);
+}
+
+void Supabase::_record_realtime(bool answered, unsigned long us)
+{
+    xSemaphoreTake(metricsLock, portMAX_DELAY);
+    metrics.recordRealtime(answered, us);
+    xSemaphoreGive(metricsLock);
+}
+
+void Supabase::_count_realtime(size_t sent, size_t received)
+{
+    xSemaphoreTake(metricsLock, portMAX_DELAY);
+    metrics.op[SUPABASE_OP_REALTIME].bytesSent += sent;
+    metrics.op[SUPABASE_OP_REALTIME].bytesReceived += received;
+    xSemaphoreGive(metricsLock);
+}
+
+bool Supabase::_call_begin(CallRetry &call, bool idempotent)
+{
+    call.started = millis();
+    call.attempt = 1;
+    call.idempotent = idempotent;
+    call.deadlineHit = false;
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    if (breakerOpen)
+    {
+        if (millis() - breakerOpenedAt < retryPolicy.breakerCooldownMs)
+        {
+            status.code = SUPABASE_ERR_CIRCUIT_OPEN;
+            status.attempts = 0;
+            status.elapsedMs = 0;
+            status.deadlineExceeded = false;
+            xSemaphoreGive(stateLock);
+            return false;
+        }
+        // Half open: this call probes the server, one more failure
+        // opens the circuit again
+        breakerOpen = false;
+        breakerFailures = retryPolicy.breakerThreshold ? retryPolicy.breakerThreshold - 1 : 0;
+    }
+    xSemaphoreGive(stateLock);
+    return true;
+}
+
+bool Supabase::_call_retry(CallRetry &call, int httpCode)
+{
+    bool transient = (httpCode <= 0 && httpCode > SUPABASE_ERR_BEGIN) || httpCode == 408 || httpCode == 429 ||
+                     httpCode == 502 || httpCode == 503 || httpCode == 504;
+    if (!transient || (!call.idempotent && !notSent(httpCode)))
+    {
+        return false;
+    }
+    // Without a link every attempt fails the same way
+    if (call.attempt >= retryPolicy.maxAttempts || WiFi.status() != WL_CONNECTED)
+    {
+        return false;
+    }
+
+    unsigned long backoff = retryPolicy.backoffMinMs;
+    for (uint8_t i = 1; i < call.attempt && backoff < retryPolicy.backoffMaxMs; i++)
+    {
+        backoff *= 2;
+    }
+    if (backoff > retryPolicy.backoffMaxMs)
+    {
+        backoff = retryPolicy.backoffMaxMs;
+    }
+    // Jittered, so a fleet hit by the same outage does not retry in lockstep
+    backoff = backoff / 2 + random(backoff / 2 + 1);
+    if (retryPolicy.deadlineMs && millis() - call.started + backoff >= retryPolicy.deadlineMs)
+    {
+        call.deadlineHit = true;
+        return false;
+    }
+    // Sleeps instead of spinning, so other tasks and the idle watchdog run
+    delay(backoff);
+    call.attempt++;
+    return true;
+}
+
+int Supabase::_call_end(const CallRetry &call, int httpCode)
+{
+    // Only a missing response or a server error says the server is in
+    // trouble; a 4xx proves it is up
+    bool failed = (httpCode <= 0 && httpCode > SUPABASE_ERR_BEGIN) || httpCode >= 500;
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    if (!failed)
+    {
+        breakerFailures = 0;
+    }
+    else if (retryPolicy.breakerThreshold && ++breakerFailures >= retryPolicy.breakerThreshold && !breakerOpen)
+    {
+        breakerOpen = true;
+        breakerOpenedAt = millis();
+        debugPrintln("Circuit open: failing calls fast until the cooldown passed");
+    }
+    status.code = httpCode;
+    status.attempts = call.attempt;
+    status.elapsedMs = millis() - call.started;
+    status.deadlineExceeded = call.deadlineHit;
+    xSemaphoreGive(stateLock);
+    return httpCode;
+}
+
+SupabaseStatus Supabase::lastStatus()
+{
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    SupabaseStatus last = status;
+    xSemaphoreGive(stateLock);
+    return last;
+}
+
+void Supabase::setCompression(bool responses, size_t requestMin)
+{
+    gzipResponses = responses;
+    gzipRequestMin = requestMin;
+    if (!responses)
+    {
+        releaseCompression();
+    }
+}
+
+void Supabase::releaseCompression()
+{
+    // Under `poolLock` no idle connection can be taken meanwhile; busy
+    // ones keep theirs
+    xSemaphoreTake(poolLock, portMAX_DELAY);
+    for (uint8_t i = 0; i < poolSize; i++)
+    {
+        if (pool[i].depth == 0 && pool[i].inflater)
+        {
+            pool[i].inflater->release();
+        }
+    }
+    xSemaphoreGive(poolLock);
+}
+
+void Supabase::_accept_gzip(SupabaseHttpTransport *https)
+{
+    if (gzipResponses)
+    {
+        https->addHeader("Accept-Encoding", "gzip");
+    }
+}
+
+Stream *Supabase::_response_stream(Connection &conn)
+{
+    Stream *body = conn.http->getStream();
+    if (conn.http->header("Content-Encoding").indexOf("gzip") < 0)
+    {
+        return body;
+    }
+    if (conn.inflater == nullptr)
+    {
+        conn.inflater = new SupabaseInflateStream();
+    }
+    if (!conn.inflater->begin(body))
+    {
+        // Reads as an empty body: the caller reports a parse error
+        debugPrintln("gzip: no memory for the window or not a gzip body");
+    }
+    return conn.inflater;
+}
+
+bool Supabase::_response_string(Connection &conn, String &text)
+{
+    if (conn.http->header("Content-Encoding").indexOf("gzip") < 0)
+    {
+        text = conn.http->getString();
+        return true;
+    }
+    Stream *body = _response_stream(conn);
+    text = String();
+    char chunk[64];
+    size_t n = 0;
+    int c;
+    while ((c = body->read()) >= 0)
+    {
+        chunk[n++] = c;
+        if (n == sizeof(chunk))
+        {
+            text.concat(chunk, n);
+            n = 0;
+        }
+    }
+    text.concat(chunk, n);
+    if (conn.inflater->failed())
+    {
+        // Truncated JSON: not to be taken (or cached) for the rows
+        debugPrintln("gzip: corrupt or truncated body");
+        text = String();
+        return false;
+    }
+    return true;
+}
+
+int Supabase::_cachedSelect(const char *path, size_t length, String &response, long ttl, const String *url)
+{
+    String own;
+    if (url == nullptr)
+    {
+        own = _rest_url(path, length);
+        url = &own;
+    }
+    if (cache == nullptr || ttl == 0)
+    {
+        return _select(*url, response);
+    }
+    if (ttl < 0)
+    {
+        ttl = (long)cache->ttl();
+    }
+
+    String etag;
+    SupabaseCache::Lookup state = cache->lookup(path, length, response, etag);
+    if (state == SupabaseCache::CACHE_FRESH)
+    {
+        return 200;
+    }
+    int httpCode = _select(*url, response, &etag);
+    if (httpCode == 304 && state == SupabaseCache::CACHE_STALE)
+    {
+        // `response` still holds the cached body
+        cache->revalidated(path, length, ttl);
+        return 200;
+    }
+    if (httpCode == 200)
+    {
+        cache->store(path, length, response, etag, ttl);
+    }
+    else if (httpCode <= 0)
+    {
+        // Not the stale body: a failed select returns nothing, cached or not
+        response = String();
+    }
+    return httpCode;
+}
+
+String Supabase::_rest_url(const char *path, size_t length)
+{
+    // One allocation for the whole URL instead of a chain of temporaries
+    String url;
+    url.reserve(restPrefix.length() + length);
+    url += restPrefix;
+    url.concat(path, length);
+    return url;
+}
+
+SupabasePrefer Supabase::_background_prefer() const
+{
+    SupabasePrefer prefer = preferDefaults;
+    prefer.returning = SUPABASE_RETURN_MINIMAL;
+    prefer.count = SUPABASE_COUNT_NONE;
+    return prefer;
+}
+
+void Supabase::_prefer_header(SupabaseHttpTransport *https, const SupabasePrefer &prefer, bool write, bool upsert)
+{
+    static const char *const returns[] = {"return=minimal", "return=minimal", "return=headers-only",
+                                          "return=representation"};
+    static const char *const counts[] = {"", "count=exact", "count=planned", "count=estimated"};
+
+    String value;
+    if (write)
+    {
+        value = returns[prefer.returning & 3];
+    }
+    if (prefer.count != SUPABASE_COUNT_NONE)
+    {
+        if (value.length())
+        {
+            value += ',';
+        }
+        value += counts[prefer.count & 3];
+    }
+    if (write && prefer.missingDefault)
+    {
+        value += ",missing=default";
+    }
+    if (upsert)
+    {
+        value += ",resolution=merge-duplicates";
+    }
+    if (value.length())
+    {
+        https->addHeader("Prefer", value);
+    }
 }
 
-void Supabase::realtimeLoop()
+void Supabase::_write_result(Connection &conn, const SupabasePrefer &prefer, int httpCode)
 {
-    if (realtimeStarted) {
-        webSocket.loop();
+    if (httpCode > 0 && prefer.returning == SUPABASE_RETURN_REPRESENTATION)
+    {
+        String rows;
+        _response_string(conn, rows);
+        xSemaphoreTake(stateLock, portMAX_DELAY);
+        data = rows;
+        xSemaphoreGive(stateLock);
+    }
+    if (prefer.count != SUPABASE_COUNT_NONE)
+    {
+        _read_count(conn.http);
     }
 }
 
-String Supabase::getQuery()
-{
-    String temp = url_query;
-    urlQuery_reset();
-    return hostname + "/rest/v1/" + temp;
-}
-// query reset
-void Supabase::urlQuery_reset()
+void Supabase::_read_count(SupabaseHttpTransport *https)
 {
-    url_query = "";
+    // `0-24/3573` for reads, `*/3` for writes, `*` when not counted
+    String range = https->header("Content-Range");
+    int slash = range.indexOf('/');
+    long count = (slash >= 0 && isdigit((unsigned char)range[slash + 1])) ? range.substring(slash + 1).toInt() : -1;
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    resultCount = count;
+    xSemaphoreGive(stateLock);
 }
-// membuat Query Builder
-Supabase &Supabase::Supabase::from(String table)
+
+String Supabase::lastResponse()
 {
-    url_query += (table + "?");
-    return *this;
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    String rows = data;
+    xSemaphoreGive(stateLock);
+    return rows;
 }
 
-int Supabase::insert(String table, String json, bool upsert)
+int Supabase::_select(const String &url, String &response, String *etag, SupabaseCount count)
 {
+    SupabasePrefer prefer;
+    prefer.count = count;
+    Lease lease(*this);
+    SupabaseHttpTransport *https = lease.conn->http;
+    CallRetry call;
+    if (!_call_begin(call, true))
+    {
+        return SUPABASE_ERR_CIRCUIT_OPEN;
+    }
+    String ifNoneMatch = etag ? *etag : String();
+    // While revalidating, a retried 503 page must not replace the cached
+    // body a later 304 confirms: read into a string of its own
+    String revalidated;
+    String &body = ifNoneMatch.length() ? revalidated : response;
     int httpCode;
-    if (https.begin(client, hostname + "/rest/v1/" + table))
+    do
     {
-        https.addHeader("apikey", key);
-        https.addHeader("Content-Type", "application/json");
-
-        String preferHeader = "return=representation";
-        if (upsert)
+        if (!_auth_check())
+        {
+            return _call_end(call, SUPABASE_ERR_AUTH);
+        }
+        if (!https->begin(url))
+        {
+            return _call_end(call, SUPABASE_ERR_BEGIN);
+        }
+        https->addHeader("apikey", key);
+        https->addHeader("Content-Type", "application/json");
+        if (ifNoneMatch.length())
         {
-            preferHeader += ",resolution=merge-duplicates";
+            https->addHeader("If-None-Match", ifNoneMatch);
         }
-        https.addHeader("Prefer", preferHeader);
+        _accept_gzip(https);
+        _prefer_header(https, prefer, false, false);
+
+        _auth_header(https);
 
-        if (useAuth)
+        CallStart start = _call_start(https);
+        httpCode = https->sendRequest("GET", "");
+        if (httpCode > 0 && httpCode != 304)
         {
-            unsigned long t_now = millis();
-            if (t_now - loginTime >= authTimeout)
+            if (!_response_string(*lease.conn, body))
             {
-                _login_process();
+                httpCode = SUPABASE_ERR_PARSE;
             }
-            https.addHeader("Authorization", "Bearer " + USER_TOKEN);
         }
-        httpCode = https.POST(json);
-        https.end();
-    }
-    else
+        else
+        {
+            body = String();
+        }
+        if (count != SUPABASE_COUNT_NONE)
+        {
+            _read_count(https);
+        }
+        if (etag)
+        {
+            *etag = https->header("ETag");
+        }
+        https->end();
+        _record(https, SUPABASE_OP_SELECT, httpCode, start, call.attempt > 1);
+    } while (_call_retry(call, httpCode));
+    if (&body != &response && httpCode != 304)
     {
-        return -100;
+        response = body;
     }
-    return httpCode;
+    return _call_end(call, httpCode);
 }
 
-Supabase &Supabase::select(String colls)
-{
-    url_query += ("select=" + colls);
-    return *this;
-}
-Supabase &Supabase::update(String table)
+int Supabase::doSelectStream(SupabaseRowCallback callback, void *ctx, const JsonDocument *filter)
 {
-    url_query += (table + "?");
-    return *this;
+    int httpCode = _selectStream(restPrefix + url_query, callback, ctx, filter);
+    urlQuery_reset();
+    return httpCode;
 }
-// Supabase& Supabase::drop(String table){
-//   url_query += (table+"?");
-//   return *this;
-// }
 
-// Comparison Operator
-Supabase &Supabase::eq(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=eq." + conditions);
-    return *this;
-}
-Supabase &Supabase::gt(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=gt." + conditions);
-    return *this;
-}
-Supabase &Supabase::gte(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=gte." + conditions);
-    return *this;
-}
-Supabase &Supabase::lt(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=lt." + conditions);
-    return *this;
-}
-Supabase &Supabase::lte(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=lte." + conditions);
-    return *this;
-}
-Supabase &Supabase::neq(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=neq." + conditions);
-    return *this;
-}
-Supabase &Supabase::in(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=in.(" + conditions + ")");
-    return *this;
-}
-Supabase &Supabase::is(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=is." + conditions);
-    return *this;
-}
-Supabase &Supabase::cs(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=cs.{" + conditions + "}");
-    return *this;
-}
-Supabase &Supabase::cd(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=cd.{" + conditions + "}");
-    return *this;
-}
-Supabase &Supabase::ov(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=cd.{" + conditions + "}");
-    return *this;
-}
-Supabase &Supabase::sl(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=sl.(" + conditions + ")");
-    return *this;
-}
-Supabase &Supabase::sr(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=sr.(" + conditions + ")");
-    return *this;
-}
-Supabase &Supabase::nxr(String coll, String conditions)
-{
-    _check_last_string();
-    url_query += (coll + "=nxr.(" + conditions + ")");
-    return *this;
-}
-Supabase &Supabase::nxl(String coll, String conditions)
+int Supabase::doSelectStream(const SupabaseQuery &query, SupabaseRowCallback callback, void *ctx, const JsonDocument *filter)
 {
-    _check_last_string();
-    url_query += (coll + "=nxl.(" + conditions + ")");
-    return *this;
+    if (query.overflowed())
+    {
+        return SUPABASE_ERR_OVERFLOW;
+    }
+    return _selectStream(_rest_url(query), callback, ctx, filter);
 }
-Supabase &Supabase::adj(String coll, String conditions)
+
+SupabasePrepared Supabase::prepare()
 {
-    _check_last_string();
-    url_query += (coll + "=adj.(" + conditions + ")");
-    return *this;
+    SupabasePrepared prepared(url_query.c_str(), url_query.length());
+    urlQuery_reset();
+    return prepared;
 }
-// Supabase& Supabase::logic(String mylogic){
-//   url_query += (mylogic);
-// }
 
-// Ordering
-Supabase &Supabase::order(String coll, String by, bool nulls = 1)
+String Supabase::doSelect(SupabasePrepared &query, long cacheTtlMs)
 {
-    String subq[] = {"nullsfirst", "nullslast"};
-    _check_last_string();
-    url_query += ("order=" + coll + "." + by + "." + subq[(int)nulls]);
-    return *this;
+    String response;
+    if (query.overflowed())
+    {
+        debugPrintln("doSelect: prepared query overflowed");
+        return response;
+    }
+    const String &url = query.url(restPrefix);
+    _cachedSelect(query.path(), query.pathLength(), response, cacheTtlMs, &url);
+    return response;
 }
-Supabase &Supabase::limit(unsigned int by)
+
+int Supabase::doSelectStream(SupabasePrepared &query, SupabaseRowCallback callback, void *ctx, const JsonDocument *filter)
 {
-    _check_last_string();
-    url_query += ("limit=" + String(by));
-    return *this;
+    if (query.overflowed())
+    {
+        return SUPABASE_ERR_OVERFLOW;
+    }
+    return _selectStream(query.url(restPrefix), callback, ctx, filter);
 }
-Supabase &Supabase::offset(int by)
+
+int Supabase::doUpdate(SupabasePrepared &query, const String &json)
 {
-    _check_last_string();
-    url_query += ("offset=" + String(by));
-    return *this;
+    if (query.overflowed())
+    {
+        return SUPABASE_ERR_OVERFLOW;
+    }
+    query.url(restPrefix);
+    return _write(SUPABASE_JOURNAL_UPDATE, query.path(), query.pathLength(), json.c_str(), json.length(),
+                  preferDefaults);
 }
-// do select. execute this after building your query
-String Supabase::doSelect()
-{
-    https.begin(client, hostname + "/rest/v1/" + url_query);
-    https.addHeader("apikey", key);
-    https.addHeader("Content-Type", "application/json");
 
-    if (useAuth)
+int Supabase::_selectStream(const String &url, SupabaseRowCallback callback, void *ctx, const JsonDocument *filter)
+{
+    Lease lease(*this);
+    SupabaseHttpTransport *https = lease.conn->http;
+    CallRetry call;
+    if (!_call_begin(call, true))
+    {
+        return SUPABASE_ERR_CIRCUIT_OPEN;
+    }
+    // Retried only until a response arrives: rows handed to the callback
+    // are never delivered twice
+    CallStart start;
+    int httpCode;
+    while (true)
     {
-        unsigned long t_now = millis();
-        if (t_now - loginTime >= authTimeout)
+        if (!_auth_check())
+        {
+            return _call_end(call, SUPABASE_ERR_AUTH);
+        }
+        if (!https->begin(url))
+        {
+            return _call_end(call, SUPABASE_ERR_BEGIN);
+        }
+        https->addHeader("apikey", key);
+        https->addHeader("Content-Type", "application/json");
+        _accept_gzip(https);
+
+        _auth_header(https);
+
+        start = _call_start(https);
+        httpCode = https->sendRequest("GET", "");
+        if (httpCode >= 200 && httpCode < 300)
+        {
+            break;
+        }
+        https->end();
+        _record(https, SUPABASE_OP_SELECT, httpCode, start, call.attempt > 1);
+        if (!_call_retry(call, httpCode))
         {
-            _login_process();
+            return _call_end(call, httpCode);
         }
-        https.addHeader("Authorization", "Bearer " + USER_TOKEN);
     }
 
-    int httpCode = 0;
-    while (httpCode <= 0)
+    // Rows are parsed straight out of the inflater when gzipped
+    Stream *body = _response_stream(*lease.conn);
+    if (!body->find("["))
     {
-        httpCode = https.GET();
+        https->end();
+        _record(https, SUPABASE_OP_SELECT, httpCode, start, call.attempt > 1);
+        return _call_end(call, SUPABASE_ERR_PARSE);
+    }
+    while (isspace(body->peek()))
+    {
+        body->read();
     }
 
-    if (httpCode > 0)
+    // One document reused for every row: only a single row is ever in RAM
+    JsonDocument row;
+    if (body->peek() != ']')
     {
-        data = https.getString();
+        do
+        {
+            DeserializationError err = filter
+                ? deserializeJson(row, *body, DeserializationOption::Filter(*filter))
+                : deserializeJson(row, *body);
+            if (err)
+            {
+                debugPrintf("doSelectStream: %s\n", err.c_str());
+                httpCode = SUPABASE_ERR_PARSE;
+                break;
+            }
+            if (!callback(row.as<JsonObjectConst>(), ctx))
+            {
+                break;
+            }
+        } while (body->findUntil(",", "]"));
     }
-    https.end();
-    urlQuery_reset();
-    return data;
+
+    // Drains whatever the callback did not read so the connection stays usable
+    https->end();
+    _record(https, SUPABASE_OP_SELECT, httpCode, start, call.attempt > 1);
+    return _call_end(call, httpCode);
 }
+
 // do update. execute this after querying your update
 int Supabase::doUpdate(String json)
 {
-    int httpCode;
-    if (https.begin(client, hostname + "/rest/v1/" + url_query))
+    int httpCode = _write(SUPABASE_JOURNAL_UPDATE, url_query.c_str(), url_query.length(), json.c_str(), json.length(),
+                          preferDefaults);
+    urlQuery_reset();
+    return httpCode;
+}
+
+int Supabase::doUpdate(const SupabaseQuery &query, const String &json)
+{
+    return doUpdate(query, json, preferDefaults);
+}
+
+int Supabase::doUpdate(const SupabaseQuery &query, const String &json, const SupabasePrefer &prefer)
+{
+    return doUpdate(query, json.c_str(), json.length(), prefer);
+}
+
+int Supabase::doUpdate(const SupabaseQuery &query, const char *json, size_t length, const SupabasePrefer &prefer)
+{
+    if (query.overflowed())
     {
-        https.addHeader("apikey", key);
-        https.addHeader("Content-Type", "application/json");
-        if (useAuth)
-        {
-            unsigned long t_now = millis();
-            if (t_now - loginTime >= authTimeout)
-            {
-                _login_process();
-            }
-            https.addHeader("Authorization", "Bearer " + USER_TOKEN);
-        }
-        unsigned long t0 = millis();
-        httpCode = https.PATCH(json);
-        // debugPrintf("PATCH took %d ms\n",millis()-t0);
-        https.end();
+        return SUPABASE_ERR_OVERFLOW;
     }
-    else
+    return _write(SUPABASE_JOURNAL_UPDATE, query.c_str(), query.length(), json, length, prefer);
+}
+
+int Supabase::_update(const String &url, const char *json, size_t length, const SupabasePrefer &prefer)
+{
+    int httpCode;
+    Lease lease(*this);
+    SupabaseHttpTransport *https = lease.conn->http;
+    // PATCH with a filter sets the same values again: safe to repeat
+    CallRetry call;
+    if (!_call_begin(call, true))
     {
-        return -100;
+        return SUPABASE_ERR_CIRCUIT_OPEN;
     }
-    urlQuery_reset();
-    return httpCode;
+    do
+    {
+        if (!_auth_check())
+        {
+            return _call_end(call, SUPABASE_ERR_AUTH);
+        }
+        if (!https->begin(url))
+        {
+            return _call_end(call, SUPABASE_ERR_BEGIN);
+        }
+        https->addHeader("apikey", key);
+        https->addHeader("Content-Type", "application/json");
+        if (prefer.returning == SUPABASE_RETURN_REPRESENTATION)
+        {
+            _accept_gzip(https);
+        }
+        _prefer_header(https, prefer, true, false);
+        _auth_header(https);
+        CallStart start = _call_start(https);
+        httpCode = https->sendRequest("PATCH", (const uint8_t *)json, length);
+        _write_result(*lease.conn, prefer, httpCode);
+        https->end();
+        _record(https, SUPABASE_OP_UPDATE, httpCode, start, call.attempt > 1);
+    } while (_call_retry(call, httpCode));
+    return _call_end(call, httpCode);
 }
 
 int Supabase::login_email(String email_a, String password_a)
@@ -528,12 +2608,7 @@ int Supabase::login_email(String email_a, String password_a)
     phone_or_email = email_a;
     password = password_a;
 
-    int httpCode = 0;
-    while (httpCode <= 0)
-    {
-        httpCode = _login_process();
-    }
-    return httpCode;
+    return _login_start();
 }
 
 int Supabase::login_phone(String phone_a, String password_a)
@@ -543,84 +2618,96 @@ int Supabase::login_phone(String phone_a, String password_a)
     phone_or_email = phone_a;
     password = password_a;
 
-    int httpCode = 0;
-    while (httpCode <= 0)
+    return _login_start();
+}
+
+int Supabase::_login_start()
+{
+    if (sessionRestored)
     {
-        httpCode = _login_process();
+        sessionRestored = false;
+        if (sessionUser == _user_hash())
+        {
+            // The password stays until the session is refreshed: the
+            // restored refresh token may have been spent after it was saved
+            debugPrintln("Login: saved session resumed");
+            return 200;
+        }
+        // Someone else's tokens must not go out while this login runs
+        xSemaphoreTake(tokenLock, portMAX_DELAY);
+        USER_TOKEN = String();
+        xSemaphoreGive(tokenLock);
+        refreshToken = String();
+        sessionUser = 0;
     }
-    return httpCode;
+    return _login_process();
 }
 
 String Supabase::rpc(String func_name, String json_param)
 {
+    String response;
+    int httpCode = _rpc(func_name, json_param, response);
+    if (httpCode > 0)
+    {
+        return response;
+    }
+    return String(httpCode);
+}
 
+int Supabase::_rpc(const String &func_name, const String &json_param, String &response)
+{
     int httpCode;
-
-    if (!https.begin(client, hostname + "/rpc/" + func_name))
+    Lease lease(*this);
+    SupabaseHttpTransport *https = lease.conn->http;
+    // A function may have side effects: only resent if it never went out
+    CallRetry call;
+    if (!_call_begin(call, false))
     {
-        return String(-100);
+        return SUPABASE_ERR_CIRCUIT_OPEN;
     }
-    https.addHeader("apikey", key);
-    https.addHeader("Content-Type", "application/json");
-
-    if (useAuth)
+    do
     {
-        unsigned long t_now = millis();
-        if (t_now - loginTime >= authTimeout)
+        if (!_auth_check())
         {
-            _login_process();
+            return _call_end(call, SUPABASE_ERR_AUTH);
         }
-        https.addHeader("Authorization", "Bearer " + USER_TOKEN);
-    }
+        if (!https->begin(hostname + "/rpc/" + func_name))
+        {
+            return _call_end(call, SUPABASE_ERR_BEGIN);
+        }
+        https->addHeader("apikey", key);
+        https->addHeader("Content-Type", "application/json");
+        _accept_gzip(https);
 
-    httpCode = https.POST(json_param);
-    if (httpCode > 0)
-    {
-        data = https.getString();
-        https.end();
-        return data;
-    }
+        _auth_header(https);
 
-    https.end();
-    return String(httpCode);
+        CallStart start = _call_start(https);
+        httpCode = https->sendRequest("POST", json_param);
+        if (httpCode > 0 && !_response_string(*lease.conn, response))
+        {
+            httpCode = SUPABASE_ERR_PARSE;
+        }
+
+        https->end();
+        _record(https, SUPABASE_OP_RPC, httpCode, start, call.attempt > 1);
+    } while (_call_retry(call, httpCode));
+    return _call_end(call, httpCode);
 }
 
-void Supabase::asyncUpdateTask(void *pvParameters)
-{
-    // int i = *((int*)pvParameters);
-    JsonDocument doc = *((JsonDocument *)pvParameters);
-
-    // TODO: Everything has to be static!
-    // int httpCode;
-    // if (https.begin(client, hostname + "/rest/v1/" + url_query))
-    // {
-    //   https.addHeader("apikey", key);
-    //   https.addHeader("Content-Type", "application/json");
-    //   if (useAuth)
-    //   {
-    //     unsigned long t_now = millis();
-    //     if (t_now - loginTime >= authTimeout)
-    //     {
-    //       _login_process();
-    //     }
-    //     https.addHeader("Authorization", "Bearer " + USER_TOKEN);
-    //   }
-    //   unsigned long t0 = millis();
-    //   httpCode = https.PATCH(json);
-    //   debugPrintf("PATCH took %d ms\n",millis()-t0);
-    //   https.end();
-    // }
-    // urlQuery_reset();
-    vTaskDelete(NULL);
-}
-
-void Supabase::asyncUpdate(String json)
-{
-    xTaskCreate(
-        asyncUpdateTask,
-        "asyncUpdateTask",
-        10000,
-        &json,
-        1,
-        &asyncUpdateTaskHandle);
-}
\ No newline at end of file
+bool Supabase::asyncUpdate(String json)
+{
+    SupabaseAsync *engine = _async_engine();
+    if (engine == nullptr)
+    {
+        return false;
+    }
+    SupabaseAsyncRequest *request = engine->update(url_query, json);
+    urlQuery_reset();
+    if (request == nullptr)
+    {
+        return false;
+    }
+    // Fire and forget: the slot is recycled once the update has run
+    engine->release(request);
+    return true;
+}
@@ -0,0 +1,246 @@
+#include "SupabaseAsync.h"
+
+SupabaseAsync::SupabaseAsync(Supabase &db, size_t queueLength)
+    : db(db)
+{
+    length = queueLength ? queueLength : 1;
+    slots = nullptr;
+    queue = nullptr;
+    freeSlots = nullptr;
+    lock = nullptr;
+    stopped = nullptr;
+    worker = nullptr;
+    rejectedCount = 0;
+}
+
+SupabaseAsync::~SupabaseAsync()
+{
+    end();
+    if (queue)
+    {
+        vQueueDelete(queue);
+        vSemaphoreDelete(freeSlots);
+        vSemaphoreDelete(lock);
+        vSemaphoreDelete(stopped);
+    }
+    delete[] slots;
+}
+
+bool SupabaseAsync::begin(uint32_t stackSize, UBaseType_t priority, BaseType_t core)
+{
+    if (worker)
+    {
+        return true;
+    }
+    if (!queue)
+    {
+        slots = new SupabaseAsyncRequest[length];
+        // One extra entry for the stop marker of end()
+        queue = xQueueCreate(length + 1, sizeof(SupabaseAsyncRequest *));
+        freeSlots = xSemaphoreCreateCounting(length, length);
+        lock = xSemaphoreCreateMutex();
+        stopped = xSemaphoreCreateBinary();
+    }
+
+    if (xTaskCreatePinnedToCore(task, "supabaseAsync", stackSize, this, priority, &worker, core) != pdPASS)
+    {
+        worker = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void SupabaseAsync::end()
+{
+    if (!worker)
+    {
+        return;
+    }
+    SupabaseAsyncRequest *marker = nullptr;
+    xQueueSend(queue, &marker, portMAX_DELAY);
+    xSemaphoreTake(stopped, portMAX_DELAY);
+    worker = nullptr;
+}
+
+void SupabaseAsync::task(void *arg)
+{
+    SupabaseAsync *self = (SupabaseAsync *)arg;
+    SupabaseAsyncRequest *request;
+    while (xQueueReceive(self->queue, &request, portMAX_DELAY) == pdTRUE && request != nullptr)
+    {
+        self->run(request);
+    }
+    xSemaphoreGive(self->stopped);
+    vTaskDelete(NULL);
+}
+
+SupabaseAsyncRequest *SupabaseAsync::submit(SupabaseAsyncOp op, const String &target, const String &payload,
+                                            SupabaseAsyncCallback callback, void *ctx, unsigned long waitMs)
+{
+    if (!worker)
+    {
+        return nullptr;
+    }
+    if (xSemaphoreTake(freeSlots, pdMS_TO_TICKS(waitMs)) != pdTRUE)
+    {
+        rejectedCount++;
+        return nullptr;
+    }
+
+    // The semaphore guarantees that a free slot exists
+    SupabaseAsyncRequest *request = nullptr;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (size_t i = 0; i < length; i++)
+    {
+        if (slots[i].state == SupabaseAsyncRequest::FREE)
+        {
+            request = &slots[i];
+            request->state = SupabaseAsyncRequest::QUEUED;
+            break;
+        }
+    }
+    xSemaphoreGive(lock);
+
+    request->op = op;
+    request->target = target;
+    request->payload = payload;
+    request->code = 0;
+    request->detached = false;
+    request->callback = callback;
+    request->ctx = ctx;
+    xQueueSend(queue, &request, portMAX_DELAY);
+    return request;
+}
+
+SupabaseAsyncRequest *SupabaseAsync::select(const String &query, SupabaseAsyncCallback callback, void *ctx, unsigned long waitMs)
+{
+    return submit(SUPABASE_ASYNC_SELECT, query, String(), callback, ctx, waitMs);
+}
+
+SupabaseAsyncRequest *SupabaseAsync::select(const SupabaseQuery &query, SupabaseAsyncCallback callback, void *ctx, unsigned long waitMs)
+{
+    if (query.overflowed())
+    {
+        return nullptr;
+    }
+    return submit(SUPABASE_ASYNC_SELECT, query.c_str(), String(), callback, ctx, waitMs);
+}
+
+SupabaseAsyncRequest *SupabaseAsync::insert(const String &table, const String &json, bool upsert,
+                                            SupabaseAsyncCallback callback, void *ctx, unsigned long waitMs)
+{
+    return submit(upsert ? SUPABASE_ASYNC_UPSERT : SUPABASE_ASYNC_INSERT, table, json, callback, ctx, waitMs);
+}
+
+SupabaseAsyncRequest *SupabaseAsync::update(const String &query, const String &json, SupabaseAsyncCallback callback,
+                                            void *ctx, unsigned long waitMs)
+{
+    return submit(SUPABASE_ASYNC_UPDATE, query, json, callback, ctx, waitMs);
+}
+
+SupabaseAsyncRequest *SupabaseAsync::update(const SupabaseQuery &query, const String &json, SupabaseAsyncCallback callback,
+                                            void *ctx, unsigned long waitMs)
+{
+    if (query.overflowed())
+    {
+        return nullptr;
+    }
+    return submit(SUPABASE_ASYNC_UPDATE, query.c_str(), json, callback, ctx, waitMs);
+}
+
+SupabaseAsyncRequest *SupabaseAsync::rpc(const String &func, const String &params, SupabaseAsyncCallback callback,
+                                         void *ctx, unsigned long waitMs)
+{
+    return submit(SUPABASE_ASYNC_RPC, func, params, callback, ctx, waitMs);
+}
+
+void SupabaseAsync::run(SupabaseAsyncRequest *request)
+{
+    switch (request->op)
+    {
+    case SUPABASE_ASYNC_SELECT:
+        request->code = db._select(db._rest_url(request->target.c_str(), request->target.length()), request->body);
+        break;
+    // Writes never fill `lastResponse()` from here, the caller's task owns it
+    case SUPABASE_ASYNC_INSERT:
+    case SUPABASE_ASYNC_UPSERT:
+        request->code = db.insert(request->target, request->payload.c_str(), request->payload.length(),
+                                  request->op == SUPABASE_ASYNC_UPSERT, db._background_prefer());
+        break;
+    case SUPABASE_ASYNC_UPDATE:
+        request->code = db._write(SUPABASE_JOURNAL_UPDATE, request->target.c_str(), request->target.length(),
+                                  request->payload.c_str(), request->payload.length(), db._background_prefer());
+        break;
+    case SUPABASE_ASYNC_RPC:
+        request->code = db._rpc(request->target, request->payload, request->body);
+        break;
+    case SUPABASE_ASYNC_REFRESH:
+        request->code = db._refresh_process();
+        break;
+    case SUPABASE_ASYNC_REPLAY:
+        request->code = db._replay();
+        break;
+    }
+
+    if (request->callback)
+    {
+        request->callback(request->code, request->body, request->ctx);
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (request->callback || request->detached)
+    {
+        recycle(request);
+    }
+    else
+    {
+        __atomic_store_n(&request->state, (uint8_t)SupabaseAsyncRequest::DONE, __ATOMIC_RELEASE);
+    }
+    xSemaphoreGive(lock);
+}
+
+void SupabaseAsync::release(SupabaseAsyncRequest *request)
+{
+    if (request == nullptr)
+    {
+        return;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (request->state == SupabaseAsyncRequest::DONE)
+    {
+        recycle(request);
+    }
+    else if (request->state == SupabaseAsyncRequest::QUEUED)
+    {
+        request->detached = true;
+    }
+    xSemaphoreGive(lock);
+}
+
+// Called with `lock` held
+void SupabaseAsync::recycle(SupabaseAsyncRequest *request)
+{
+    // Responses can be large: do not keep them around in idle slots
+    request->body = String();
+    request->state = SupabaseAsyncRequest::FREE;
+    xSemaphoreGive(freeSlots);
+}
+
+size_t SupabaseAsync::pending() const
+{
+    size_t count = 0;
+    if (!lock)
+    {
+        return 0;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (size_t i = 0; i < length; i++)
+    {
+        if (slots[i].state == SupabaseAsyncRequest::QUEUED)
+        {
+            count++;
+        }
+    }
+    xSemaphoreGive(lock);
+    return count;
+}
@@ -0,0 +1,127 @@
+#ifndef SupabaseAsync_h
+#define SupabaseAsync_h
+
+#include "ESP32_Supabase.h"
+
+enum SupabaseAsyncOp
+{
+    SUPABASE_ASYNC_SELECT,
+    SUPABASE_ASYNC_INSERT,
+    SUPABASE_ASYNC_UPSERT,
+    SUPABASE_ASYNC_UPDATE,
+    SUPABASE_ASYNC_RPC,
+    /** Internal: token refresh queued by `Supabase` */
+    SUPABASE_ASYNC_REFRESH,
+    /** Internal: journal replay queued by `Supabase` */
+    SUPABASE_ASYNC_REPLAY
+};
+
+/** Called on the worker task when a request completes. `response` is the
+ * body of a select or rpc (empty for insert/update) and is only valid
+ * during the call */
+typedef void (*SupabaseAsyncCallback)(int httpCode, const String &response, void *ctx);
+
+/** One queued request. Poll `done()`, read the result, then hand it back
+ * with `SupabaseAsync::release()` */
+class SupabaseAsyncRequest
+{
+public:
+    bool done() const { return __atomic_load_n(&state, __ATOMIC_ACQUIRE) == DONE; }
+    int httpCode() const { return code; }
+    const String &response() const { return body; }
+
+private:
+    friend class SupabaseAsync;
+    enum State : uint8_t
+    {
+        FREE,
+        QUEUED,
+        DONE
+    };
+
+    uint8_t state = FREE;
+    bool detached = false;
+    SupabaseAsyncOp op = SUPABASE_ASYNC_SELECT;
+    String target;
+    String payload;
+    String body;
+    int code = 0;
+    SupabaseAsyncCallback callback = nullptr;
+    void *ctx = nullptr;
+};
+
+/** Runs REST requests of one `Supabase` client on a long-lived worker task
+ * so `loop()` never waits for the network.
+ *
+ * Requests go into a bounded queue of `queueLength` slots allocated once in
+ * `begin()`. When every slot is in use a submit waits up to `waitMs` and
+ * then returns `nullptr` (backpressure); nothing else blocks the caller.
+ * Requests run one at a time in submit order.
+ *
+ * With a callback the slot is recycled right after the callback returns.
+ * Without one the caller owns the returned request until `release()`;
+ * releasing a request that is still queued lets it run and discards the
+ * result.
+ *
+ *     SupabaseAsync async(db);
+ *     async.begin();
+ *     async.insert("sensors", "{\"value\":42}", false, onInserted);
+ */
+class SupabaseAsync
+{
+public:
+    SupabaseAsync(Supabase &db, size_t queueLength = 8);
+    ~SupabaseAsync();
+
+    /** Allocate the queue and start the worker task */
+    bool begin(uint32_t stackSize = 8192, UBaseType_t priority = 1, BaseType_t core = tskNO_AFFINITY);
+    /** Run what is already queued, then stop the worker task */
+    void end();
+    bool running() const { return worker != nullptr; }
+
+    /** `query` is the `table?filters` part of the URL, as built by
+     * `SupabaseQuery` */
+    SupabaseAsyncRequest *select(const String &query, SupabaseAsyncCallback callback = nullptr,
+                                 void *ctx = nullptr, unsigned long waitMs = 0);
+    SupabaseAsyncRequest *select(const SupabaseQuery &query, SupabaseAsyncCallback callback = nullptr,
+                                 void *ctx = nullptr, unsigned long waitMs = 0);
+    SupabaseAsyncRequest *insert(const String &table, const String &json, bool upsert = false,
+                                 SupabaseAsyncCallback callback = nullptr, void *ctx = nullptr,
+                                 unsigned long waitMs = 0);
+    SupabaseAsyncRequest *update(const String &query, const String &json, SupabaseAsyncCallback callback = nullptr,
+                                 void *ctx = nullptr, unsigned long waitMs = 0);
+    SupabaseAsyncRequest *update(const SupabaseQuery &query, const String &json, SupabaseAsyncCallback callback = nullptr,
+                                 void *ctx = nullptr, unsigned long waitMs = 0);
+    SupabaseAsyncRequest *rpc(const String &func, const String &params, SupabaseAsyncCallback callback = nullptr,
+                              void *ctx = nullptr, unsigned long waitMs = 0);
+
+    /** Give a request without callback back to the queue */
+    void release(SupabaseAsyncRequest *request);
+
+    /** Requests queued or running */
+    size_t pending() const;
+    size_t capacity() const { return length; }
+    /** Submits refused because the queue stayed full */
+    unsigned long rejected() const { return rejectedCount; }
+
+private:
+    friend class Supabase;
+
+    Supabase &db;
+    size_t length;
+    SupabaseAsyncRequest *slots;
+    QueueHandle_t queue;
+    SemaphoreHandle_t freeSlots;
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t stopped;
+    TaskHandle_t worker;
+    unsigned long rejectedCount;
+
+    SupabaseAsyncRequest *submit(SupabaseAsyncOp op, const String &target, const String &payload,
+                                 SupabaseAsyncCallback callback, void *ctx, unsigned long waitMs);
+    void run(SupabaseAsyncRequest *request);
+    void recycle(SupabaseAsyncRequest *request);
+    static void task(void *arg);
+};
+
+#endif
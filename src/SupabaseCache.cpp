@@ -0,0 +1,188 @@
+#include "SupabaseCache.h"
+
+SupabaseCache::SupabaseCache(size_t budgetBytes, uint8_t maxEntries, unsigned long ttlMs)
+{
+    this->maxEntries = maxEntries ? maxEntries : 1;
+    entries = new Entry[this->maxEntries];
+    for (uint8_t i = 0; i < this->maxEntries; i++)
+    {
+        entries[i].live = false;
+    }
+    budget = budgetBytes;
+    used = 0;
+    defaultTtl = ttlMs;
+    clock = 0;
+    memset(&cacheStats, 0, sizeof(cacheStats));
+    lock = xSemaphoreCreateMutex();
+}
+
+SupabaseCache::~SupabaseCache()
+{
+    delete[] entries;
+    vSemaphoreDelete(lock);
+}
+
+// FNV-1a: compared first so most misses never touch the key strings
+uint32_t SupabaseCache::hashKey(const char *key, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t)key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Called with `lock` held
+SupabaseCache::Entry *SupabaseCache::find(const char *key, size_t length, uint32_t hash)
+{
+    for (uint8_t i = 0; i < maxEntries; i++)
+    {
+        Entry &entry = entries[i];
+        if (entry.live && entry.hash == hash && entry.key.length() == length && memcmp(entry.key.c_str(), key, length) == 0)
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// Called with `lock` held
+void SupabaseCache::drop(Entry &entry)
+{
+    used -= entry.key.length() + entry.body.length() + entry.etag.length();
+    entry.live = false;
+    // Give the memory back now, not when the slot is reused
+    entry.key = String();
+    entry.body = String();
+    entry.etag = String();
+}
+
+SupabaseCache::Lookup SupabaseCache::lookup(const char *key, size_t length, String &body, String &etag)
+{
+    Lookup state = CACHE_MISS;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    Entry *entry = find(key, length, hashKey(key, length));
+    if (entry)
+    {
+        entry->lastUse = ++clock;
+        if (millis() - entry->stored < entry->ttl)
+        {
+            body = entry->body;
+            state = CACHE_FRESH;
+            cacheStats.hits++;
+        }
+        else if (entry->etag.length())
+        {
+            // Kept as the answer in case the server replies 304
+            body = entry->body;
+            etag = entry->etag;
+            state = CACHE_STALE;
+        }
+        else
+        {
+            drop(*entry);
+        }
+    }
+    if (state == CACHE_MISS)
+    {
+        cacheStats.misses++;
+    }
+    xSemaphoreGive(lock);
+    return state;
+}
+
+void SupabaseCache::store(const char *key, size_t length, const String &body, const String &etag, unsigned long ttl)
+{
+    size_t size = length + body.length() + etag.length();
+    if (size > budget)
+    {
+        return;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint32_t hash = hashKey(key, length);
+    Entry *entry = find(key, length, hash);
+    if (entry)
+    {
+        drop(*entry);
+    }
+    // Evict least recently used entries until it fits and a slot is free
+    while (true)
+    {
+        Entry *oldest = nullptr;
+        entry = nullptr;
+        for (uint8_t i = 0; i < maxEntries; i++)
+        {
+            if (!entries[i].live)
+            {
+                entry = &entries[i];
+            }
+            else if (oldest == nullptr || (int32_t)(entries[i].lastUse - oldest->lastUse) < 0)
+            {
+                oldest = &entries[i];
+            }
+        }
+        if (entry && used + size <= budget)
+        {
+            break;
+        }
+        drop(*oldest);
+        cacheStats.evictions++;
+    }
+
+    const char *query = (const char *)memchr(key, '?', length);
+    entry->live = true;
+    entry->hash = hash;
+    entry->tableLength = query ? query - key : length;
+    entry->lastUse = ++clock;
+    entry->stored = millis();
+    entry->ttl = ttl;
+    entry->key.reserve(length);
+    entry->key.concat(key, length);
+    entry->body = body;
+    entry->etag = etag;
+    used += size;
+    xSemaphoreGive(lock);
+}
+
+void SupabaseCache::revalidated(const char *key, size_t length, unsigned long ttl)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    Entry *entry = find(key, length, hashKey(key, length));
+    if (entry)
+    {
+        entry->stored = millis();
+        entry->ttl = ttl;
+        cacheStats.revalidated++;
+    }
+    xSemaphoreGive(lock);
+}
+
+void SupabaseCache::invalidate(const char *table, size_t length)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < maxEntries; i++)
+    {
+        Entry &entry = entries[i];
+        if (entry.live && entry.tableLength == length && memcmp(entry.key.c_str(), table, length) == 0)
+        {
+            drop(entry);
+            cacheStats.invalidations++;
+        }
+    }
+    xSemaphoreGive(lock);
+}
+
+void SupabaseCache::clear()
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < maxEntries; i++)
+    {
+        if (entries[i].live)
+        {
+            drop(entries[i]);
+        }
+    }
+    xSemaphoreGive(lock);
+}
@@ -0,0 +1,102 @@
+#ifndef SupabaseCache_h
+#define SupabaseCache_h
+
+#include "ESP32_Supabase.h"
+
+struct SupabaseCacheStats
+{
+    /** Selects answered from memory */
+    unsigned long hits;
+    /** Selects sent because nothing was cached */
+    unsigned long misses;
+    /** Expired entries confirmed unchanged by the server (304) */
+    unsigned long revalidated;
+    /** Entries removed to stay within the budget */
+    unsigned long evictions;
+    /** Entries removed by a write or realtime change of their table */
+    unsigned long invalidations;
+};
+
+/** Bounded cache of `doSelect()` responses, keyed by the query
+ * (`table?filters`).
+ *
+ * Attached with `Supabase::setCache()`. A fresh entry is returned without
+ * any request. Once its TTL passed, the select is sent again with
+ * `If-None-Match` when the server gave an `ETag`, and a `304 Not Modified`
+ * keeps the cached body. Stored bodies, keys and ETags share a budget of
+ * `budgetBytes` across at most `maxEntries` entries; the least recently
+ * used ones are evicted to make room, and a response larger than the
+ * whole budget is not cached.
+ *
+ * All entries of a table are dropped when this client writes to it, and
+ * when a realtime change of it arrives on a subscription (a `nullptr`
+ * handler is enough). Logging in clears the cache.
+ *
+ *     SupabaseCache cache(8192, 16, 60000);
+ *     db.setCache(&cache);
+ *     String config = db.from("config").select("*").doSelect();
+ *     String rates = db.cacheFor(600000).from("rates").select("*").doSelect();
+ */
+class SupabaseCache
+{
+public:
+    SupabaseCache(size_t budgetBytes = 8192, uint8_t maxEntries = 16, unsigned long ttlMs = 60000);
+    ~SupabaseCache();
+
+    /** TTL of queries without `Supabase::cacheFor()` */
+    void setTtl(unsigned long ms) { defaultTtl = ms; }
+    unsigned long ttl() const { return defaultTtl; }
+
+    /** Drop every query of `table` */
+    void invalidate(const String &table) { invalidate(table.c_str(), table.length()); }
+    void invalidate(const char *table, size_t length);
+    void clear();
+
+    /** Bytes held (bodies, keys and ETags) */
+    size_t bytes() const { return used; }
+    const SupabaseCacheStats &stats() const { return cacheStats; }
+
+private:
+    friend class Supabase;
+
+    enum Lookup
+    {
+        CACHE_MISS,
+        CACHE_FRESH,
+        /** Expired but has an ETag to revalidate with */
+        CACHE_STALE
+    };
+
+    struct Entry
+    {
+        bool live;
+        uint32_t hash;
+        /** Length of the table name at the start of `key` */
+        uint16_t tableLength;
+        uint32_t lastUse;
+        unsigned long stored;
+        unsigned long ttl;
+        String key;
+        String body;
+        String etag;
+    };
+
+    Entry *entries;
+    uint8_t maxEntries;
+    size_t budget;
+    size_t used;
+    unsigned long defaultTtl;
+    uint32_t clock;
+    SemaphoreHandle_t lock;
+    SupabaseCacheStats cacheStats;
+
+    Lookup lookup(const char *key, size_t length, String &body, String &etag);
+    void store(const char *key, size_t length, const String &body, const String &etag, unsigned long ttl);
+    void revalidated(const char *key, size_t length, unsigned long ttl);
+
+    Entry *find(const char *key, size_t length, uint32_t hash);
+    void drop(Entry &entry);
+    static uint32_t hashKey(const char *key, size_t length);
+};
+
+#endif
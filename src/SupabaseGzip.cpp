@@ -0,0 +1,628 @@
+#include "SupabaseGzip.h"
+
+static const uint32_t crcTable[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+uint32_t supabaseCrc32(uint32_t crc, const uint8_t *data, size_t length)
+{
+    // Nibble table: 64 bytes instead of 1 KB for the byte-wise one
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = crcTable[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+        crc = crcTable[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+// Base values and extra bits of length symbols 257..285 and distance
+// symbols 0..29 (RFC 1951, 3.2.5)
+static const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                          193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                          6145, 8193, 12289, 16385, 24577};
+static const uint8_t distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                          6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static const uint16_t WINDOW_SIZE = 32768;
+static const uint16_t WINDOW_MASK = WINDOW_SIZE - 1;
+
+// Compression
+
+namespace
+{
+
+struct BitWriter
+{
+    uint8_t *out;
+    size_t capacity;
+    size_t used;
+    uint32_t buf;
+    uint8_t count;
+
+    bool put(uint32_t value, uint8_t n)
+    {
+        buf |= value << count;
+        count += n;
+        while (count >= 8)
+        {
+            if (used == capacity)
+            {
+                return false;
+            }
+            out[used++] = buf;
+            buf >>= 8;
+            count -= 8;
+        }
+        return true;
+    }
+
+    /** Huffman codes are defined MSB first */
+    bool code(uint32_t value, uint8_t n)
+    {
+        uint32_t reversed = 0;
+        for (uint8_t i = 0; i < n; i++)
+        {
+            reversed = (reversed << 1) | ((value >> i) & 1);
+        }
+        return put(reversed, n);
+    }
+
+    bool literal(uint16_t symbol)
+    {
+        if (symbol < 144)
+        {
+            return code(0x30 + symbol, 8);
+        }
+        if (symbol < 256)
+        {
+            return code(0x190 + symbol - 144, 9);
+        }
+        if (symbol < 280)
+        {
+            return code(symbol - 256, 7);
+        }
+        return code(0xC0 + symbol - 280, 8);
+    }
+
+    bool match(uint16_t length, uint16_t distance)
+    {
+        uint8_t l = 28;
+        while (lengthBase[l] > length)
+        {
+            l--;
+        }
+        uint8_t d = 29;
+        while (distanceBase[d] > distance)
+        {
+            d--;
+        }
+        return literal(257 + l) && put(length - lengthBase[l], lengthExtra[l]) && code(d, 5) &&
+               put(distance - distanceBase[d], distanceExtra[d]);
+    }
+
+    bool flush()
+    {
+        return count == 0 || put(0, 8 - count);
+    }
+};
+
+} // namespace
+
+size_t supabaseGzip(const uint8_t *in, size_t length, uint8_t *out, size_t capacity)
+{
+    static const uint8_t HASH_BITS = 11;
+    static const uint8_t gzipHeader[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+
+    if (capacity < sizeof(gzipHeader) + 8)
+    {
+        return 0;
+    }
+    uint32_t *head = (uint32_t *)malloc(sizeof(uint32_t) << HASH_BITS);
+    if (head == nullptr)
+    {
+        return 0;
+    }
+    // Positions are stored + 1, so 0 means none
+    memset(head, 0, sizeof(uint32_t) << HASH_BITS);
+
+    memcpy(out, gzipHeader, sizeof(gzipHeader));
+    BitWriter w = {out, capacity - 8, sizeof(gzipHeader), 0, 0};
+    // One final block with the fixed codes
+    bool ok = w.put(1, 1) && w.put(1, 2);
+
+    size_t i = 0;
+    while (ok && i < length)
+    {
+        uint16_t best = 0;
+        size_t from = 0;
+        if (i + 3 <= length)
+        {
+            uint32_t h = ((in[i] << 16 | in[i + 1] << 8 | in[i + 2]) * 2654435761u) >> (32 - HASH_BITS);
+            uint32_t candidate = head[h];
+            head[h] = i + 1;
+            if (candidate && i - (candidate - 1) <= WINDOW_SIZE)
+            {
+                from = candidate - 1;
+                size_t max = length - i < 258 ? length - i : 258;
+                while (best < max && in[from + best] == in[i + best])
+                {
+                    best++;
+                }
+            }
+        }
+        if (best >= 3)
+        {
+            ok = w.match(best, i - from);
+            i += best;
+        }
+        else
+        {
+            ok = w.literal(in[i]);
+            i++;
+        }
+    }
+    ok = ok && w.literal(256) && w.flush();
+    free(head);
+    if (!ok)
+    {
+        return 0;
+    }
+
+    uint32_t crc = supabaseCrc32(0, in, length);
+    size_t n = w.used;
+    for (uint8_t b = 0; b < 4; b++)
+    {
+        out[n++] = crc >> (8 * b);
+    }
+    for (uint8_t b = 0; b < 4; b++)
+    {
+        out[n++] = (uint32_t)length >> (8 * b);
+    }
+    return n;
+}
+
+// Decompression, after Mark Adler's puff.c
+
+SupabaseInflateStream::SupabaseInflateStream()
+{
+    src = nullptr;
+    window = nullptr;
+    state = DONE;
+    peeked = -1;
+    lengthCode.symbol = lengthSymbols;
+    distanceCode.symbol = distanceSymbols;
+}
+
+SupabaseInflateStream::~SupabaseInflateStream()
+{
+    release();
+}
+
+void SupabaseInflateStream::release()
+{
+    free(window);
+    window = nullptr;
+}
+
+bool SupabaseInflateStream::begin(Stream *source)
+{
+    src = source;
+    pos = 0;
+    bitBuf = 0;
+    bitCount = 0;
+    last = false;
+    peeked = -1;
+    crc = 0;
+    size = 0;
+    state = FAILED;
+    if (window == nullptr && (window = (uint8_t *)malloc(WINDOW_SIZE)) == nullptr)
+    {
+        return false;
+    }
+    state = BLOCK;
+    if (!header())
+    {
+        state = FAILED;
+        return false;
+    }
+    return true;
+}
+
+int SupabaseInflateStream::byte()
+{
+    int c = src->read();
+    if (c < 0)
+    {
+        state = FAILED;
+    }
+    return c;
+}
+
+bool SupabaseInflateStream::header()
+{
+    uint8_t fixed[10];
+    for (uint8_t i = 0; i < sizeof(fixed); i++)
+    {
+        int c = byte();
+        if (c < 0)
+        {
+            return false;
+        }
+        fixed[i] = c;
+    }
+    if (fixed[0] != 0x1f || fixed[1] != 0x8b || fixed[2] != 8)
+    {
+        return false;
+    }
+    uint8_t flags = fixed[3];
+    if (flags & 4)
+    {
+        // FEXTRA
+        int lo = byte();
+        int hi = byte();
+        for (long n = lo | hi << 8; n > 0 && state != FAILED; n--)
+        {
+            byte();
+        }
+    }
+    // FNAME, FCOMMENT: zero-terminated
+    for (uint8_t flag = 8; flag <= 16; flag <<= 1)
+    {
+        if (flags & flag)
+        {
+            int c;
+            while ((c = byte()) > 0)
+            {
+            }
+        }
+    }
+    if (flags & 2)
+    {
+        // FHCRC
+        byte();
+        byte();
+    }
+    return state != FAILED;
+}
+
+int SupabaseInflateStream::bits(uint8_t n)
+{
+    while (bitCount < n)
+    {
+        int c = byte();
+        if (c < 0)
+        {
+            return 0;
+        }
+        bitBuf |= (uint32_t)c << bitCount;
+        bitCount += 8;
+    }
+    int value = bitBuf & ((1UL << n) - 1);
+    bitBuf >>= n;
+    bitCount -= n;
+    return value;
+}
+
+int SupabaseInflateStream::decode(const Huffman &h)
+{
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (uint8_t len = 1; len < 16; len++)
+    {
+        code |= bits(1);
+        int count = h.count[len];
+        if (code - count < first)
+        {
+            return h.symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+// Returns 0 for a complete code, > 0 for an incomplete one, < 0 if
+// over-subscribed
+int SupabaseInflateStream::construct(Huffman &h, const uint8_t *lengths, int n)
+{
+    memset(h.count, 0, sizeof(h.count));
+    for (int symbol = 0; symbol < n; symbol++)
+    {
+        h.count[lengths[symbol]]++;
+    }
+    if (h.count[0] == n)
+    {
+        return 0;
+    }
+    int left = 1;
+    for (uint8_t len = 1; len < 16; len++)
+    {
+        left <<= 1;
+        left -= h.count[len];
+        if (left < 0)
+        {
+            return left;
+        }
+    }
+    uint16_t offsets[16];
+    offsets[1] = 0;
+    for (uint8_t len = 1; len < 15; len++)
+    {
+        offsets[len + 1] = offsets[len] + h.count[len];
+    }
+    for (int symbol = 0; symbol < n; symbol++)
+    {
+        if (lengths[symbol])
+        {
+            h.symbol[offsets[lengths[symbol]]++] = symbol;
+        }
+    }
+    return left;
+}
+
+bool SupabaseInflateStream::dynamicCodes()
+{
+    static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    uint8_t lengths[320];
+
+    int nlen = bits(5) + 257;
+    int ndist = bits(5) + 1;
+    int ncode = bits(4) + 4;
+    if (nlen > 286 || ndist > 30)
+    {
+        return false;
+    }
+    for (int i = 0; i < 19; i++)
+    {
+        lengths[order[i]] = i < ncode ? bits(3) : 0;
+    }
+    // The code length code goes into `lengthCode` for now
+    if (construct(lengthCode, lengths, 19) != 0)
+    {
+        return false;
+    }
+
+    for (int index = 0; index < nlen + ndist;)
+    {
+        int symbol = decode(lengthCode);
+        if (symbol < 0 || state == FAILED)
+        {
+            return false;
+        }
+        if (symbol < 16)
+        {
+            lengths[index++] = symbol;
+            continue;
+        }
+        uint8_t value = 0;
+        int repeat;
+        if (symbol == 16)
+        {
+            if (index == 0)
+            {
+                return false;
+            }
+            value = lengths[index - 1];
+            repeat = 3 + bits(2);
+        }
+        else if (symbol == 17)
+        {
+            repeat = 3 + bits(3);
+        }
+        else
+        {
+            repeat = 11 + bits(7);
+        }
+        if (index + repeat > nlen + ndist)
+        {
+            return false;
+        }
+        while (repeat--)
+        {
+            lengths[index++] = value;
+        }
+    }
+    // Without an end-of-block code nothing could be decoded
+    if (lengths[256] == 0)
+    {
+        return false;
+    }
+    int err = construct(lengthCode, lengths, nlen);
+    if (err < 0 || (err > 0 && nlen - lengthCode.count[0] != 1))
+    {
+        return false;
+    }
+    err = construct(distanceCode, lengths + nlen, ndist);
+    if (err < 0 || (err > 0 && ndist - distanceCode.count[0] != 1))
+    {
+        return false;
+    }
+    return state != FAILED;
+}
+
+bool SupabaseInflateStream::block()
+{
+    last = bits(1);
+    int type = bits(2);
+    if (state == FAILED)
+    {
+        return false;
+    }
+    if (type == 0)
+    {
+        // Stored: byte aligned LEN, NLEN, then raw bytes
+        bitBuf = 0;
+        bitCount = 0;
+        int len = bits(16);
+        int nlen = bits(16);
+        if (state == FAILED || len != (~nlen & 0xFFFF))
+        {
+            return false;
+        }
+        storedLeft = len;
+        state = STORED;
+        return true;
+    }
+    if (type == 1)
+    {
+        uint8_t lengths[288];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        construct(lengthCode, lengths, 288);
+        memset(lengths, 5, 30);
+        construct(distanceCode, lengths, 30);
+        state = CODES;
+        return true;
+    }
+    if (type == 2 && dynamicCodes())
+    {
+        state = CODES;
+        return true;
+    }
+    return false;
+}
+
+int SupabaseInflateStream::emit(uint8_t c)
+{
+    window[pos] = c;
+    pos = (pos + 1) & WINDOW_MASK;
+    crc = supabaseCrc32(crc, &c, 1);
+    size++;
+    return c;
+}
+
+int SupabaseInflateStream::next()
+{
+    while (true)
+    {
+        switch (state)
+        {
+        case BLOCK:
+            if (!block())
+            {
+                state = FAILED;
+            }
+            break;
+        case STORED:
+            if (storedLeft)
+            {
+                int c = byte();
+                if (c < 0)
+                {
+                    return -1;
+                }
+                storedLeft--;
+                return emit(c);
+            }
+            state = last ? TRAILER : BLOCK;
+            break;
+        case CODES:
+        {
+            int symbol = decode(lengthCode);
+            if (state == FAILED)
+            {
+                return -1;
+            }
+            if (symbol < 0)
+            {
+                state = FAILED;
+                return -1;
+            }
+            if (symbol < 256)
+            {
+                return emit(symbol);
+            }
+            if (symbol == 256)
+            {
+                state = last ? TRAILER : BLOCK;
+                break;
+            }
+            symbol -= 257;
+            if (symbol >= 29)
+            {
+                state = FAILED;
+                return -1;
+            }
+            int length = lengthBase[symbol] + bits(lengthExtra[symbol]);
+            int distanceSymbol = decode(distanceCode);
+            if (distanceSymbol < 0 || distanceSymbol >= 30)
+            {
+                state = FAILED;
+                return -1;
+            }
+            int distance = distanceBase[distanceSymbol] + bits(distanceExtra[distanceSymbol]);
+            if (state == FAILED || (uint32_t)distance > size)
+            {
+                state = FAILED;
+                return -1;
+            }
+            copyLeft = length;
+            copyDist = distance;
+            state = COPY;
+            break;
+        }
+        case COPY:
+            if (copyLeft)
+            {
+                copyLeft--;
+                return emit(window[(pos - copyDist) & WINDOW_MASK]);
+            }
+            state = CODES;
+            break;
+        case TRAILER:
+        {
+            // Byte aligned CRC-32 and length of the data, little endian
+            bitBuf = 0;
+            bitCount = 0;
+            uint32_t expectCrc = bits(16);
+            expectCrc |= (uint32_t)bits(16) << 16;
+            uint32_t expectSize = bits(16);
+            expectSize |= (uint32_t)bits(16) << 16;
+            state = state != FAILED && expectCrc == crc && expectSize == size ? DONE : FAILED;
+            break;
+        }
+        case DONE:
+        case FAILED:
+            return -1;
+        }
+    }
+}
+
+int SupabaseInflateStream::available()
+{
+    if (peeked >= 0)
+    {
+        return 1;
+    }
+    return state == DONE || state == FAILED ? 0 : 1;
+}
+
+int SupabaseInflateStream::read()
+{
+    if (peeked >= 0)
+    {
+        int c = peeked;
+        peeked = -1;
+        return c;
+    }
+    return next();
+}
+
+int SupabaseInflateStream::peek()
+{
+    if (peeked < 0)
+    {
+        peeked = next();
+    }
+    return peeked;
+}
@@ -0,0 +1,96 @@
+#ifndef SupabaseGzip_h
+#define SupabaseGzip_h
+
+#include <Arduino.h>
+
+/** CRC-32 (IEEE, as in gzip). Start with `crc = 0`, feed the data in any
+ * number of pieces */
+uint32_t supabaseCrc32(uint32_t crc, const uint8_t *data, size_t length);
+
+/** Compress `length` bytes of `in` into a gzip member in `out`.
+ * Greedy LZ77 over the whole input with fixed Huffman codes: no window
+ * state, a 8 KB hash table while it runs. Returns the compressed size, or
+ * 0 if it did not fit into `capacity` (send the data uncompressed then) */
+size_t supabaseGzip(const uint8_t *in, size_t length, uint8_t *out, size_t capacity);
+
+/** Decompresses a gzip body while it is read.
+ *
+ * Wraps the response stream of a request sent with
+ * `Accept-Encoding: gzip`, so the JSON parser reads plain JSON and no
+ * decompressed copy of the body is ever held. Needs a 32 KB window for
+ * back-references, allocated by the first `begin()` and kept until
+ * `release()`. `read()` returns -1 at the end of the data, or when the
+ * stream is corrupt (`failed()`): the CRC and length of the trailer are
+ * checked */
+class SupabaseInflateStream : public Stream
+{
+public:
+    SupabaseInflateStream();
+    ~SupabaseInflateStream();
+
+    /** Start on `source`. Returns `false` if it does not begin with a gzip
+     * header or the window cannot be allocated */
+    bool begin(Stream *source);
+    /** Free the window */
+    void release();
+
+    bool failed() const { return state == FAILED; }
+    /** Decompressed bytes delivered so far */
+    unsigned long produced() const { return size; }
+
+    int available();
+    int read();
+    int peek();
+    void flush() {}
+    size_t write(uint8_t) { return 0; }
+
+private:
+    enum State : uint8_t
+    {
+        BLOCK,
+        STORED,
+        CODES,
+        COPY,
+        TRAILER,
+        DONE,
+        FAILED
+    };
+
+    /** Canonical Huffman code: number of codes per length, symbols by code */
+    struct Huffman
+    {
+        uint16_t count[16];
+        uint16_t *symbol;
+    };
+
+    Stream *src;
+    uint8_t *window;
+    uint16_t pos;
+    uint32_t bitBuf;
+    uint8_t bitCount;
+    State state;
+    bool last;
+    uint16_t storedLeft;
+    uint16_t copyLeft;
+    uint16_t copyDist;
+    int peeked;
+    uint32_t crc;
+    uint32_t size;
+
+    uint16_t lengthSymbols[288];
+    uint16_t distanceSymbols[30];
+    Huffman lengthCode;
+    Huffman distanceCode;
+
+    int byte();
+    int bits(uint8_t n);
+    int decode(const Huffman &h);
+    static int construct(Huffman &h, const uint8_t *lengths, int n);
+    bool header();
+    bool block();
+    bool dynamicCodes();
+    int emit(uint8_t c);
+    int next();
+};
+
+#endif
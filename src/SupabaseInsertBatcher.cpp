@@ -0,0 +1,127 @@
+#include "SupabaseInsertBatcher.h"
+
+SupabaseInsertBatcher::SupabaseInsertBatcher(Supabase &db_a, const String &table_a, size_t maxBytes,
+                                             size_t maxRows_a, unsigned long maxDelayMs_a, bool upsert_a)
+    : db(db_a), table(table_a)
+{
+    // Room for the brackets around the rows
+    capacity = maxBytes < 3 ? 3 : maxBytes;
+    buffer = (char *)malloc(capacity);
+    if (buffer == nullptr)
+    {
+        capacity = 0;
+    }
+    used = 0;
+    rows = 0;
+    maxRows = maxRows_a ? maxRows_a : 1;
+    maxDelayMs = maxDelayMs_a;
+    firstAdded = 0;
+    upsert = upsert_a;
+    nextRow = 0;
+    callback = nullptr;
+    callbackCtx = nullptr;
+    sentRows = 0;
+    sentBatches = 0;
+    failedBatches = 0;
+}
+
+SupabaseInsertBatcher::~SupabaseInsertBatcher()
+{
+    free(buffer);
+}
+
+void SupabaseInsertBatcher::onFlush(SupabaseBatchCallback callback_a, void *ctx)
+{
+    callback = callback_a;
+    callbackCtx = ctx;
+}
+
+long SupabaseInsertBatcher::add(const char *json, size_t length)
+{
+    // Trim surrounding whitespace so only the object itself is copied
+    while (length > 0 && isspace((unsigned char)json[0]))
+    {
+        json++;
+        length--;
+    }
+    while (length > 0 && isspace((unsigned char)json[length - 1]))
+    {
+        length--;
+    }
+    if (length < 2 || json[0] != '{' || json[length - 1] != '}')
+    {
+        return -1;
+    }
+    // "[" + row + "]"
+    if (length + 2 > capacity)
+    {
+        return -1;
+    }
+
+    // "," + row + "]" must still fit
+    if (rows > 0 && used + 1 + length + 1 > capacity)
+    {
+        flush();
+    }
+
+    if (rows == 0)
+    {
+        buffer[0] = '[';
+        used = 1;
+        firstAdded = millis();
+    }
+    else
+    {
+        buffer[used++] = ',';
+    }
+    memcpy(buffer + used, json, length);
+    used += length;
+    rows++;
+
+    long row = nextRow++;
+    if (rows >= maxRows)
+    {
+        flush();
+    }
+    return row;
+}
+
+int SupabaseInsertBatcher::flush()
+{
+    if (rows == 0)
+    {
+        return 0;
+    }
+    buffer[used++] = ']';
+
+    int httpCode = db.insert(table, buffer, used, upsert);
+
+    uint32_t firstRow = nextRow - rows;
+    size_t count = rows;
+    used = 0;
+    rows = 0;
+
+    sentBatches++;
+    // Journaled rows are delivered by the replay
+    if ((httpCode >= 200 && httpCode < 300) || httpCode == SUPABASE_JOURNALED)
+    {
+        sentRows += count;
+    }
+    else
+    {
+        failedBatches++;
+    }
+    if (callback)
+    {
+        callback(table, firstRow, count, httpCode, callbackCtx);
+    }
+    return httpCode;
+}
+
+void SupabaseInsertBatcher::loop()
+{
+    if (rows > 0 && millis() - firstAdded >= maxDelayMs)
+    {
+        flush();
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef SupabaseInsertBatcher_h
+#define SupabaseInsertBatcher_h
+
+#include "ESP32_Supabase.h"
+
+/** Called after every flush. Rows `firstRow` .. `firstRow + rowCount - 1`
+ * (as numbered by `add()`) were sent in one request and share `httpCode`:
+ * PostgREST inserts a batch atomically, so either all of them were stored
+ * or none was. `SUPABASE_JOURNALED` (-104) means the batch is kept in the
+ * offline journal and sent by its replay */
+typedef void (*SupabaseBatchCallback)(const String &table, uint32_t firstRow, size_t rowCount, int httpCode, void *ctx);
+
+/** Collects single-row inserts for one table into one PostgREST bulk insert
+ * (`[row,row,...]`) held in a fixed buffer allocated once.
+ *
+ * A batch is sent when the next row would not fit in `maxBytes`, when
+ * `maxRows` rows are buffered or when the oldest buffered row is
+ * `maxDelayMs` old (checked in `loop()`). Headers are the same as
+ * `Supabase::insert()` with the given `upsert`.
+ *
+ * PostgREST refuses a bulk insert whose rows do not all have the same keys
+ * (PGRST102), so every row of a batcher must carry the same fields; use
+ * `null` for a missing value. */
+class SupabaseInsertBatcher
+{
+public:
+    SupabaseInsertBatcher(Supabase &db, const String &table, size_t maxBytes = 4096,
+                          size_t maxRows = 100, unsigned long maxDelayMs = 1000, bool upsert = false);
+    ~SupabaseInsertBatcher();
+
+    /** Report the outcome of each flushed batch */
+    void onFlush(SupabaseBatchCallback callback, void *ctx = nullptr);
+
+    /** Queue one JSON object. Returns its row number (counting from 0 for
+     * the life of the batcher), or -1 if the row is larger than the buffer
+     * or not a JSON object. May flush (and block) first to make room */
+    long add(const char *json, size_t length);
+    long add(const String &json) { return add(json.c_str(), json.length()); }
+
+    /** Send buffered rows now. Returns the HTTP code (0 if nothing to send) */
+    int flush();
+
+    /** Call periodically: flushes once the oldest row is `maxDelayMs` old */
+    void loop();
+
+    size_t pendingRows() const { return rows; }
+    size_t pendingBytes() const { return used; }
+
+    /** Totals since construction */
+    unsigned long rowsSent() const { return sentRows; }
+    unsigned long batchesSent() const { return sentBatches; }
+    unsigned long batchesFailed() const { return failedBatches; }
+
+private:
+    Supabase &db;
+    String table;
+    char *buffer;
+    size_t capacity;
+    size_t used;
+    size_t rows;
+    size_t maxRows;
+    unsigned long maxDelayMs;
+    unsigned long firstAdded;
+    bool upsert;
+    uint32_t nextRow;
+
+    SupabaseBatchCallback callback;
+    void *callbackCtx;
+
+    unsigned long sentRows;
+    unsigned long sentBatches;
+    unsigned long failedBatches;
+};
+
+#endif
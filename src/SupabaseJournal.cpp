@@ -0,0 +1,669 @@
+#include "SupabaseJournal.h"
+#include "SupabaseGzip.h"
+
+// Record: magic (2), op (1), target length (1), body length (2, LE),
+// CRC-32 (4, LE) of op .. body length + target + body, then target, body
+static const uint8_t JOURNAL_MAGIC0 = 'S';
+static const uint8_t JOURNAL_MAGIC1 = 'J';
+static const size_t JOURNAL_HEADER = 10;
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+struct JournalRecord
+{
+    uint8_t raw[JOURNAL_HEADER];
+    uint8_t op() const { return raw[2]; }
+    size_t targetLength() const { return raw[3]; }
+    size_t bodyLength() const { return raw[4] | raw[5] << 8; }
+    uint32_t crc() const { return get32(raw + 6); }
+    size_t size() const { return JOURNAL_HEADER + targetLength() + bodyLength(); }
+
+    bool read(File &file)
+    {
+        return file.read(raw, JOURNAL_HEADER) == JOURNAL_HEADER && raw[0] == JOURNAL_MAGIC0 &&
+               raw[1] == JOURNAL_MAGIC1 && op() >= SUPABASE_JOURNAL_INSERT && op() <= SUPABASE_JOURNAL_UPDATE;
+    }
+};
+
+// Walks the records from `offset` and returns the end of the last intact
+// one. With `verify` every payload is checked against its CRC
+static uint32_t walkRecords(File &file, uint32_t offset, uint32_t size, bool verify, unsigned long *count)
+{
+    JournalRecord record;
+    uint8_t chunk[64];
+    file.seek(offset);
+    while (offset < size && record.read(file) && offset + record.size() <= size)
+    {
+        if (verify)
+        {
+            uint32_t crc = supabaseCrc32(0, record.raw + 2, 4);
+            for (size_t left = record.targetLength() + record.bodyLength(); left;)
+            {
+                size_t n = left < sizeof(chunk) ? left : sizeof(chunk);
+                if (file.read(chunk, n) != n)
+                {
+                    return offset;
+                }
+                crc = supabaseCrc32(crc, chunk, n);
+                left -= n;
+            }
+            if (crc != record.crc())
+            {
+                return offset;
+            }
+        }
+        else
+        {
+            file.seek(offset + record.size());
+        }
+        offset += record.size();
+        if (count)
+        {
+            (*count)++;
+        }
+    }
+    return offset;
+}
+
+// Order-independent checksum of the keys of each object in `body` (a row
+// or an array of rows). `uniform` is false if the rows differ: PostgREST
+// rejects a bulk insert whose rows do not share the same keys
+static uint32_t rowKeys(const char *body, size_t length, bool &uniform)
+{
+    uniform = true;
+    uint32_t keys = 0;
+    uint32_t row = 0;
+    bool first = true;
+    int depth = 0;
+    // Objects holding the keys are at depth 1, or 2 inside an array
+    int rowDepth = length && body[0] == '[' ? 2 : 1;
+    char last = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        char c = body[i];
+        if (c == '"')
+        {
+            size_t start = ++i;
+            while (i < length && body[i] != '"')
+            {
+                i += body[i] == '\\' ? 2 : 1;
+            }
+            if (depth == rowDepth && (last == '{' || last == ','))
+            {
+                row += supabaseCrc32(0, (const uint8_t *)body + start, (i < length ? i : length) - start);
+            }
+            last = '"';
+        }
+        else if (c == '{' || c == '[')
+        {
+            if (++depth == rowDepth)
+            {
+                row = 0;
+            }
+            last = c;
+        }
+        else if (c == '}' || c == ']')
+        {
+            if (depth-- == rowDepth)
+            {
+                if (first)
+                {
+                    keys = row;
+                    first = false;
+                }
+                else if (row != keys)
+                {
+                    uniform = false;
+                }
+            }
+            last = c;
+        }
+        else if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+        {
+            last = c;
+        }
+    }
+    return keys;
+}
+
+SupabaseJournal::SupabaseJournal(fs::FS &filesystem, const char *dir, size_t capacity, uint8_t segments,
+                                 SupabaseJournalPolicy policy, size_t batchBytes)
+    : files(filesystem), dir(dir)
+{
+    // The tail is always one of them: a ring needs at least two
+    this->segments = segments < 2 ? 2 : segments;
+    segmentSize = capacity / this->segments;
+    this->policy = policy;
+    this->batchBytes = batchBytes;
+    batch = nullptr;
+    firstSeq = 1;
+    lastSeq = 1;
+    tailSize = 0;
+    syncEvery = 1;
+    unsynced = 0;
+    readSeq = 1;
+    readOffset = 0;
+    replaying = false;
+    memset(&journalStats, 0, sizeof(journalStats));
+    lock = xSemaphoreCreateMutex();
+}
+
+SupabaseJournal::~SupabaseJournal()
+{
+    tail.close();
+    free(batch);
+    vSemaphoreDelete(lock);
+}
+
+String SupabaseJournal::segmentPath(uint32_t seq) const
+{
+    return dir + "/" + String((unsigned long)seq) + ".log";
+}
+
+bool SupabaseJournal::begin()
+{
+    if (batch == nullptr && (batch = (char *)malloc(batchBytes)) == nullptr)
+    {
+        return false;
+    }
+    if (!files.exists(dir) && !files.mkdir(dir))
+    {
+        return false;
+    }
+    File root = files.open(dir);
+    if (!root || !root.isDirectory())
+    {
+        return false;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    tail.close();
+    firstSeq = 0;
+    lastSeq = 0;
+    for (File entry = root.openNextFile(); entry; entry = root.openNextFile())
+    {
+        // `name()` is the base name (`12.log`) on current cores
+        const char *name = strrchr(entry.name(), '/');
+        name = name ? name + 1 : entry.name();
+        char *end;
+        uint32_t seq = strtoul(name, &end, 10);
+        if (end == name || strcmp(end, ".log") != 0 || seq == 0)
+        {
+            continue;
+        }
+        if (firstSeq == 0 || seq < firstSeq)
+        {
+            firstSeq = seq;
+        }
+        if (seq > lastSeq)
+        {
+            lastSeq = seq;
+        }
+    }
+    root.close();
+    if (lastSeq == 0)
+    {
+        firstSeq = lastSeq = 1;
+    }
+
+    // Resume from the saved position if it is intact and still exists
+    readSeq = firstSeq;
+    readOffset = 0;
+    File cursor = files.open(dir + "/cursor");
+    uint8_t raw[12];
+    if (cursor && cursor.read(raw, sizeof(raw)) == sizeof(raw) && get32(raw + 8) == supabaseCrc32(0, raw, 8) &&
+        get32(raw) >= firstSeq && get32(raw) <= lastSeq)
+    {
+        readSeq = get32(raw);
+        readOffset = get32(raw + 4);
+    }
+    cursor.close();
+
+    // Replayed segments whose removal was cut short by a reset
+    while (firstSeq < readSeq)
+    {
+        files.remove(segmentPath(firstSeq++));
+    }
+
+    // Fewer segments than the last run
+    while (lastSeq - firstSeq + 1 > segments)
+    {
+        dropOldest();
+    }
+
+    // A reset during an append leaves a torn record at the end of the tail.
+    // Appending after it would make the new records unreachable: start a
+    // new segment, replay stops at the torn record and skips the rest
+    File file = files.open(segmentPath(lastSeq));
+    tailSize = file ? file.size() : 0;
+    uint32_t intact = file ? walkRecords(file, readSeq == lastSeq ? readOffset : 0, tailSize, true, nullptr) : 0;
+    file.close();
+    if (intact < tailSize)
+    {
+        rotate();
+    }
+
+    xSemaphoreGive(lock);
+    return true;
+}
+
+bool SupabaseJournal::append(SupabaseJournalOp op, const char *target, size_t targetLength, const char *body,
+                             size_t bodyLength)
+{
+    size_t recordSize = JOURNAL_HEADER + targetLength + bodyLength;
+    // Must fit a replay batch with its brackets, and a segment
+    if (targetLength > 255 || bodyLength + 2 > batchBytes || bodyLength > 0xFFFF || recordSize > segmentSize)
+    {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        journalStats.dropped++;
+        xSemaphoreGive(lock);
+        return false;
+    }
+
+    uint8_t header[JOURNAL_HEADER];
+    header[0] = JOURNAL_MAGIC0;
+    header[1] = JOURNAL_MAGIC1;
+    header[2] = op;
+    header[3] = targetLength;
+    header[4] = bodyLength;
+    header[5] = bodyLength >> 8;
+    uint32_t crc = supabaseCrc32(0, header + 2, 4);
+    crc = supabaseCrc32(crc, (const uint8_t *)target, targetLength);
+    crc = supabaseCrc32(crc, (const uint8_t *)body, bodyLength);
+    put32(header + 6, crc);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (tailSize > 0 && tailSize + recordSize > segmentSize)
+    {
+        if (lastSeq - firstSeq + 1 >= segments && policy == SUPABASE_JOURNAL_DROP_NEWEST)
+        {
+            journalStats.dropped++;
+            xSemaphoreGive(lock);
+            return false;
+        }
+        // One more after `begin()` started a new segment past a torn record
+        while (lastSeq - firstSeq + 1 >= segments)
+        {
+            dropOldest();
+        }
+        rotate();
+    }
+
+    if (!tail)
+    {
+        tail = files.open(segmentPath(lastSeq), FILE_APPEND, true);
+    }
+    bool written = tail && tail.write(header, sizeof(header)) == sizeof(header) &&
+                   tail.write((const uint8_t *)target, targetLength) == targetLength &&
+                   tail.write((const uint8_t *)body, bodyLength) == bodyLength;
+    if (!written)
+    {
+        // Flash full or failing: whatever part made it is skipped as torn
+        rotate();
+        journalStats.dropped++;
+        xSemaphoreGive(lock);
+        return false;
+    }
+    tailSize += recordSize;
+    journalStats.appended++;
+    journalStats.bytesWritten += recordSize;
+    if (++unsynced >= syncEvery)
+    {
+        tail.flush();
+        unsynced = 0;
+    }
+    xSemaphoreGive(lock);
+    return true;
+}
+
+// Called with `lock` held
+void SupabaseJournal::rotate()
+{
+    tail.close();
+    lastSeq++;
+    tailSize = 0;
+    unsynced = 0;
+}
+
+// Called with `lock` held
+void SupabaseJournal::dropOldest()
+{
+    unsigned long count = 0;
+    if (readSeq == firstSeq)
+    {
+        File file = files.open(segmentPath(firstSeq));
+        if (file)
+        {
+            walkRecords(file, readOffset, file.size(), false, &count);
+        }
+    }
+    journalStats.dropped += count;
+    files.remove(segmentPath(firstSeq));
+    firstSeq++;
+    if (readSeq < firstSeq)
+    {
+        readSeq = firstSeq;
+        readOffset = 0;
+        saveCursor();
+    }
+}
+
+// Called with `lock` held
+void SupabaseJournal::saveCursor()
+{
+    uint8_t raw[12];
+    put32(raw, readSeq);
+    put32(raw + 4, readOffset);
+    put32(raw + 8, supabaseCrc32(0, raw, 8));
+    File cursor = files.open(dir + "/cursor", FILE_WRITE, true);
+    if (cursor)
+    {
+        cursor.write(raw, sizeof(raw));
+        cursor.close();
+        journalStats.cursorWrites++;
+    }
+}
+
+// Called with `lock` held. Opens `seq` for reading and returns the length
+// of its complete records
+size_t SupabaseJournal::segmentLength(uint32_t seq, File &file)
+{
+    if (seq == lastSeq)
+    {
+        // Make unsynced appends visible to the reader
+        if (tail)
+        {
+            tail.flush();
+            unsynced = 0;
+        }
+        file = files.open(segmentPath(seq));
+        return file ? tailSize : 0;
+    }
+    file = files.open(segmentPath(seq));
+    return file ? file.size() : 0;
+}
+
+// Called with `lock` held. Reads the next request into `batch`: one
+// update, or consecutive inserts into the same table (and with the same
+// upsert mode) and with the same keys merged into one array, unless
+// `single`. `length` is 0 if the records held no rows. Returns `false`
+// when nothing is left
+bool SupabaseJournal::nextBatch(SupabaseJournalOp &op, char *target, size_t &length, size_t &records,
+                                uint32_t &endOffset, bool single)
+{
+    while (true)
+    {
+        File file;
+        size_t size = segmentLength(readSeq, file);
+        if (readOffset >= size)
+        {
+            file.close();
+            if (readSeq == lastSeq)
+            {
+                return false;
+            }
+            // Segment fully replayed
+            files.remove(segmentPath(readSeq));
+            firstSeq = ++readSeq;
+            readOffset = 0;
+            saveCursor();
+            continue;
+        }
+
+        file.seek(readOffset);
+        uint32_t offset = readOffset;
+        char name[256];
+        bool rows = false;
+        uint32_t keys = 0;
+        bool mergeable = !single;
+        length = 0;
+        records = 0;
+        while (offset < size && (records == 0 || mergeable))
+        {
+            JournalRecord record;
+            bool intact = record.read(file) && offset + record.size() <= size;
+            char *recordTarget = records ? name : target;
+            if (intact)
+            {
+                intact = file.read((uint8_t *)recordTarget, record.targetLength()) == record.targetLength();
+                recordTarget[record.targetLength()] = '\0';
+            }
+            if (intact && records)
+            {
+                // Only inserts into the same table merge, while they fit
+                if (op == SUPABASE_JOURNAL_UPDATE || record.op() != op || strcmp(recordTarget, target) != 0 ||
+                    length + record.bodyLength() + 2 > batchBytes)
+                {
+                    break;
+                }
+            }
+
+            // Inserts: `[` + rows separated by `,` + `]`
+            char *body = batch;
+            if (intact && record.op() != SUPABASE_JOURNAL_UPDATE)
+            {
+                if (records == 0)
+                {
+                    batch[0] = '[';
+                    length = 1;
+                }
+                body = batch + length + (rows ? 1 : 0);
+            }
+            size_t bodyLength = record.bodyLength();
+            if (intact)
+            {
+                intact = file.read((uint8_t *)body, bodyLength) == bodyLength;
+            }
+            if (intact)
+            {
+                uint32_t crc = supabaseCrc32(0, record.raw + 2, 4);
+                crc = supabaseCrc32(crc, (const uint8_t *)recordTarget, record.targetLength());
+                intact = supabaseCrc32(crc, (const uint8_t *)body, bodyLength) == record.crc();
+            }
+            if (intact && record.op() != SUPABASE_JOURNAL_UPDATE)
+            {
+                bool uniform;
+                uint32_t recordKeys = rowKeys(body, bodyLength, uniform);
+                if (records == 0)
+                {
+                    keys = recordKeys;
+                    mergeable = mergeable && uniform;
+                }
+                else if (!uniform || recordKeys != keys)
+                {
+                    // Goes out in the next request
+                    break;
+                }
+            }
+            if (!intact)
+            {
+                if (records)
+                {
+                    // Send what came before, the torn record is handled next
+                    break;
+                }
+                // Torn write: nothing after it in this segment is readable
+                journalStats.corrupt++;
+                readOffset = size;
+                if (readSeq == lastSeq)
+                {
+                    rotate();
+                }
+                saveCursor();
+                break;
+            }
+
+            offset += record.size();
+            if (records++ == 0)
+            {
+                op = (SupabaseJournalOp)record.op();
+            }
+            if (op == SUPABASE_JOURNAL_UPDATE)
+            {
+                length = bodyLength;
+                break;
+            }
+            // Rows stored as an array (bulk insert) are merged unwrapped
+            if (bodyLength >= 2 && body[0] == '[' && body[bodyLength - 1] == ']')
+            {
+                memmove(body, body + 1, bodyLength - 2);
+                bodyLength -= 2;
+            }
+            if (bodyLength)
+            {
+                if (rows)
+                {
+                    batch[length] = ',';
+                    length++;
+                }
+                length += bodyLength;
+                rows = true;
+            }
+        }
+        if (records == 0)
+        {
+            continue;
+        }
+        if (op != SUPABASE_JOURNAL_UPDATE)
+        {
+            if (rows)
+            {
+                batch[length++] = ']';
+            }
+            else
+            {
+                length = 0;
+            }
+        }
+        endOffset = offset;
+        return true;
+    }
+}
+
+int SupabaseJournal::replay(Supabase &db, size_t maxBatches)
+{
+    int httpCode = 0;
+    char target[256];
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (replaying || batch == nullptr)
+    {
+        xSemaphoreGive(lock);
+        return 0;
+    }
+    replaying = true;
+    xSemaphoreGive(lock);
+
+    // Records of a rejected bulk insert still to be sent one by one
+    size_t single = 0;
+    for (size_t sent = 0; maxBatches == 0 || sent < maxBatches;)
+    {
+        SupabaseJournalOp op = SUPABASE_JOURNAL_INSERT;
+        size_t length = 0;
+        size_t records = 0;
+        uint32_t endOffset = 0;
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        bool found = nextBatch(op, target, length, records, endOffset, single > 0);
+        uint32_t seq = readSeq;
+        xSemaphoreGive(lock);
+        if (!found)
+        {
+            break;
+        }
+
+        // The lock is not held over the request: appends go on meanwhile
+        bool delivered = true;
+        if (length)
+        {
+            httpCode = db._send(op, target, strlen(target), batch, length);
+            sent++;
+            delivered = httpCode >= 200 && httpCode < 300;
+            bool retry = httpCode <= 0 || httpCode >= 500 || httpCode == 401 || httpCode == 408 || httpCode == 429;
+            if (!delivered && retry)
+            {
+                break;
+            }
+            if (!delivered && records > 1)
+            {
+                // One bad row fails the whole array: find it, keep the others
+                xSemaphoreTake(lock, portMAX_DELAY);
+                journalStats.batches++;
+                xSemaphoreGive(lock);
+                single = records;
+                continue;
+            }
+        }
+        if (single)
+        {
+            single--;
+        }
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        if (length)
+        {
+            journalStats.batches++;
+            if (delivered)
+            {
+                journalStats.replayed += records;
+            }
+            else
+            {
+                journalStats.rejected += records;
+            }
+        }
+        // Unless the ring dropped the segment meanwhile
+        if (readSeq == seq)
+        {
+            readOffset = endOffset;
+            saveCursor();
+        }
+        xSemaphoreGive(lock);
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    replaying = false;
+    xSemaphoreGive(lock);
+    return httpCode;
+}
+
+bool SupabaseJournal::empty()
+{
+    // Checked before every write: no file access
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool none = readSeq == lastSeq && readOffset >= tailSize;
+    xSemaphoreGive(lock);
+    return none;
+}
+
+size_t SupabaseJournal::pendingBytes()
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    size_t bytes = 0;
+    for (uint32_t seq = readSeq; seq <= lastSeq; seq++)
+    {
+        if (seq == lastSeq)
+        {
+            bytes += tailSize;
+        }
+        else
+        {
+            File file = files.open(segmentPath(seq));
+            bytes += file ? file.size() : 0;
+        }
+    }
+    bytes = bytes > readOffset ? bytes - readOffset : 0;
+    xSemaphoreGive(lock);
+    return bytes;
+}
@@ -0,0 +1,131 @@
+#ifndef SupabaseJournal_h
+#define SupabaseJournal_h
+
+#include "ESP32_Supabase.h"
+#include <FS.h>
+
+/** Minimum delay between replays that stopped on an error */
+#ifndef SUPABASE_JOURNAL_RETRY_MS
+#define SUPABASE_JOURNAL_RETRY_MS 5000
+#endif
+
+/** Replace the oldest segment or refuse new writes when the ring is full */
+enum SupabaseJournalPolicy
+{
+    SUPABASE_JOURNAL_DROP_OLDEST,
+    SUPABASE_JOURNAL_DROP_NEWEST
+};
+
+struct SupabaseJournalStats
+{
+    /** Records written to flash */
+    unsigned long appended;
+    /** Records delivered by a replay */
+    unsigned long replayed;
+    /** Records the server refused for good (4xx) and that were skipped */
+    unsigned long rejected;
+    /** Records lost to the size limit, or too large to store */
+    unsigned long dropped;
+    /** Records failing the frame or CRC check (torn writes) */
+    unsigned long corrupt;
+    /** Requests sent by replays */
+    unsigned long batches;
+    /** Bytes appended to flash, framing included */
+    unsigned long bytesWritten;
+    /** Replay position updates written to flash */
+    unsigned long cursorWrites;
+};
+
+/** Append-only journal on flash for writes that could not be sent.
+ *
+ * Attached with `Supabase::setJournal()`, inserts, upserts and updates
+ * issued while WiFi is down, or failing with a network error or 5xx, are
+ * stored here instead of being lost (plain inserts only if the request
+ * never left, a replay must not store a row twice), and so is every later write until
+ * the journal is empty again, to keep their order. When WiFi gets an IP
+ * the journal is replayed in order on the background worker task;
+ * consecutive inserts into the same table with the same keys go out as one
+ * bulk insert of up to `batchBytes`. When the server refuses such a bulk
+ * insert, its rows are sent again one by one so that only the bad ones are
+ * skipped.
+ *
+ * Records are framed with a CRC-32, so a write torn by a reset is
+ * detected and skipped. The journal is a ring of `segments` files of
+ * `capacity / segments` bytes under `dir`; when it is full the oldest
+ * segment is dropped (or new writes are refused, see
+ * `SupabaseJournalPolicy`). The replay position is saved after every
+ * delivered batch, so nothing is sent twice after a reboot unless the
+ * reboot hits between a request and that save.
+ *
+ *     SupabaseJournal journal(LittleFS);
+ *     LittleFS.begin(true);
+ *     journal.begin();
+ *     db.setJournal(&journal);
+ */
+class SupabaseJournal
+{
+public:
+    SupabaseJournal(fs::FS &filesystem, const char *dir = "/supabase", size_t capacity = 65536, uint8_t segments = 4,
+                    SupabaseJournalPolicy policy = SUPABASE_JOURNAL_DROP_OLDEST, size_t batchBytes = 4096);
+    ~SupabaseJournal();
+
+    /** Open the journal, resume from the saved replay position */
+    bool begin();
+
+    /** Store one write. `target` is the table (insert) or `table?filters`
+     * (update). Returns `false` if it was dropped */
+    bool append(SupabaseJournalOp op, const char *target, size_t targetLength, const char *body, size_t bodyLength);
+
+    /** Send stored writes in order, at most `maxBatches` requests (0 = until
+     * empty). Stops at the first network error, 5xx, 401, 408 or 429 and
+     * returns that code; records refused with another 4xx on their own are
+     * counted in `rejected` and skipped.
+     * Returns the last HTTP code, 0 if there was nothing to send */
+    int replay(Supabase &db, size_t maxBatches = 0);
+
+    bool empty();
+    /** Stored bytes not replayed yet */
+    size_t pendingBytes();
+
+    /** Flush to flash after every `records` appends (default 1). Higher
+     * values cut flash writes per record but risk the last unflushed
+     * records on a reset */
+    void setSyncEvery(uint16_t records) { syncEvery = records ? records : 1; }
+
+    const SupabaseJournalStats &stats() const { return journalStats; }
+
+private:
+    fs::FS &files;
+    String dir;
+    size_t segmentSize;
+    uint8_t segments;
+    SupabaseJournalPolicy policy;
+    char *batch;
+    size_t batchBytes;
+
+    // Segments `firstSeq` .. `lastSeq` exist, appends go to `lastSeq`
+    uint32_t firstSeq;
+    uint32_t lastSeq;
+    size_t tailSize;
+    File tail;
+    uint16_t syncEvery;
+    uint16_t unsynced;
+
+    // Replay position
+    uint32_t readSeq;
+    uint32_t readOffset;
+
+    SemaphoreHandle_t lock;
+    bool replaying;
+    SupabaseJournalStats journalStats;
+
+    String segmentPath(uint32_t seq) const;
+    void saveCursor();
+    void dropOldest();
+    void rotate();
+    size_t segmentLength(uint32_t seq, File &file);
+    bool nextBatch(SupabaseJournalOp &op, char *target, size_t &length, size_t &records, uint32_t &endOffset,
+                   bool single);
+};
+
+#endif
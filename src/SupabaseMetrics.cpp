@@ -0,0 +1,100 @@
+#include "SupabaseMetrics.h"
+
+static uint8_t bucketOf(unsigned long us)
+{
+    unsigned long ms = us / 1000;
+    uint8_t bucket = 0;
+    while (ms && bucket < SUPABASE_METRICS_BUCKETS - 1)
+    {
+        ms >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+unsigned long SupabaseOpMetrics::percentileMs(uint8_t percent) const
+{
+    if (calls == 0)
+    {
+        return 0;
+    }
+    // Rank of the percentile, rounded up so p100 is the slowest call
+    unsigned long total = 0;
+    for (uint8_t i = 0; i < SUPABASE_METRICS_BUCKETS; i++)
+    {
+        total += histogram[i];
+    }
+    unsigned long rank = (total * percent + 99) / 100;
+    unsigned long seen = 0;
+    for (uint8_t i = 0; i < SUPABASE_METRICS_BUCKETS - 1; i++)
+    {
+        seen += histogram[i];
+        if (seen >= rank && seen > 0)
+        {
+            return 1UL << i;
+        }
+    }
+    return maxUs / 1000;
+}
+
+const char *SupabaseMetrics::name(SupabaseOp which)
+{
+    static const char *const names[SUPABASE_OP_COUNT] = {"select", "insert", "update", "rpc", "login", "realtime"};
+    return which < SUPABASE_OP_COUNT ? names[which] : "";
+}
+
+void SupabaseMetrics::reset()
+{
+    memset(op, 0, sizeof(op));
+    since = millis();
+}
+
+void SupabaseMetrics::record(SupabaseOp which, int httpCode, unsigned long us, const SupabaseRequestTiming &timing,
+                             unsigned long sent, unsigned long received)
+{
+    SupabaseOpMetrics &m = op[which];
+    m.calls++;
+    if (httpCode <= 0)
+    {
+        m.networkErrors++;
+    }
+    else if (httpCode >= 400)
+    {
+        m.httpErrors++;
+    }
+    m.retries += timing.retries;
+    m.bytesSent += sent;
+    m.bytesReceived += received;
+    m.totalUs += us;
+    m.dnsUs += timing.dnsUs;
+    m.connectUs += timing.connectUs;
+    m.requestUs += timing.requestUs;
+    m.responseUs += timing.responseUs;
+    if (us > m.maxUs)
+    {
+        m.maxUs = us;
+    }
+    m.heapLast = timing.heapLow;
+    if (m.heapLow == 0 || timing.heapLow < m.heapLow)
+    {
+        m.heapLow = timing.heapLow;
+    }
+    m.histogram[bucketOf(us)]++;
+}
+
+void SupabaseMetrics::recordRealtime(bool answered, unsigned long us)
+{
+    SupabaseOpMetrics &m = op[SUPABASE_OP_REALTIME];
+    if (!answered)
+    {
+        m.networkErrors++;
+        return;
+    }
+    m.calls++;
+    m.totalUs += us;
+    if (us > m.maxUs)
+    {
+        m.maxUs = us;
+    }
+    m.histogram[bucketOf(us)]++;
+}
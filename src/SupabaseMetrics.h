@@ -0,0 +1,77 @@
+#ifndef SupabaseMetrics_h
+#define SupabaseMetrics_h
+
+#include "SupabaseTransport.h"
+
+/** Operations counted apart by `SupabaseMetrics` */
+enum SupabaseOp : uint8_t
+{
+    SUPABASE_OP_SELECT,
+    SUPABASE_OP_INSERT,
+    SUPABASE_OP_UPDATE,
+    SUPABASE_OP_RPC,
+    /** Password logins and token refreshes */
+    SUPABASE_OP_LOGIN,
+    /** Realtime heartbeat round trips and frames */
+    SUPABASE_OP_REALTIME,
+    SUPABASE_OP_COUNT
+};
+
+/** Latency histogram buckets: bucket 0 counts calls under 1 ms, bucket `i`
+ * calls of [2^(i-1), 2^i) ms, the last one everything slower */
+#ifndef SUPABASE_METRICS_BUCKETS
+#define SUPABASE_METRICS_BUCKETS 14
+#endif
+
+/** Counters of one operation since the last reset. Time sums are in
+ * microseconds: divide by `calls` for the mean */
+struct SupabaseOpMetrics
+{
+    unsigned long calls;
+    /** Calls that got no HTTP response (DNS, connect, TLS, timeout), or
+     * heartbeats not answered */
+    unsigned long networkErrors;
+    /** Calls answered with a status of 400 or above */
+    unsigned long httpErrors;
+    /** Requests sent again within a call */
+    unsigned long retries;
+    unsigned long bytesSent;
+    unsigned long bytesReceived;
+    uint64_t totalUs;
+    uint64_t dnsUs;
+    uint64_t connectUs;
+    uint64_t requestUs;
+    uint64_t responseUs;
+    unsigned long maxUs;
+    /** Free heap of the last call at its lowest sampled point, and the
+     * lowest of all calls (0 before the first call) */
+    uint32_t heapLast;
+    uint32_t heapLow;
+    unsigned long histogram[SUPABASE_METRICS_BUCKETS];
+
+    /** Upper bound (ms) of the bucket holding the `percent` percentile */
+    unsigned long percentileMs(uint8_t percent) const;
+};
+
+/** Per-operation counters and latency histograms of a `Supabase` client,
+ * read with `Supabase::getMetrics()` */
+struct SupabaseMetrics
+{
+    SupabaseOpMetrics op[SUPABASE_OP_COUNT];
+    /** `millis()` of the last reset */
+    unsigned long since;
+
+    const SupabaseOpMetrics &operator[](SupabaseOp which) const { return op[which]; }
+
+    /** Name of `which` as used in telemetry ("select", "insert", ...) */
+    static const char *name(SupabaseOp which);
+
+    void reset();
+    /** Add one REST call that took `us` with the phases of `timing` */
+    void record(SupabaseOp which, int httpCode, unsigned long us, const SupabaseRequestTiming &timing,
+                unsigned long sent, unsigned long received);
+    /** Add one realtime round trip (`answered`) or a missed one */
+    void recordRealtime(bool answered, unsigned long us);
+};
+
+#endif
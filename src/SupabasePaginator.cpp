@@ -0,0 +1,128 @@
+#include "SupabasePaginator.h"
+
+SupabasePaginator::SupabasePaginator(Supabase &db, const char *table, const char *key, unsigned int pageSize,
+                                     size_t queryBytes)
+    : db(db), table(table), key(key), columns("*"), pageSize(pageSize ? pageSize : 1), desc(false),
+      queryBuffer((char *)malloc(queryBytes)), query(queryBuffer, queryBuffer ? queryBytes : 0)
+{
+    callback = nullptr;
+    callbackCtx = nullptr;
+    rewind();
+}
+
+SupabasePaginator::~SupabasePaginator()
+{
+    free(queryBuffer);
+}
+
+SupabasePaginator &SupabasePaginator::select(const char *columns_a)
+{
+    columns = columns_a;
+    return *this;
+}
+
+SupabasePaginator &SupabasePaginator::where(const char *filters_a)
+{
+    filters = filters_a;
+    return *this;
+}
+
+SupabasePaginator &SupabasePaginator::descending(bool descending_a)
+{
+    desc = descending_a;
+    return *this;
+}
+
+SupabasePaginator &SupabasePaginator::startAfter(const char *key_a)
+{
+    last = key_a;
+    finished = false;
+    return *this;
+}
+
+void SupabasePaginator::rewind()
+{
+    last = String();
+    finished = false;
+    stopped = false;
+    pageRows = 0;
+    rowCount = 0;
+    pageCount = 0;
+}
+
+bool SupabasePaginator::onRow(JsonObjectConst row, void *ctx)
+{
+    SupabasePaginator *self = (SupabasePaginator *)ctx;
+    JsonVariantConst value = row[self->key.c_str()];
+    if (value.is<const char *>())
+    {
+        self->last = value.as<const char *>();
+    }
+    else if (!value.isNull())
+    {
+        char number[24];
+        serializeJson(value, number, sizeof(number));
+        self->last = number;
+    }
+    self->pageRows++;
+    self->rowCount++;
+    if (!self->callback(row, self->callbackCtx))
+    {
+        self->stopped = true;
+        return false;
+    }
+    return true;
+}
+
+int SupabasePaginator::next(SupabaseRowCallback callback_a, void *ctx, const JsonDocument *filter)
+{
+    if (finished)
+    {
+        return 0;
+    }
+    query.reset().from(table.c_str()).select(columns.c_str()).where(filters.c_str());
+    // Percent-encoded by the query: timestamps carry '+' and text keys
+    // anything
+    if (last.length())
+    {
+        if (desc)
+        {
+            query.lt(key.c_str(), last.c_str());
+        }
+        else
+        {
+            query.gt(key.c_str(), last.c_str());
+        }
+    }
+    query.order(key.c_str(), desc ? "desc" : "asc").limit(pageSize);
+
+    callback = callback_a;
+    callbackCtx = ctx;
+    pageRows = 0;
+    stopped = false;
+    int httpCode = db.doSelectStream(query, onRow, this, filter);
+    if (httpCode >= 200 && httpCode < 300)
+    {
+        pageCount++;
+        // A short page is the last one
+        if (!stopped && pageRows < pageSize)
+        {
+            finished = true;
+        }
+    }
+    return httpCode;
+}
+
+int SupabasePaginator::run(SupabaseRowCallback callback_a, void *ctx, const JsonDocument *filter)
+{
+    int httpCode = 0;
+    while (!finished)
+    {
+        httpCode = next(callback_a, ctx, filter);
+        if (httpCode < 200 || httpCode >= 300 || stopped)
+        {
+            break;
+        }
+    }
+    return httpCode;
+}
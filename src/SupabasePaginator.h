@@ -0,0 +1,83 @@
+#ifndef SupabasePaginator_h
+#define SupabasePaginator_h
+
+#include "ESP32_Supabase.h"
+
+/** Walks a table page by page with keyset pagination.
+ *
+ * Every page is `key=gt.<last key>&order=key.asc&limit=<pageSize>`, so the
+ * server seeks straight to the next page through the key's index instead
+ * of skipping `offset` rows again for every page. Rows are streamed to the
+ * callback one at a time (`doSelectStream()`): memory use depends neither
+ * on the page size nor on the table size. The page size only trades the
+ * number of requests against how long one request runs.
+ *
+ * `key` must be unique and not null (the primary key, or a unique
+ * timestamp), and part of the selected columns and of the `filter` if one
+ * is given. The last key handed to the callback is kept, so after an error
+ * `run()` continues right after it: no row is skipped or delivered twice.
+ * Save `lastKey()` and pass it to `startAfter()` to resume after a reset.
+ *
+ *     SupabasePaginator pages(db, "readings", "id", 200);
+ *     pages.select("id,ts,value").where("device=eq.7");
+ *     int code = pages.run(onRow);
+ */
+class SupabasePaginator
+{
+public:
+    SupabasePaginator(Supabase &db, const char *table, const char *key, unsigned int pageSize = 100,
+                      size_t queryBytes = 256);
+    ~SupabasePaginator();
+
+    /** Columns to fetch (default `*`) */
+    SupabasePaginator &select(const char *columns);
+    /** Extra filters in PostgREST syntax, e.g. `"device=eq.7&value=gt.20"` */
+    SupabasePaginator &where(const char *filters);
+    /** Walk from the largest key down */
+    SupabasePaginator &descending(bool descending = true);
+    /** Continue after `key` instead of from the start */
+    SupabasePaginator &startAfter(const char *key);
+    /** Start over from the first row */
+    void rewind();
+
+    /** Fetch the next page. Returns the HTTP code, `SUPABASE_ERR_OVERFLOW`
+     * if the query does not fit `queryBytes`, or 0 once `done()` */
+    int next(SupabaseRowCallback callback, void *ctx = nullptr, const JsonDocument *filter = nullptr);
+    /** Fetch pages until the table is exhausted, an error occurs or the
+     * callback returns `false` (that row counts as delivered) */
+    int run(SupabaseRowCallback callback, void *ctx = nullptr, const JsonDocument *filter = nullptr);
+
+    /** `true` once a page came back short */
+    bool done() const { return finished; }
+    /** Key of the last row delivered, empty before the first one */
+    const char *lastKey() const { return last.c_str(); }
+    /** Rows delivered and pages fetched since the start or `rewind()` */
+    unsigned long rows() const { return rowCount; }
+    unsigned long pages() const { return pageCount; }
+
+private:
+    Supabase &db;
+    String table;
+    String key;
+    String columns;
+    String filters;
+    unsigned int pageSize;
+    bool desc;
+
+    char *queryBuffer;
+    SupabaseQuery query;
+    String last;
+
+    bool finished;
+    bool stopped;
+    unsigned int pageRows;
+    unsigned long rowCount;
+    unsigned long pageCount;
+
+    SupabaseRowCallback callback;
+    void *callbackCtx;
+
+    static bool onRow(JsonObjectConst row, void *ctx);
+};
+
+#endif
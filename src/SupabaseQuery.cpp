@@ -0,0 +1,336 @@
+#include "SupabaseQuery.h"
+
+static_assert(SUPABASE_PREPARED_PARAMS <= 8, "one bit of `tooLong` per placeholder");
+static_assert(SUPABASE_PARAM_BYTES <= 255, "bound value lengths are kept in a byte");
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+void supabaseEncode(String &out, const char *value)
+{
+    for (const char *p = value; *p; p++)
+    {
+        if (supabaseKeepRaw(*p))
+        {
+            out += *p;
+        }
+        else
+        {
+            out += '%';
+            out += hexDigits[(uint8_t)*p >> 4];
+            out += hexDigits[(uint8_t)*p & 15];
+        }
+    }
+}
+
+/** Character `i` of `s`, from flash or RAM */
+static char textAt(SupabaseText s, size_t i)
+{
+    return s.flash ? (char)pgm_read_byte(s.str + i) : s.str[i];
+}
+
+SupabaseQuery::SupabaseQuery(char *buffer, size_t capacity)
+{
+    buf = buffer;
+    cap = capacity;
+    reset();
+}
+
+SupabaseQuery &SupabaseQuery::reset()
+{
+    len = 0;
+    overflow = (buf == nullptr || cap == 0);
+    if (!overflow)
+    {
+        buf[0] = '\0';
+    }
+    return *this;
+}
+
+bool SupabaseQuery::append(const char *s, size_t n)
+{
+    // Keep room for the terminating '\0'
+    if (overflow || len + n >= cap)
+    {
+        return false;
+    }
+    memcpy(buf + len, s, n);
+    len += n;
+    buf[len] = '\0';
+    return true;
+}
+
+bool SupabaseQuery::append(SupabaseText s)
+{
+    if (s.str == nullptr)
+    {
+        return true;
+    }
+    if (!s.flash)
+    {
+        return append(s.str, strlen(s.str));
+    }
+    size_t n = strlen_P(s.str);
+    if (overflow || len + n >= cap)
+    {
+        return false;
+    }
+    memcpy_P(buf + len, s.str, n);
+    len += n;
+    buf[len] = '\0';
+    return true;
+}
+
+bool SupabaseQuery::appendNumber(long value)
+{
+    // `LONG_MIN` of a 64-bit `long` (host build): 19 digits and the sign
+    char digits[21];
+    char *p = digits + sizeof(digits);
+    unsigned long v = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+    do
+    {
+        *--p = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    if (value < 0)
+    {
+        *--p = '-';
+    }
+    return append(p, digits + sizeof(digits) - p);
+}
+
+bool SupabaseQuery::appendValue(SupabaseText s)
+{
+    if (s.str == nullptr)
+    {
+        return true;
+    }
+    // The placeholder stays raw; any other control character is encoded,
+    // so a value can never be taken for one
+    if (textAt(s, 0) == SUPABASE_PARAM[0] && textAt(s, 1) == '\0')
+    {
+        return append(SUPABASE_PARAM, 1);
+    }
+    char c;
+    for (size_t i = 0; (c = textAt(s, i)) != '\0'; i++)
+    {
+        char escaped[3] = {'%', hexDigits[(uint8_t)c >> 4], hexDigits[(uint8_t)c & 15]};
+        if (supabaseKeepRaw(c) ? !append(&c, 1) : !append(escaped, 3))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SupabaseQuery::separator()
+{
+    if (len == 0 || buf[len - 1] == '?')
+    {
+        return true;
+    }
+    return append("&", 1);
+}
+
+SupabaseQuery &SupabaseQuery::fail(size_t mark)
+{
+    len = mark;
+    if (buf && cap)
+    {
+        buf[len] = '\0';
+    }
+    overflow = true;
+    return *this;
+}
+
+SupabaseQuery &SupabaseQuery::from(SupabaseText table)
+{
+    size_t mark = len;
+    if (!append(table) || !append("?", 1))
+    {
+        return fail(mark);
+    }
+    return *this;
+}
+
+SupabaseQuery &SupabaseQuery::select(SupabaseText columns)
+{
+    size_t mark = len;
+    if (!separator() || !append("select=", 7) || !append(columns))
+    {
+        return fail(mark);
+    }
+    return *this;
+}
+
+SupabaseQuery &SupabaseQuery::filter(SupabaseText column, const char *op, SupabaseText value, const char *close)
+{
+    size_t mark = len;
+    if (!separator() || !append(column) || !append("=", 1) || !append(op, strlen(op)) ||
+        !appendValue(value) || (close && !append(close, strlen(close))))
+    {
+        return fail(mark);
+    }
+    return *this;
+}
+
+SupabaseQuery &SupabaseQuery::filter(SupabaseText column, const char *op, long value)
+{
+    size_t mark = len;
+    if (!separator() || !append(column) || !append("=", 1) || !append(op, strlen(op)) ||
+        !appendNumber(value))
+    {
+        return fail(mark);
+    }
+    return *this;
+}
+
+SupabaseQuery &SupabaseQuery::where(SupabaseText params)
+{
+    if (params.str == nullptr || (params.flash ? strlen_P(params.str) : strlen(params.str)) == 0)
+    {
+        return *this;
+    }
+    size_t mark = len;
+    if (!separator() || !append(params))
+    {
+        return fail(mark);
+    }
+    return *this;
+}
+
+SupabaseQuery &SupabaseQuery::order(SupabaseText column, SupabaseText by, bool nulls)
+{
+    size_t mark = len;
+    const char *position = nulls ? ".nullslast" : ".nullsfirst";
+    if (!separator() || !append("order=", 6) || !append(column) || !append(".", 1) ||
+        !append(by) || !append(position, strlen(position)))
+    {
+        return fail(mark);
+    }
+    return *this;
+}
+
+SupabaseQuery &SupabaseQuery::limit(unsigned int by)
+{
+    size_t mark = len;
+    if (!separator() || !append("limit=", 6) || !appendNumber((long)by))
+    {
+        return fail(mark);
+    }
+    return *this;
+}
+
+SupabaseQuery &SupabaseQuery::offset(int by)
+{
+    size_t mark = len;
+    if (!separator() || !append("offset=", 7) || !appendNumber(by))
+    {
+        return fail(mark);
+    }
+    return *this;
+}
+
+SupabasePrepared::SupabasePrepared()
+{
+    compile("", 0);
+}
+
+SupabasePrepared::SupabasePrepared(const SupabaseQuery &query)
+{
+    compile(query.c_str(), query.length());
+    failed = failed || query.overflowed();
+}
+
+SupabasePrepared::SupabasePrepared(const char *query, size_t length)
+{
+    compile(query, length);
+}
+
+void SupabasePrepared::compile(const char *query, size_t length)
+{
+    count = 0;
+    failed = false;
+    tooLong = 0;
+    prefixLength = 0;
+    pattern = "";
+    pattern.reserve(length);
+    for (size_t i = 0; i < length; i++)
+    {
+        if (query[i] != SUPABASE_PARAM[0])
+        {
+            pattern += query[i];
+        }
+        else if (count < SUPABASE_PREPARED_PARAMS)
+        {
+            at[count] = pattern.length();
+            lengths[count] = 0;
+            count++;
+        }
+        else
+        {
+            failed = true;
+        }
+    }
+}
+
+SupabasePrepared &SupabasePrepared::bind(uint8_t index, SupabaseText value)
+{
+    if (index >= count)
+    {
+        return *this;
+    }
+    char *out = values[index];
+    size_t n = 0;
+    tooLong &= ~(1 << index);
+    char c;
+    for (size_t i = 0; value.str && (c = textAt(value, i)) != '\0'; i++)
+    {
+        if (n + 3 > SUPABASE_PARAM_BYTES)
+        {
+            tooLong |= 1 << index;
+            break;
+        }
+        if (supabaseKeepRaw(c))
+        {
+            out[n++] = c;
+        }
+        else
+        {
+            out[n++] = '%';
+            out[n++] = hexDigits[(uint8_t)c >> 4];
+            out[n++] = hexDigits[(uint8_t)c & 15];
+        }
+    }
+    lengths[index] = n;
+    return *this;
+}
+
+SupabasePrepared &SupabasePrepared::bind(uint8_t index, long value)
+{
+    // Room for a 64-bit `long` (host build)
+    char digits[21];
+    snprintf(digits, sizeof(digits), "%ld", value);
+    return bind(index, digits);
+}
+
+const String &SupabasePrepared::url(const String &prefix)
+{
+    if (prefixLength != prefix.length() || memcmp(built.c_str(), prefix.c_str(), prefixLength) != 0)
+    {
+        // Large enough for any values: later calls do not reallocate
+        built = "";
+        built.reserve(prefix.length() + pattern.length() + count * SUPABASE_PARAM_BYTES);
+        built += prefix;
+        prefixLength = prefix.length();
+    }
+    built.remove(prefixLength);
+    size_t from = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        built.concat(pattern.c_str() + from, at[i] - from);
+        built.concat(values[i], lengths[i]);
+        from = at[i];
+    }
+    built.concat(pattern.c_str() + from, pattern.length() - from);
+    return built;
+}
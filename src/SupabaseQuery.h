@@ -0,0 +1,199 @@
+#ifndef SupabaseQuery_h
+#define SupabaseQuery_h
+
+#include <Arduino.h>
+
+/** Filter value bound later, see `SupabasePrepared` */
+#define SUPABASE_PARAM "\x01"
+
+/** Placeholders a `SupabasePrepared` query can hold */
+#ifndef SUPABASE_PREPARED_PARAMS
+#define SUPABASE_PREPARED_PARAMS 4
+#endif
+
+/** Room for one bound value, percent-encoded */
+#ifndef SUPABASE_PARAM_BYTES
+#define SUPABASE_PARAM_BYTES 48
+#endif
+
+/** `true` if `c` goes into a filter value as it is: unreserved URL
+ * characters and the PostgREST syntax of lists and ranges */
+inline bool supabaseKeepRaw(char c)
+{
+    return isalnum((unsigned char)c) || c == '-' || c == '.' || c == '_' || c == '~' || c == ',' || c == '(' ||
+           c == ')' || c == '*' || c == ':';
+}
+
+/** Append `value` to `out`, percent-encoded so `&`, `+`, `#`, `%`,
+ * spaces and non-ASCII text reach PostgREST unchanged */
+void supabaseEncode(String &out, const char *value);
+
+/** A query argument: plain `const char*` or a flash string from `F("...")` */
+struct SupabaseText
+{
+    SupabaseText(const char *s) : str(s), flash(false) {}
+    SupabaseText(const __FlashStringHelper *s) : str((const char *)s), flash(true) {}
+
+    const char *str;
+    bool flash;
+};
+
+/** Query builder writing into a fixed, caller-provided buffer.
+ *
+ * Same operators as the `Supabase` builder (`from`, `select`, `eq`, ...,
+ * `order`, `limit`, `offset`) and the same PostgREST syntax, but nothing is
+ * allocated: arguments are copied straight into the buffer, filter values
+ * percent-encoded. `SUPABASE_PARAM` as a value leaves a placeholder for
+ * `SupabasePrepared`. When a part
+ * does not fit, the query is marked `overflowed()` and stays truncated at
+ * the last complete part; the client refuses to send an overflowed query.
+ *
+ *     char buf[128];
+ *     SupabaseQuery q(buf, sizeof(buf));
+ *     q.from("sensors").select("*").eq("id", "42").limit(1);
+ *     String rows = db.doSelect(q);
+ */
+class SupabaseQuery
+{
+public:
+    SupabaseQuery(char *buffer, size_t capacity);
+
+    /** Empty the query (keeps the buffer) */
+    SupabaseQuery &reset();
+
+    SupabaseQuery &from(SupabaseText table);
+    SupabaseQuery &update(SupabaseText table) { return from(table); }
+    SupabaseQuery &select(SupabaseText columns);
+
+    // Comparison Operator
+    SupabaseQuery &eq(SupabaseText column, SupabaseText value) { return filter(column, "eq.", value, nullptr); }
+    SupabaseQuery &gt(SupabaseText column, SupabaseText value) { return filter(column, "gt.", value, nullptr); }
+    SupabaseQuery &gte(SupabaseText column, SupabaseText value) { return filter(column, "gte.", value, nullptr); }
+    SupabaseQuery &lt(SupabaseText column, SupabaseText value) { return filter(column, "lt.", value, nullptr); }
+    SupabaseQuery &lte(SupabaseText column, SupabaseText value) { return filter(column, "lte.", value, nullptr); }
+    SupabaseQuery &neq(SupabaseText column, SupabaseText value) { return filter(column, "neq.", value, nullptr); }
+    SupabaseQuery &in(SupabaseText column, SupabaseText value) { return filter(column, "in.(", value, ")"); }
+    SupabaseQuery &is(SupabaseText column, SupabaseText value) { return filter(column, "is.", value, nullptr); }
+    SupabaseQuery &cs(SupabaseText column, SupabaseText value) { return filter(column, "cs.{", value, "}"); }
+    SupabaseQuery &cd(SupabaseText column, SupabaseText value) { return filter(column, "cd.{", value, "}"); }
+    SupabaseQuery &ov(SupabaseText column, SupabaseText value) { return filter(column, "ov.{", value, "}"); }
+    SupabaseQuery &sl(SupabaseText column, SupabaseText value) { return filter(column, "sl.(", value, ")"); }
+    SupabaseQuery &sr(SupabaseText column, SupabaseText value) { return filter(column, "sr.(", value, ")"); }
+    SupabaseQuery &nxr(SupabaseText column, SupabaseText value) { return filter(column, "nxr.(", value, ")"); }
+    SupabaseQuery &nxl(SupabaseText column, SupabaseText value) { return filter(column, "nxl.(", value, ")"); }
+    SupabaseQuery &adj(SupabaseText column, SupabaseText value) { return filter(column, "adj.(", value, ")"); }
+
+    /** Integer operand without formatting it into a string first */
+    SupabaseQuery &eq(SupabaseText column, long value) { return filter(column, "eq.", value); }
+    SupabaseQuery &gt(SupabaseText column, long value) { return filter(column, "gt.", value); }
+    SupabaseQuery &gte(SupabaseText column, long value) { return filter(column, "gte.", value); }
+    SupabaseQuery &lt(SupabaseText column, long value) { return filter(column, "lt.", value); }
+    SupabaseQuery &lte(SupabaseText column, long value) { return filter(column, "lte.", value); }
+    SupabaseQuery &neq(SupabaseText column, long value) { return filter(column, "neq.", value); }
+
+    /** Parameters already in PostgREST syntax, `&`-separated, appended as
+     * they are (e.g. `"device=eq.7&value=gt.20"`). Empty adds nothing */
+    SupabaseQuery &where(SupabaseText params);
+
+    // Ordering
+    SupabaseQuery &order(SupabaseText column, SupabaseText by, bool nulls = true);
+    SupabaseQuery &limit(unsigned int by);
+    SupabaseQuery &offset(int by);
+
+    /** `table?query` part of the URL (after `/rest/v1/`) */
+    const char *c_str() const { return buf; }
+    size_t length() const { return len; }
+    size_t capacity() const { return cap; }
+    /** `true` if some part did not fit into the buffer */
+    bool overflowed() const { return overflow; }
+
+protected:
+    char *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+
+    /** Start a new `&`-separated parameter, or nothing right after `?` */
+    bool separator();
+    bool append(const char *s, size_t n);
+    bool append(SupabaseText s);
+    bool appendNumber(long value);
+    /** A filter value: percent-encoded, or the `SUPABASE_PARAM` marker */
+    bool appendValue(SupabaseText s);
+    /** Roll back to `mark` and flag the overflow */
+    SupabaseQuery &fail(size_t mark);
+
+    SupabaseQuery &filter(SupabaseText column, const char *op, SupabaseText value, const char *close);
+    SupabaseQuery &filter(SupabaseText column, const char *op, long value);
+};
+
+/** `SupabaseQuery` with its own buffer of `N` bytes (e.g. on the stack) */
+template <size_t N>
+class SupabaseQueryBuffer : public SupabaseQuery
+{
+public:
+    SupabaseQueryBuffer() : SupabaseQuery(storage, N) {}
+
+private:
+    char storage[N];
+};
+
+/** A query compiled once, its `SUPABASE_PARAM` placeholders bound per call.
+ *
+ * Preparing splits the query at the placeholders. A call then only
+ * percent-encodes the bound values into their slots and copies the pieces
+ * behind the URL prefix, into a URL string that keeps its allocation from
+ * call to call.
+ *
+ *     SupabaseQueryBuffer<128> q;
+ *     q.from("readings").select("id,value").eq("device", SUPABASE_PARAM).gt("id", SUPABASE_PARAM);
+ *     SupabasePrepared after(q);
+ *
+ *     after.bind(0, "sensor-1").bind(1, lastId);
+ *     db.doSelectStream(after, onRow);
+ */
+class SupabasePrepared
+{
+public:
+    SupabasePrepared();
+    explicit SupabasePrepared(const SupabaseQuery &query);
+    /** From a query string, e.g. `Supabase::getQuery()` */
+    SupabasePrepared(const char *query, size_t length);
+
+    /** Number of placeholders */
+    uint8_t params() const { return count; }
+    /** Bind placeholder `index` (0 for the first one) to `value` */
+    SupabasePrepared &bind(uint8_t index, SupabaseText value);
+    SupabasePrepared &bind(uint8_t index, long value);
+
+    /** `true` if the query overflowed or had more than
+     * `SUPABASE_PREPARED_PARAMS` placeholders, or a bound value did not fit
+     * `SUPABASE_PARAM_BYTES`: such a query is not sent */
+    bool overflowed() const { return failed || tooLong; }
+
+    /** `prefix` followed by the query with the values bound now. Only the
+     * query part is rebuilt while `prefix` stays the same */
+    const String &url(const String &prefix);
+    /** The query part of the last `url()` (`table?query`) */
+    const char *path() const { return built.c_str() + prefixLength; }
+    size_t pathLength() const { return built.length() - prefixLength; }
+
+private:
+    /** The query without its placeholders */
+    String pattern;
+    /** Where in `pattern` each value goes */
+    uint16_t at[SUPABASE_PREPARED_PARAMS];
+    char values[SUPABASE_PREPARED_PARAMS][SUPABASE_PARAM_BYTES];
+    uint8_t lengths[SUPABASE_PREPARED_PARAMS];
+    uint8_t count;
+    bool failed;
+    /** Bit per slot whose value did not fit */
+    uint8_t tooLong;
+
+    String built;
+    size_t prefixLength;
+
+    void compile(const char *query, size_t length);
+};
+
+#endif
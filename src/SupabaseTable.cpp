@@ -0,0 +1,340 @@
+#include "SupabaseTable.h"
+
+/** Appends to a fixed buffer, remembers when something did not fit */
+struct RowWriter
+{
+    char *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+
+    void append(const char *s, size_t n)
+    {
+        if (overflow || len + n >= cap)
+        {
+            overflow = true;
+            return;
+        }
+        memcpy(buf + len, s, n);
+        len += n;
+    }
+    void append(const char *s) { append(s, strlen(s)); }
+    void append(char c) { append(&c, 1); }
+
+    void appendUnsigned(unsigned long long value)
+    {
+        char digits[21];
+        size_t n = sizeof(digits);
+        do
+        {
+            digits[--n] = '0' + value % 10;
+            value /= 10;
+        } while (value);
+        append(digits + n, sizeof(digits) - n);
+    }
+
+    /** `s` as a JSON string, `max` characters at most */
+    void appendQuoted(const char *s, size_t max = (size_t)-1)
+    {
+        static const char hex[] = "0123456789abcdef";
+        append('"');
+        for (size_t i = 0; i < max && s[i]; i++)
+        {
+            unsigned char c = s[i];
+            if (c == '"' || c == '\\')
+            {
+                append('\\');
+                append((char)c);
+            }
+            else if (c < 0x20)
+            {
+                char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+                append(escaped, sizeof(escaped));
+            }
+            else
+            {
+                append((char)c);
+            }
+        }
+        append('"');
+    }
+};
+
+/** `true` if `name` is one of the comma-separated `list` */
+static bool listed(const char *list, const char *name)
+{
+    size_t length = strlen(name);
+    for (const char *p = list; *p;)
+    {
+        const char *end = strchr(p, ',');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        if (n == length && strncmp(p, name, n) == 0)
+        {
+            return true;
+        }
+        p += end ? n + 1 : n;
+    }
+    return false;
+}
+
+SupabaseSchema::SupabaseSchema(Supabase &db, const char *table, const SupabaseColumn *columns, size_t count)
+    : db(db), name(table), cols(columns), count(count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i)
+        {
+            columnList += ',';
+        }
+        columnList += cols[i].name;
+        filter[cols[i].name] = true;
+    }
+}
+
+size_t SupabaseSchema::toJson(const void *row, char *buffer, size_t size, const char *only) const
+{
+    RowWriter out = {buffer, size, 0, false};
+    const uint8_t *base = (const uint8_t *)row;
+    out.append('{');
+    bool first = true;
+    for (size_t i = 0; i < count; i++)
+    {
+        const SupabaseColumn &col = cols[i];
+        if (only ? !listed(only, col.name) : col.readOnly)
+        {
+            continue;
+        }
+        if (!first)
+        {
+            out.append(',');
+        }
+        first = false;
+        out.appendQuoted(col.name);
+        out.append(':');
+
+        const uint8_t *field = base + col.offset;
+        switch (col.type)
+        {
+        case SUPABASE_COLUMN_BOOL:
+            out.append(*(const bool *)field ? "true" : "false");
+            break;
+        case SUPABASE_COLUMN_INT:
+        {
+            long long value = col.size == 1   ? *(const int8_t *)field
+                              : col.size == 2 ? *(const int16_t *)field
+                              : col.size == 4 ? *(const int32_t *)field
+                                              : *(const int64_t *)field;
+            if (value < 0)
+            {
+                out.append('-');
+            }
+            out.appendUnsigned(value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value);
+            break;
+        }
+        case SUPABASE_COLUMN_UINT:
+            out.appendUnsigned(col.size == 1   ? *(const uint8_t *)field
+                               : col.size == 2 ? *(const uint16_t *)field
+                               : col.size == 4 ? *(const uint32_t *)field
+                                               : *(const uint64_t *)field);
+            break;
+        case SUPABASE_COLUMN_FLOAT:
+        {
+            double value = col.size == sizeof(float) ? *(const float *)field : *(const double *)field;
+            // JSON has no NaN or infinity
+            if (isnan(value) || isinf(value))
+            {
+                out.append("null");
+                break;
+            }
+            char number[32];
+            int n = snprintf(number, sizeof(number), col.size == sizeof(float) ? "%.7g" : "%.15g", value);
+            out.append(number, n);
+            break;
+        }
+        case SUPABASE_COLUMN_TEXT:
+            // A full array may lack the terminator
+            out.appendQuoted((const char *)field, col.size);
+            break;
+        case SUPABASE_COLUMN_STRING:
+            out.appendQuoted(((const String *)field)->c_str());
+            break;
+        }
+    }
+    out.append('}');
+    if (out.overflow)
+    {
+        return 0;
+    }
+    buffer[out.len] = '\0';
+    return out.len;
+}
+
+void SupabaseSchema::fromJson(JsonObjectConst object, void *row) const
+{
+    uint8_t *base = (uint8_t *)row;
+    for (size_t i = 0; i < count; i++)
+    {
+        const SupabaseColumn &col = cols[i];
+        JsonVariantConst value = object[col.name];
+        if (value.isUnbound())
+        {
+            continue;
+        }
+        uint8_t *field = base + col.offset;
+        switch (col.type)
+        {
+        case SUPABASE_COLUMN_BOOL:
+            *(bool *)field = value.as<bool>();
+            break;
+        case SUPABASE_COLUMN_INT:
+        {
+            long long v = value.as<long long>();
+            if (col.size == 1)
+                *(int8_t *)field = v;
+            else if (col.size == 2)
+                *(int16_t *)field = v;
+            else if (col.size == 4)
+                *(int32_t *)field = v;
+            else
+                *(int64_t *)field = v;
+            break;
+        }
+        case SUPABASE_COLUMN_UINT:
+        {
+            unsigned long long v = value.as<unsigned long long>();
+            if (col.size == 1)
+                *(uint8_t *)field = v;
+            else if (col.size == 2)
+                *(uint16_t *)field = v;
+            else if (col.size == 4)
+                *(uint32_t *)field = v;
+            else
+                *(uint64_t *)field = v;
+            break;
+        }
+        case SUPABASE_COLUMN_FLOAT:
+            if (col.size == sizeof(float))
+                *(float *)field = value.as<float>();
+            else
+                *(double *)field = value.as<double>();
+            break;
+        case SUPABASE_COLUMN_TEXT:
+            // Numbers and the like land in a text member as their JSON
+            if (value.is<const char *>())
+            {
+                snprintf((char *)field, col.size, "%s", value.as<const char *>());
+            }
+            else if (value.isNull())
+            {
+                *(char *)field = '\0';
+            }
+            else
+            {
+                size_t n = serializeJson(value, (char *)field, col.size);
+                ((char *)field)[n < col.size ? n : col.size - 1] = '\0';
+            }
+            break;
+        case SUPABASE_COLUMN_STRING:
+        {
+            String &text = *(String *)field;
+            text = "";
+            if (value.is<const char *>())
+            {
+                text = value.as<const char *>();
+            }
+            else if (!value.isNull())
+            {
+                serializeJson(value, text);
+            }
+            break;
+        }
+        }
+    }
+}
+
+int SupabaseSchema::insertRow(const void *row, bool upsert, const SupabasePrefer &prefer)
+{
+    char json[SUPABASE_ROW_BYTES];
+    size_t length = toJson(row, json, sizeof(json));
+    if (length == 0)
+    {
+        return SUPABASE_ERR_OVERFLOW;
+    }
+    return db.insert(name, json, length, upsert, prefer);
+}
+
+size_t SupabaseSchema::produceRows(uint8_t *buffer, size_t size, void *ctx)
+{
+    Upload *up = (Upload *)ctx;
+    if (up->closed || up->overflow)
+    {
+        return 0;
+    }
+    size_t n = 0;
+    if (up->next == 0)
+    {
+        buffer[n++] = '[';
+    }
+    // Whole rows only: a row that does not fit goes into the next chunk
+    while (up->next < up->count)
+    {
+        size_t comma = up->next ? 1 : 0;
+        size_t length = up->schema->toJson(up->rows + up->next * up->stride, (char *)buffer + n + comma,
+                                           size - n - comma);
+        if (length == 0)
+        {
+            // Not even an empty chunk has room for it
+            up->overflow = n == 0 || up->next == 0;
+            return up->overflow ? 0 : n;
+        }
+        if (comma)
+        {
+            buffer[n] = ',';
+        }
+        n += comma + length;
+        up->next++;
+    }
+    if (n < size)
+    {
+        buffer[n++] = ']';
+        up->closed = true;
+    }
+    return n;
+}
+
+int SupabaseSchema::insertRows(const void *rows, size_t rowCount, size_t stride, bool upsert,
+                               const SupabasePrefer &prefer)
+{
+    if (rowCount == 0)
+    {
+        return 0;
+    }
+    Upload up = {this, (const uint8_t *)rows, rowCount, stride, 0, false, false};
+    int httpCode = db.insertStream(name, produceRows, &up, SUPABASE_BODY_JSON, upsert, prefer);
+    // The body was cut short, whatever the server made of it
+    return up.overflow ? SUPABASE_ERR_OVERFLOW : httpCode;
+}
+
+int SupabaseSchema::updateRows(const char *filters, const void *row, const char *only, const SupabasePrefer &prefer)
+{
+    char json[SUPABASE_ROW_BYTES];
+    size_t length = toJson(row, json, sizeof(json), only);
+    if (length == 0)
+    {
+        return SUPABASE_ERR_OVERFLOW;
+    }
+    SupabaseQueryBuffer<SUPABASE_TABLE_QUERY_BYTES> query;
+    query.update(name.c_str()).where(filters);
+    return db.doUpdate(query, json, length, prefer);
+}
+
+int SupabaseSchema::selectRows(const char *filters, unsigned int limit, SupabaseRowCallback callback, void *ctx)
+{
+    SupabaseQueryBuffer<SUPABASE_TABLE_QUERY_BYTES> query;
+    query.from(name.c_str()).select(columnList.c_str()).where(filters);
+    if (limit)
+    {
+        query.limit(limit);
+    }
+    return db.doSelectStream(query, callback, ctx, &filter);
+}
@@ -0,0 +1,245 @@
+#ifndef SupabaseTable_h
+#define SupabaseTable_h
+
+#include "ESP32_Supabase.h"
+
+#include <stddef.h>
+#include <type_traits>
+
+/** Largest JSON object of one row written by `insert(row)` and
+ * `update()`, serialized on the stack */
+#ifndef SUPABASE_ROW_BYTES
+#define SUPABASE_ROW_BYTES 256
+#endif
+
+/** Room for `table?select=...&filters&limit=` of a typed select */
+#ifndef SUPABASE_TABLE_QUERY_BYTES
+#define SUPABASE_TABLE_QUERY_BYTES 256
+#endif
+
+/** C++ type of a struct member mapped to a column */
+enum SupabaseColumnType : uint8_t
+{
+    SUPABASE_COLUMN_BOOL,
+    /** Signed integer of `size` bytes */
+    SUPABASE_COLUMN_INT,
+    SUPABASE_COLUMN_UINT,
+    /** `float` or `double` */
+    SUPABASE_COLUMN_FLOAT,
+    /** `char[size]`, always terminated (truncated if longer) */
+    SUPABASE_COLUMN_TEXT,
+    SUPABASE_COLUMN_STRING
+};
+
+/** One column: JSON name and where the value lives in the row struct */
+struct SupabaseColumn
+{
+    const char *name;
+    SupabaseColumnType type;
+    uint16_t offset;
+    uint16_t size;
+    /** Selected but never written (identity, defaults set by the database) */
+    bool readOnly;
+};
+
+template <typename T, typename Enable = void>
+struct SupabaseColumnTraits
+{
+    static_assert(sizeof(T) == 0, "column type not supported: use bool, an integer, float, double, char[N] or String");
+};
+template <>
+struct SupabaseColumnTraits<bool>
+{
+    static constexpr SupabaseColumnType type = SUPABASE_COLUMN_BOOL;
+};
+template <typename T>
+struct SupabaseColumnTraits<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+{
+    static constexpr SupabaseColumnType type = std::is_signed<T>::value ? SUPABASE_COLUMN_INT : SUPABASE_COLUMN_UINT;
+};
+template <typename T>
+struct SupabaseColumnTraits<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static constexpr SupabaseColumnType type = SUPABASE_COLUMN_FLOAT;
+};
+template <size_t N>
+struct SupabaseColumnTraits<char[N]>
+{
+    static constexpr SupabaseColumnType type = SUPABASE_COLUMN_TEXT;
+};
+template <>
+struct SupabaseColumnTraits<String>
+{
+    static constexpr SupabaseColumnType type = SUPABASE_COLUMN_STRING;
+};
+
+/** A column of `Row`, see `SUPABASE_COLUMN` */
+template <typename Row>
+struct SupabaseRowColumn
+{
+    SupabaseColumn column;
+};
+
+template <typename Row, typename T>
+constexpr SupabaseRowColumn<Row> supabaseColumn(const char *name, T Row::*, size_t offset, bool readOnly)
+{
+    return SupabaseRowColumn<Row>{{name, SupabaseColumnTraits<T>::type, (uint16_t)offset, (uint16_t)sizeof(T), readOnly}};
+}
+
+/** Column named like the member `member` of the struct `Row`. A member
+ * that does not exist or has an unsupported type does not compile */
+#define SUPABASE_COLUMN(Row, member) supabaseColumn(#member, &Row::member, offsetof(Row, member), false)
+/** Same as above, the column called `name` in the table */
+#define SUPABASE_COLUMN_AS(Row, member, name) supabaseColumn(name, &Row::member, offsetof(Row, member), false)
+/** Column filled in by the database (e.g. an identity `id` or a
+ * `created_at` default): read by selects, left out of inserts and updates */
+#define SUPABASE_COLUMN_READ(Row, member) supabaseColumn(#member, &Row::member, offsetof(Row, member), true)
+
+/** Table columns mapped to the members of a struct, without the types.
+ * Use it through `SupabaseTable<Row>` */
+class SupabaseSchema
+{
+public:
+    const char *table() const { return name.c_str(); }
+    /** The column names, comma-separated: the `select=` of every select */
+    const char *columns() const { return columnList.c_str(); }
+
+    /** Write the columns of `row` as one JSON object. `only`: the
+     * comma-separated columns to write, `nullptr` for all but the
+     * read-only ones. Returns the
+     * length, 0 if it did not fit into `size` (terminator included) */
+    size_t toJson(const void *row, char *buffer, size_t size, const char *only = nullptr) const;
+    /** Set the columns of `row` from `object`. Missing fields are left as
+     * they are, null ones become 0 or empty */
+    void fromJson(JsonObjectConst object, void *row) const;
+
+protected:
+    SupabaseSchema(Supabase &db, const char *table, const SupabaseColumn *columns, size_t count);
+
+    Supabase &db;
+
+    int insertRow(const void *row, bool upsert, const SupabasePrefer &prefer);
+    /** One request for all rows, serialized into the upload chunks */
+    int insertRows(const void *rows, size_t count, size_t stride, bool upsert, const SupabasePrefer &prefer);
+    int updateRows(const char *filters, const void *row, const char *only, const SupabasePrefer &prefer);
+    int selectRows(const char *filters, unsigned int limit, SupabaseRowCallback callback, void *ctx);
+
+private:
+    String name;
+    const SupabaseColumn *cols;
+    size_t count;
+    String columnList;
+    /** Keeps only the mapped columns of each row while it is parsed */
+    JsonDocument filter;
+
+    struct Upload
+    {
+        const SupabaseSchema *schema;
+        const uint8_t *rows;
+        size_t count;
+        size_t stride;
+        size_t next;
+        bool closed;
+        bool overflow;
+    };
+    static size_t produceRows(uint8_t *buffer, size_t size, void *ctx);
+};
+
+/** Reads and writes rows of a table as structs.
+ *
+ * The columns are declared once, next to the struct. Rows are written
+ * straight from the struct into the request buffer, and response rows
+ * are parsed one at a time (`doSelectStream()`) straight into a struct:
+ * no `JsonDocument` or `String` holds a whole body.
+ *
+ *     struct Reading { long id; char device[16]; float value; };
+ *     static const SupabaseRowColumn<Reading> readingColumns[] = {
+ *         SUPABASE_COLUMN_READ(Reading, id),
+ *         SUPABASE_COLUMN(Reading, device),
+ *         SUPABASE_COLUMN(Reading, value),
+ *     };
+ *     SupabaseTable<Reading> readings(db, "readings", readingColumns);
+ *
+ *     Reading r = {0, "sensor-1", 21.5};
+ *     readings.insert(r);
+ *     readings.select("device=eq.sensor-1&order=id.desc", onReading);
+ */
+template <typename Row>
+class SupabaseTable : public SupabaseSchema
+{
+public:
+    typedef bool (*Callback)(const Row &row, void *ctx);
+
+    template <size_t N>
+    SupabaseTable(Supabase &db, const char *table, const SupabaseRowColumn<Row> (&columns)[N])
+        : SupabaseSchema(db, table, &columns[0].column, N)
+    {
+        static_assert(sizeof(SupabaseRowColumn<Row>) == sizeof(SupabaseColumn), "columns must be packed");
+    }
+
+    /** Insert one row. Returns `SUPABASE_ERR_OVERFLOW` if its JSON does
+     * not fit `SUPABASE_ROW_BYTES` */
+    int insert(const Row &row, bool upsert = false) { return insertRow(&row, upsert, db.getPrefer()); }
+    int insert(const Row &row, bool upsert, const SupabasePrefer &prefer) { return insertRow(&row, upsert, prefer); }
+    /** Insert `count` rows with one request, see `Supabase::insertStream()` */
+    int insert(const Row *rows, size_t count, bool upsert = false)
+    {
+        return insertRows(rows, count, sizeof(Row), upsert, db.getPrefer());
+    }
+
+    /** Set the rows matching `filters` (e.g. `"id=eq.7"`) to the columns
+     * of `row`; `only` limits it to some of them (`"value,ts"`) */
+    int update(const char *filters, const Row &row, const char *only = nullptr)
+    {
+        return updateRows(filters, &row, only, db.getPrefer());
+    }
+
+    /** Call `callback` with every row matching `filters` (PostgREST query
+     * parameters, may include `order=`), `limit` rows at most (0: all) */
+    int select(const char *filters, Callback callback, void *ctx = nullptr, unsigned int limit = 0)
+    {
+        Each each = {this, callback, ctx, Row()};
+        return selectRows(filters, limit, eachRow, &each);
+    }
+    /** Fill `rows` with up to `max` rows matching `filters`; `count` is the
+     * number filled */
+    int select(const char *filters, Row *rows, size_t max, size_t &count)
+    {
+        Fill fill = {this, rows, max, 0};
+        int httpCode = max ? selectRows(filters, max, fillRow, &fill) : 0;
+        count = fill.count;
+        return httpCode;
+    }
+
+private:
+    struct Each
+    {
+        SupabaseTable *table;
+        Callback callback;
+        void *ctx;
+        Row row;
+    };
+    struct Fill
+    {
+        SupabaseTable *table;
+        Row *rows;
+        size_t max;
+        size_t count;
+    };
+
+    static bool eachRow(JsonObjectConst object, void *ctx)
+    {
+        Each *each = (Each *)ctx;
+        each->row = Row();
+        each->table->fromJson(object, &each->row);
+        return each->callback(each->row, each->ctx);
+    }
+    static bool fillRow(JsonObjectConst object, void *ctx)
+    {
+        Fill *fill = (Fill *)ctx;
+        fill->table->fromJson(object, &fill->rows[fill->count++]);
+        return fill->count < fill->max;
+    }
+};
+
+#endif
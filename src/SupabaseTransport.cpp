@@ -0,0 +1,511 @@
+#include "SupabaseTransport.h"
+
+int SupabaseHttpTransport::sendChunked(const char *method, SupabaseBodyProducer producer, void *ctx)
+{
+    uint8_t *buffer = (uint8_t *)malloc(SUPABASE_UPLOAD_CHUNK);
+    if (buffer == nullptr)
+    {
+        return SUPABASE_ERR_BEGIN;
+    }
+    String body;
+    size_t n;
+    while ((n = producer(buffer, SUPABASE_UPLOAD_CHUNK, ctx)) > 0)
+    {
+        body.concat((const char *)buffer, n < SUPABASE_UPLOAD_CHUNK ? n : SUPABASE_UPLOAD_CHUNK);
+    }
+    free(buffer);
+    return sendRequest(method, body);
+}
+
+#if !defined(SUPABASE_HOST)
+
+static_assert(SUPABASE_UPLOAD_CHUNK <= 0xFFFF, "the chunk size is sent as 4 hex digits");
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+
+/** Swallows a response body without buffering it */
+class SupabaseNullStream : public Stream
+{
+public:
+    int available() { return 0; }
+    int read() { return -1; }
+    int peek() { return -1; }
+    void flush() {}
+    size_t write(uint8_t) { return 1; }
+    size_t write(const uint8_t *, size_t size) { return size; }
+};
+
+void SupabaseBodyStream::reset(Stream *source, long length, bool isChunked)
+{
+    src = source;
+    chunked = isChunked;
+    remaining = chunked ? 0 : length;
+    first = true;
+    done = (src == nullptr) || (!chunked && length == 0);
+    peeked = -1;
+    count = 0;
+}
+
+int SupabaseBodyStream::nextRaw()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = src->read();
+        if (c >= 0)
+        {
+            return c;
+        }
+        yield();
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+bool SupabaseBodyStream::nextChunk()
+{
+    int c;
+    if (!first)
+    {
+        // CRLF that ends the previous chunk
+        while ((c = nextRaw()) >= 0 && c != '\n')
+        {
+        }
+    }
+    first = false;
+
+    long size = 0;
+    bool inExtension = false;
+    while ((c = nextRaw()) >= 0 && c != '\n')
+    {
+        if (c == ';')
+        {
+            inExtension = true;
+        }
+        if (inExtension || c == '\r' || c == ' ')
+        {
+            continue;
+        }
+        int digit = isdigit(c) ? c - '0' : (isxdigit(c) ? (tolower(c) - 'a' + 10) : -1);
+        if (digit < 0)
+        {
+            return false;
+        }
+        size = size * 16 + digit;
+    }
+    if (c < 0 || size == 0)
+    {
+        // Last chunk: skip optional trailers up to the empty line
+        int lineLength = 0;
+        while (c >= 0 && (c = nextRaw()) >= 0)
+        {
+            if (c == '\n')
+            {
+                if (lineLength == 0)
+                {
+                    break;
+                }
+                lineLength = 0;
+            }
+            else if (c != '\r')
+            {
+                lineLength++;
+            }
+        }
+        return false;
+    }
+    remaining = size;
+    return true;
+}
+
+int SupabaseBodyStream::next()
+{
+    if (done)
+    {
+        return -1;
+    }
+    if (chunked && remaining == 0 && !nextChunk())
+    {
+        done = true;
+        return -1;
+    }
+    int c = nextRaw();
+    if (c < 0)
+    {
+        done = true;
+        return -1;
+    }
+    count++;
+    if (remaining > 0 && --remaining == 0 && !chunked)
+    {
+        done = true;
+    }
+    return c;
+}
+
+int SupabaseBodyStream::available()
+{
+    if (peeked >= 0)
+    {
+        return 1;
+    }
+    if (done)
+    {
+        return 0;
+    }
+    int n = src->available();
+    if (remaining > 0 && n > remaining)
+    {
+        n = remaining;
+    }
+    return n;
+}
+
+int SupabaseBodyStream::read()
+{
+    if (peeked >= 0)
+    {
+        int c = peeked;
+        peeked = -1;
+        return c;
+    }
+    return next();
+}
+
+int SupabaseBodyStream::peek()
+{
+    if (peeked < 0)
+    {
+        peeked = next();
+    }
+    return peeked;
+}
+
+int SupabaseHTTPClient::sendChunked(const char *method, Client &client, SupabaseBodyProducer producer, void *ctx,
+                                    uint8_t *buffer, unsigned long &sent)
+{
+    sent = 0;
+    if (!connect())
+    {
+        return returnError(HTTPC_ERROR_CONNECTION_REFUSED);
+    }
+    addHeader("Transfer-Encoding", "chunked");
+    if (!sendHeader(method))
+    {
+        return returnError(HTTPC_ERROR_SEND_HEADER_FAILED);
+    }
+
+    // One write per chunk: "xxxx\r\n" data "\r\n", the size padded to four
+    // hex digits (leading zeros are allowed), so TLS sends one record each
+    static const char hex[] = "0123456789abcdef";
+    uint8_t *data = buffer + 6;
+    size_t n;
+    while ((n = producer(data, SUPABASE_UPLOAD_CHUNK, ctx)) > 0)
+    {
+        if (n > SUPABASE_UPLOAD_CHUNK)
+        {
+            n = SUPABASE_UPLOAD_CHUNK;
+        }
+        for (int i = 0; i < 4; i++)
+        {
+            buffer[i] = hex[(n >> (12 - 4 * i)) & 0xF];
+        }
+        buffer[4] = '\r';
+        buffer[5] = '\n';
+        data[n] = '\r';
+        data[n + 1] = '\n';
+        if (client.write(buffer, n + 8) != n + 8)
+        {
+            return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+        }
+        sent += n;
+    }
+    if (client.write((const uint8_t *)"0\r\n\r\n", 5) != 5)
+    {
+        return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+    }
+    return handleHeaderResponse();
+}
+
+SupabaseArduinoHttp::SupabaseArduinoHttp()
+{
+    haveSession = false;
+    wasOpen = false;
+    bodyPending = false;
+    streamUsed = false;
+    lastUse = 0;
+    address = 0;
+    restoredAddress = 0;
+    https.setReuse(true);
+
+    static const char *responseHeaders[] = {"Transfer-Encoding", "ETag", "Content-Encoding", "Content-Range"};
+    https.collectHeaders(responseHeaders, sizeof(responseHeaders) / sizeof(responseHeaders[0]));
+#if defined(ESP8266)
+    client.setSession(&session);
+#endif
+}
+
+void SupabaseArduinoHttp::setInsecure()
+{
+    client.setInsecure();
+}
+
+void SupabaseArduinoHttp::saveState(SupabaseTransportState &state)
+{
+    memset(&state, 0, sizeof(state));
+    state.address = address;
+#if defined(ESP8266)
+    // The session parameters only: plain bytes, no pointers
+    static_assert(sizeof(session) <= SUPABASE_TLS_SESSION_BYTES, "raise SUPABASE_TLS_SESSION_BYTES");
+    if (haveSession)
+    {
+        memcpy(state.session, (const void *)&session, sizeof(session));
+        state.sessionLength = sizeof(session);
+    }
+#endif
+}
+
+void SupabaseArduinoHttp::restoreState(const SupabaseTransportState &state)
+{
+#if defined(ESP8266)
+    if (state.sessionLength == sizeof(session))
+    {
+        // The server falls back to a full handshake if it forgot it
+        memcpy((void *)&session, state.session, sizeof(session));
+        haveSession = true;
+    }
+#else
+    restoredAddress = state.address;
+#endif
+}
+
+bool SupabaseArduinoHttp::begin(const String &url)
+{
+    // HTTPClient keeps the socket of `client` open across begin()/end()
+    // as long as reuse is enabled and the host does not change
+    bodyPending = false;
+    streamUsed = false;
+    startTiming();
+
+    // Host and port, for connecting ahead of HTTPClient
+    int start = url.indexOf("://");
+    start = start < 0 ? 0 : start + 3;
+    int end = url.indexOf('/', start);
+    if (end < 0)
+    {
+        end = url.length();
+    }
+    port = url.startsWith("http://") ? 80 : 443;
+    int colon = url.indexOf(':', start);
+    if (colon >= 0 && colon < end)
+    {
+        port = url.substring(colon + 1, end).toInt();
+        end = colon;
+    }
+    host = url.substring(start, end);
+    return https.begin(client, url);
+}
+
+// HTTPClient reuses a connected client, so connecting it here first lets
+// the lookup and the handshake be timed apart. The lookup repeated inside
+// connect() is answered from the lwIP DNS cache
+bool SupabaseArduinoHttp::connect()
+{
+#if !defined(ESP8266)
+    // First connection after a reboot: the address from before it, no
+    // lookup. The host name still goes into the handshake for SNI
+    if (restoredAddress)
+    {
+        IPAddress restored(restoredAddress);
+        restoredAddress = 0;
+        if (client.connect(restored, port, host.c_str(), nullptr, nullptr, nullptr))
+        {
+            address = (uint32_t)restored;
+            lap(lastTiming.connectUs);
+            return true;
+        }
+        // Moved or unreachable: look it up like any other time
+        lap(lastTiming.connectUs);
+    }
+#endif
+    IPAddress ip;
+    bool resolved = WiFi.hostByName(host.c_str(), ip) == 1;
+    lap(lastTiming.dnsUs);
+    if (!resolved)
+    {
+        return false;
+    }
+#if !defined(ESP8266)
+    address = (uint32_t)ip;
+#endif
+    bool connected = client.connect(host.c_str(), port);
+    lap(lastTiming.connectUs);
+    return connected;
+}
+
+int SupabaseArduinoHttp::sendRequest(const char *method, const uint8_t *body, size_t size)
+{
+    return send(method, body, size, nullptr, nullptr);
+}
+
+int SupabaseArduinoHttp::sendChunked(const char *method, SupabaseBodyProducer producer, void *ctx)
+{
+    return send(method, nullptr, 0, producer, ctx);
+}
+
+int SupabaseArduinoHttp::send(const char *method, const uint8_t *body, size_t size, SupabaseBodyProducer producer,
+                              void *ctx)
+{
+    // The chunk buffer is all a streamed body needs, however long it is
+    uint8_t *chunk = nullptr;
+    if (producer && (chunk = (uint8_t *)malloc(SUPABASE_UPLOAD_CHUNK + 8)) == nullptr)
+    {
+        return HTTPC_ERROR_TOO_LESS_RAM;
+    }
+    unsigned long sent = 0;
+
+    bool open = client.connected();
+
+    if (open && idleTimeout > 0 && millis() - lastUse > idleTimeout)
+    {
+        client.stop();
+        open = false;
+    }
+    if (wasOpen && !open)
+    {
+        connStats.drops++;
+    }
+
+    connStats.requests++;
+    connStats.bytesSent += size;
+    if (open)
+    {
+        connStats.reused++;
+    }
+    else
+    {
+        connStats.handshakes++;
+        if (haveSession)
+        {
+            connStats.resumed++;
+        }
+    }
+
+    phaseStart = micros();
+    if (!open && !connect())
+    {
+        free(chunk);
+        lastUse = millis();
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    int httpCode = producer ? https.sendChunked(method, client, producer, ctx, chunk, sent)
+                            : https.sendRequest(method, (uint8_t *)body, size);
+    lap(lastTiming.requestUs);
+
+    // The server may have closed a reused connection right before we wrote
+    // to it. Nothing reached it yet (nor was the producer called), so
+    // resend once on a fresh connection
+    if (open && httpCode == HTTPC_ERROR_SEND_HEADER_FAILED)
+    {
+        connStats.drops++;
+        connStats.handshakes++;
+        if (haveSession)
+        {
+            connStats.resumed++;
+        }
+        lastTiming.retries++;
+        client.stop();
+        if (!connect())
+        {
+            free(chunk);
+            lastUse = millis();
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+        httpCode = producer ? https.sendChunked(method, client, producer, ctx, chunk, sent)
+                            : https.sendRequest(method, (uint8_t *)body, size);
+        lap(lastTiming.requestUs);
+    }
+    free(chunk);
+    connStats.bytesSent += sent;
+
+    if (httpCode > 0)
+    {
+#if defined(ESP8266)
+        haveSession = true;
+#endif
+        // These never have a body: nothing to drain
+        bodyPending = httpCode != 204 && httpCode != 304;
+    }
+    lastUse = millis();
+    return httpCode;
+}
+
+String SupabaseArduinoHttp::getString()
+{
+    bodyPending = false;
+    String body = https.getString();
+    connStats.bytesReceived += body.length();
+    return body;
+}
+
+Stream *SupabaseArduinoHttp::getStream()
+{
+    if (!streamUsed)
+    {
+        String encoding = https.header("Transfer-Encoding");
+        encoding.toLowerCase();
+        body.reset(https.getStreamPtr(), https.getSize(), encoding.indexOf("chunked") >= 0);
+        streamUsed = true;
+    }
+    return &body;
+}
+
+void SupabaseArduinoHttp::drain()
+{
+    // Reading the body to the end keeps the connection in sync for reuse
+    if (streamUsed)
+    {
+        while (body.read() >= 0)
+        {
+        }
+    }
+    else
+    {
+        SupabaseNullStream sink;
+        int n = https.writeToStream(&sink);
+        if (n > 0)
+        {
+            connStats.bytesReceived += n;
+        }
+    }
+    bodyPending = false;
+}
+
+void SupabaseArduinoHttp::end()
+{
+    if (bodyPending)
+    {
+        drain();
+    }
+    if (streamUsed)
+    {
+        connStats.bytesReceived += body.consumed();
+        streamUsed = false;
+    }
+    lap(lastTiming.responseUs);
+    https.end();
+    wasOpen = client.connected();
+    lastUse = millis();
+}
+
+void SupabaseArduinoHttp::stop()
+{
+    https.end();
+    client.stop();
+    wasOpen = false;
+}
+
+#endif
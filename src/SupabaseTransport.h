@@ -0,0 +1,420 @@
+/**
+ * Transport layer used by `Supabase` for REST calls and the realtime socket.
+ *
+ * The client only talks to these two interfaces, so the same library code
+ * runs on the device (WiFiClientSecure + HTTPClient + WebSocketsClient) and
+ * on the host-native build (in-process stand-in, see
+ * `host/SupabaseLocalServer.h`, which also provides `SupabaseDefaultHttp`
+ * and `SupabaseDefaultSocket` there).
+ */
+
+#ifndef SupabaseTransport_h
+#define SupabaseTransport_h
+
+#include <Arduino.h>
+
+#if !defined(SUPABASE_HOST)
+#include <WiFiClientSecure.h>
+#include <WebSocketsClient.h>
+#if defined(ESP8266)
+#include <ESP8266HTTPClient.h>
+#else
+#include <HTTPClient.h>
+#endif
+#endif
+
+/** Returned when a request could not be started (e.g. `begin()` failed) */
+#define SUPABASE_ERR_BEGIN -100
+/** Returned when a response body is not the JSON the call expected */
+#define SUPABASE_ERR_PARSE -101
+/** Returned when a `SupabaseQuery` overflowed its buffer and was not sent */
+#define SUPABASE_ERR_OVERFLOW -102
+/** The access token expired and could not be refreshed; if the refresh
+ * token was rejected too, log in again */
+#define SUPABASE_ERR_AUTH -103
+/** Not an error: the write was stored in the journal and is sent later */
+#define SUPABASE_JOURNALED -104
+/** The journal is full (`SUPABASE_JOURNAL_DROP_NEWEST`) or the write is
+ * too large for it: the write is lost */
+#define SUPABASE_ERR_JOURNAL -105
+/** Not sent: the circuit breaker is open after repeated failures, see
+ * `Supabase::setRetryPolicy()` */
+#define SUPABASE_ERR_CIRCUIT_OPEN -106
+/** Not queued: all `SUPABASE_BROADCAST_QUEUE` slots are taken */
+#define SUPABASE_ERR_QUEUE_FULL -107
+/** Not queued: the subscription is not a broadcast channel, or is being
+ * left */
+#define SUPABASE_ERR_CHANNEL -108
+
+/** Events reported by a realtime socket transport */
+enum SupabaseSocketEvent
+{
+    SUPABASE_SOCKET_DISCONNECTED,
+    SUPABASE_SOCKET_CONNECTED,
+    SUPABASE_SOCKET_TEXT
+};
+
+typedef void (*SupabaseSocketHandler)(void *ctx, SupabaseSocketEvent event, uint8_t *payload, size_t length);
+
+/** Writes the next piece of a request body into `buffer` (at most `size`
+ * bytes, `SUPABASE_UPLOAD_CHUNK`). Returns the bytes written, 0 once the
+ * body is complete */
+typedef size_t (*SupabaseBodyProducer)(uint8_t *buffer, size_t size, void *ctx);
+
+/** Largest chunk of a streamed request body, also the buffer the producer
+ * fills. At most 0xFFFF */
+#ifndef SUPABASE_UPLOAD_CHUNK
+#define SUPABASE_UPLOAD_CHUNK 1024
+#endif
+
+/** Room for a TLS session in `SupabaseTransportState` */
+#ifndef SUPABASE_TLS_SESSION_BYTES
+#define SUPABASE_TLS_SESSION_BYTES 128
+#endif
+
+/** What a REST transport carries across a deep sleep, see
+ * `SupabaseHttpTransport::saveState()`. Plain bytes */
+struct SupabaseTransportState
+{
+    /** IPv4 address the host name resolved to, 0 if not kept */
+    uint32_t address;
+    /** Bytes of `session` in use, 0 without one */
+    uint16_t sessionLength;
+    uint8_t session[SUPABASE_TLS_SESSION_BYTES];
+};
+
+/** Connection reuse counters of a REST transport */
+struct SupabaseConnectionStats
+{
+    /** Requests sent */
+    unsigned long requests;
+    /** Requests sent over an already open keep-alive connection */
+    unsigned long reused;
+    /** New TCP + TLS connections */
+    unsigned long handshakes;
+    /** Handshakes that resumed a cached TLS session */
+    unsigned long resumed;
+    /** Open connections found closed by the peer or the idle timeout */
+    unsigned long drops;
+    /** Request and response body bytes as transferred (compressed if
+     * the body was), headers not included */
+    unsigned long bytesSent;
+    unsigned long bytesReceived;
+};
+
+/** Where the time of the last request went, see
+ * `SupabaseHttpTransport::timing()`. Phases that did not happen (e.g. DNS
+ * and connect on a reused connection) are 0 */
+struct SupabaseRequestTiming
+{
+    /** Host name lookup */
+    unsigned long dnsUs;
+    /** TCP connect and TLS handshake */
+    unsigned long connectUs;
+    /** Sending the request until the response headers arrived: upload
+     * plus the server's processing time */
+    unsigned long requestUs;
+    /** Reading the response body */
+    unsigned long responseUs;
+    /** Requests sent again on a fresh connection */
+    uint8_t retries;
+    /** Lowest free heap seen while the request ran */
+    uint32_t heapLow;
+};
+
+/** One HTTP request at a time: begin -> addHeader* -> sendRequest -> getString -> end.
+ * Implementations keep one keep-alive connection to the project host open
+ * between requests; `end()` leaves it open, `stop()` closes it */
+class SupabaseHttpTransport
+{
+public:
+    virtual ~SupabaseHttpTransport() {}
+
+    const SupabaseConnectionStats &stats() const { return connStats; }
+    void resetStats() { memset(&connStats, 0, sizeof(connStats)); }
+    /** Phases of the request since the last `begin()`, complete after `end()` */
+    const SupabaseRequestTiming &timing() const { return lastTiming; }
+
+    /** Close the keep-alive connection if it was idle for longer than
+     * `ms` before the next request (0 = keep it as long as the server does) */
+    void setIdleTimeout(unsigned long ms) { idleTimeout = ms; }
+
+    /** Called on `Supabase::connect()`, before the first request */
+    virtual void setInsecure() {}
+
+    /** Copy into `state` what makes the first connection after a reboot
+     * faster (resolved address, TLS session). This default keeps nothing */
+    virtual void saveState(SupabaseTransportState &state) { memset(&state, 0, sizeof(state)); }
+    /** Start from a `state` saved by the same kind of transport, before
+     * the first request. What turns out stale is dropped on first use */
+    virtual void restoreState(const SupabaseTransportState &state) {}
+
+    /** Prepare a request to `url`. Returns `false` if it cannot be used */
+    virtual bool begin(const String &url) = 0;
+    virtual void addHeader(const String &name, const String &value) = 0;
+    /** Send `method` ("GET", "POST", "PATCH", ...) with `size` bytes of `body`.
+     * Returns HTTP status code, or a negative transport error */
+    virtual int sendRequest(const char *method, const uint8_t *body, size_t size) = 0;
+    int sendRequest(const char *method, const String &body)
+    {
+        return sendRequest(method, (const uint8_t *)body.c_str(), body.length());
+    }
+    /** Send `method` with a body of unknown length, produced while it is
+     * sent (`Transfer-Encoding: chunked`). The producer is not restarted:
+     * a request that fails after it ran cannot be sent again. This default
+     * collects the whole body and calls `sendRequest()` */
+    virtual int sendChunked(const char *method, SupabaseBodyProducer producer, void *ctx);
+    /** Response body of the last request */
+    virtual String getString() = 0;
+    /** Header `name` of the last response, empty if it had none. Only
+     * `ETag`, `Content-Encoding` and `Transfer-Encoding` are kept by the
+     * default transport */
+    virtual String header(const char *name) { return String(); }
+    /** Response body of the last request as a stream, for parsing it
+     * without buffering. `read()` returns -1 at the end of the body */
+    virtual Stream *getStream() = 0;
+    /** Finish the current request. An unread body is drained so the
+     * connection stays usable */
+    virtual void end() = 0;
+    /** Close the underlying connection */
+    virtual void stop() = 0;
+
+protected:
+    SupabaseHttpTransport() : idleTimeout(0), phaseStart(0)
+    {
+        resetStats();
+        memset(&lastTiming, 0, sizeof(lastTiming));
+    }
+
+    SupabaseConnectionStats connStats;
+    SupabaseRequestTiming lastTiming;
+    unsigned long idleTimeout;
+    /** Start of the phase being timed */
+    unsigned long phaseStart;
+
+    void startTiming()
+    {
+        memset(&lastTiming, 0, sizeof(lastTiming));
+        lastTiming.heapLow = ESP.getFreeHeap();
+        phaseStart = micros();
+    }
+    /** Closes the phase timed since `phaseStart` into `phase` and starts the next one */
+    void lap(unsigned long &phase)
+    {
+        unsigned long now = micros();
+        phase += now - phaseStart;
+        phaseStart = now;
+        uint32_t heap = ESP.getFreeHeap();
+        if (heap < lastTiming.heapLow)
+        {
+            lastTiming.heapLow = heap;
+        }
+    }
+};
+
+/** A realtime connect attempt not completed within this (ms) is retried
+ * with backoff */
+#ifndef SUPABASE_REALTIME_CONNECT_TIMEOUT
+#define SUPABASE_REALTIME_CONNECT_TIMEOUT 10000
+#endif
+
+/** Realtime (Phoenix) WebSocket */
+class SupabaseSocketTransport
+{
+public:
+    virtual ~SupabaseSocketTransport() {}
+
+    virtual void begin(const String &host, int port, const String &path) = 0;
+    virtual void onEvent(SupabaseSocketHandler handler, void *ctx) = 0;
+    virtual bool sendTXT(const String &payload) = 0;
+    /** Pump the socket. Events are delivered from here */
+    virtual void loop() = 0;
+    /** Close the socket. It stays closed until the next `begin()`: the
+     * client decides when to reconnect */
+    virtual void disconnect() = 0;
+};
+
+/** Reads a `String` (e.g. a buffered response) through the `Stream` API */
+class SupabaseStringStream : public Stream
+{
+public:
+    SupabaseStringStream() : str(nullptr), pos(0) {}
+    explicit SupabaseStringStream(const String &s) : str(&s), pos(0) {}
+
+    void reset(const String *s)
+    {
+        str = s;
+        pos = 0;
+    }
+
+    int available() { return str ? str->length() - pos : 0; }
+    int read() { return available() > 0 ? (unsigned char)(*str)[pos++] : -1; }
+    int peek() { return available() > 0 ? (unsigned char)(*str)[pos] : -1; }
+    void flush() {}
+    size_t write(uint8_t) { return 0; }
+
+private:
+    const String *str;
+    unsigned int pos;
+};
+
+#if !defined(SUPABASE_HOST)
+
+/** Body of a response on a keep-alive connection: undoes
+ * `Transfer-Encoding: chunked` and stops at `Content-Length`, so exactly
+ * the body is consumed and the next request can reuse the socket */
+class SupabaseBodyStream : public Stream
+{
+public:
+    SupabaseBodyStream() : src(nullptr), remaining(0), chunked(false), first(true), done(true), peeked(-1), count(0) {}
+
+    /** `length` is the Content-Length, or -1 if unknown */
+    void reset(Stream *source, long length, bool isChunked);
+    bool finished() const { return done && peeked < 0; }
+    /** Body bytes read from the connection since `reset()` */
+    unsigned long consumed() const { return count; }
+
+    int available();
+    int read();
+    int peek();
+    void flush() {}
+    size_t write(uint8_t) { return 0; }
+
+private:
+    Stream *src;
+    long remaining;
+    bool chunked;
+    bool first;
+    bool done;
+    int peeked;
+    unsigned long count;
+
+    int next();
+    int nextRaw();
+    bool nextChunk();
+};
+
+typedef void (*WebSocketEventHandler)(WStype_t type, uint8_t * payload, size_t length);
+
+/** HTTPClient that can also send a chunked request body */
+class SupabaseHTTPClient : public HTTPClient
+{
+public:
+    /** Like `sendRequest()`, the body coming from `producer` one chunk at
+     * a time. `buffer` holds `SUPABASE_UPLOAD_CHUNK` bytes plus 8 for the
+     * chunk framing. `sent` is the body bytes written */
+    int sendChunked(const char *method, Client &client, SupabaseBodyProducer producer, void *ctx, uint8_t *buffer,
+                    unsigned long &sent);
+};
+
+/** Default REST transport: WiFiClientSecure + HTTPClient with a persistent
+ * keep-alive connection. On ESP8266 the BearSSL session is cached so a
+ * reconnect after an idle drop resumes TLS instead of a full handshake.
+ * The ESP32 core does not expose mbedTLS session tickets, so there every
+ * reconnect is counted as a full handshake.
+ *
+ * Saved state: the BearSSL session on ESP8266; the resolved address on
+ * ESP32, used for the first connection only (its core takes an address
+ * plus the host name for SNI, the ESP8266 one does not) */
+class SupabaseArduinoHttp : public SupabaseHttpTransport
+{
+public:
+    SupabaseArduinoHttp();
+
+    void setInsecure();
+    void saveState(SupabaseTransportState &state);
+    void restoreState(const SupabaseTransportState &state);
+
+    bool begin(const String &url);
+    void addHeader(const String &name, const String &value) { https.addHeader(name, value); }
+    using SupabaseHttpTransport::sendRequest;
+    int sendRequest(const char *method, const uint8_t *body, size_t size);
+    int sendChunked(const char *method, SupabaseBodyProducer producer, void *ctx);
+    String getString();
+    String header(const char *name) { return https.header(name); }
+    Stream *getStream();
+    void end();
+    void stop();
+
+private:
+    WiFiClientSecure client;
+    SupabaseHTTPClient https;
+    SupabaseBodyStream body;
+    bool streamUsed;
+#if defined(ESP8266)
+    BearSSL::Session session;
+#endif
+    bool haveSession;
+    bool wasOpen;
+    bool bodyPending;
+    unsigned long lastUse;
+    String host;
+    uint16_t port;
+    /** Where `host` resolved to last, and the address restored for the
+     * first connection (0 once used) */
+    uint32_t address;
+    uint32_t restoredAddress;
+
+    void drain();
+    bool connect();
+    /** `sendRequest()` with `body`, or `sendChunked()` with `producer` */
+    int send(const char *method, const uint8_t *body, size_t size, SupabaseBodyProducer producer, void *ctx);
+};
+
+/** Default realtime transport: WebSocketsClient over TLS */
+class SupabaseArduinoSocket : public SupabaseSocketTransport
+{
+public:
+    void begin(const String &host, int port, const String &path)
+    {
+        // Retries are paced by the client's backoff, not by a fixed
+        // interval inside WebSocketsClient
+        webSocket.setReconnectInterval(SUPABASE_REALTIME_CONNECT_TIMEOUT);
+        webSocket.beginSSL(host, port, path);
+        active = true;
+    }
+    void onEvent(SupabaseSocketHandler handler, void *ctx)
+    {
+        webSocket.onEvent([handler, ctx](WStype_t type, uint8_t *payload, size_t length)
+        {
+            switch (type)
+            {
+            case WStype_DISCONNECTED:
+                handler(ctx, SUPABASE_SOCKET_DISCONNECTED, payload, length);
+                break;
+            case WStype_CONNECTED:
+                handler(ctx, SUPABASE_SOCKET_CONNECTED, payload, length);
+                break;
+            case WStype_TEXT:
+                handler(ctx, SUPABASE_SOCKET_TEXT, payload, length);
+                break;
+            default:
+                break;
+            }
+        });
+    }
+    bool sendTXT(const String &payload) { return webSocket.sendTXT(payload.c_str(), payload.length()); }
+    void loop()
+    {
+        if (active)
+        {
+            webSocket.loop();
+        }
+    }
+    void disconnect()
+    {
+        active = false;
+        webSocket.disconnect();
+    }
+
+private:
+    WebSocketsClient webSocket;
+    bool active = false;
+};
+
+typedef SupabaseArduinoHttp SupabaseDefaultHttp;
+typedef SupabaseArduinoSocket SupabaseDefaultSocket;
+
+#endif
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SupabaseWarmStart_h
+#define SupabaseWarmStart_h
+
+#include "SupabaseTransport.h"
+
+/** Room for the access token. It is a JWT and grows with the user's
+ * metadata: one that does not fit is left out, and the node refreshes the
+ * session with the saved refresh token on wake */
+#ifndef SUPABASE_WARM_TOKEN_BYTES
+#define SUPABASE_WARM_TOKEN_BYTES 1280
+#endif
+
+/** Room for the refresh token */
+#ifndef SUPABASE_WARM_REFRESH_BYTES
+#define SUPABASE_WARM_REFRESH_BYTES 96
+#endif
+
+/** What a node keeps across deep sleep so that its next cold start skips
+ * the DNS lookup, the full TLS handshake and the password login, see
+ * `Supabase::setWarmStart()`.
+ *
+ * Plain bytes, checked when they are restored: a record that is corrupt,
+ * from another layout or another project is ignored. On ESP32 keep it in
+ * RTC memory
+ *
+ *     RTC_DATA_ATTR SupabaseWarmStart warm;
+ *
+ * On ESP8266 the RTC user memory (512 bytes) is too small: write it to a
+ * file before going to sleep and read it back before `begin()` */
+struct SupabaseWarmStart
+{
+    uint32_t magic;
+    /** CRC-32 of everything after it */
+    uint32_t check;
+    /** Of the project URL and key */
+    uint32_t project;
+    /** Of the login method and user the tokens belong to, 0 without them */
+    uint32_t user;
+    /** `time()` when it was saved */
+    uint32_t savedAt;
+    /** Lifetime of the access token (ms), and how much of it was left */
+    uint32_t tokenLifetime;
+    uint32_t tokenLeft;
+    SupabaseTransportState transport;
+    char accessToken[SUPABASE_WARM_TOKEN_BYTES];
+    char refreshToken[SUPABASE_WARM_REFRESH_BYTES];
+};
+
+#endif
@@ -0,0 +1,344 @@
+#include "SupabaseWriteCoalescer.h"
+
+SupabaseWriteCoalescer::SupabaseWriteCoalescer(Supabase &db_a, const String &table_a, unsigned long intervalMs_a)
+    : db(db_a), table(table_a)
+{
+    intervalMs = intervalMs_a;
+    for (uint8_t i = 0; i < SUPABASE_COALESCE_MAX_ROWS; i++)
+    {
+        rows[i].lastWrite = 0;
+        rows[i].used = false;
+        rows[i].urgent = false;
+    }
+    thresholdCount = 0;
+    callback = nullptr;
+    callbackCtx = nullptr;
+    updateCount = 0;
+    writeCount = 0;
+    failedCount = 0;
+}
+
+void SupabaseWriteCoalescer::onFlush(SupabaseCoalesceCallback callback_a, void *ctx)
+{
+    callback = callback_a;
+    callbackCtx = ctx;
+}
+
+bool SupabaseWriteCoalescer::setThreshold(const char *field, float delta)
+{
+    for (uint8_t i = 0; i < thresholdCount; i++)
+    {
+        if (thresholds[i].field == field)
+        {
+            thresholds[i].delta = delta;
+            return true;
+        }
+    }
+    if (thresholdCount == SUPABASE_COALESCE_THRESHOLDS)
+    {
+        return false;
+    }
+    thresholds[thresholdCount].field = field;
+    thresholds[thresholdCount].delta = delta;
+    thresholdCount++;
+    return true;
+}
+
+void SupabaseWriteCoalescer::upsertOn(const char *conflictColumns)
+{
+    conflict = conflictColumns ? conflictColumns : "";
+}
+
+SupabaseWriteCoalescer::Row *SupabaseWriteCoalescer::row(const char *filter)
+{
+    Row *free = nullptr;
+    for (uint8_t i = 0; i < SUPABASE_COALESCE_MAX_ROWS; i++)
+    {
+        Row &r = rows[i];
+        if (r.used && r.filter == filter)
+        {
+            return &r;
+        }
+        // An unused slot, else the row without changes written longest ago:
+        // forgetting its state only costs a write that could have been skipped
+        if (!r.used)
+        {
+            if (free == nullptr || free->used)
+            {
+                free = &r;
+            }
+        }
+        else if (r.pending.size() == 0 &&
+                 (free == nullptr || (free->used && (long)(r.lastWrite - free->lastWrite) < 0)))
+        {
+            free = &r;
+        }
+    }
+    if (free == nullptr)
+    {
+        return nullptr;
+    }
+    free->filter = filter;
+    free->pending.clear();
+    free->written.clear();
+    // The first change of a row goes out with the next `loop()`
+    free->lastWrite = millis() - intervalMs;
+    free->used = true;
+    free->urgent = false;
+    return free;
+}
+
+bool SupabaseWriteCoalescer::set(const char *filter, const char *json, size_t length)
+{
+    JsonDocument fields;
+    if (deserializeJson(fields, json, length) || !fields.is<JsonObject>())
+    {
+        return false;
+    }
+    return set(filter, fields.as<JsonObjectConst>());
+}
+
+bool SupabaseWriteCoalescer::set(const char *filter, JsonObjectConst fields)
+{
+    if (fields.isNull())
+    {
+        return false;
+    }
+    Row *r = row(filter);
+    if (r == nullptr)
+    {
+        return false;
+    }
+    updateCount++;
+    for (JsonPairConst kv : fields)
+    {
+        JsonVariantConst value = kv.value();
+        if (!value.isNull() && r->written[kv.key()] == value)
+        {
+            // Back to what the server has: nothing to send for it
+            r->pending.remove(kv.key());
+            continue;
+        }
+        if (crossed(*r, kv.key().c_str(), value))
+        {
+            r->urgent = true;
+        }
+        r->pending[kv.key()] = value;
+    }
+    if (r->urgent)
+    {
+        write(r, false);
+    }
+    return true;
+}
+
+bool SupabaseWriteCoalescer::crossed(const Row &r, const char *field, JsonVariantConst value) const
+{
+    for (uint8_t i = 0; i < thresholdCount; i++)
+    {
+        if (thresholds[i].field == field)
+        {
+            JsonVariantConst last = r.written[field];
+            // Nothing written yet: the row is due anyway
+            if (!last.is<float>() || !value.is<float>())
+            {
+                return false;
+            }
+            return fabs(value.as<float>() - last.as<float>()) >= thresholds[i].delta;
+        }
+    }
+    return false;
+}
+
+bool SupabaseWriteCoalescer::due(const Row &r, unsigned long now) const
+{
+    return r.used && r.pending.size() > 0 && (r.urgent || now - r.lastWrite >= intervalMs);
+}
+
+size_t SupabaseWriteCoalescer::pendingRows() const
+{
+    size_t count = 0;
+    for (uint8_t i = 0; i < SUPABASE_COALESCE_MAX_ROWS; i++)
+    {
+        if (rows[i].used && rows[i].pending.size() > 0)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void SupabaseWriteCoalescer::loop()
+{
+    write(nullptr, false);
+}
+
+int SupabaseWriteCoalescer::flush()
+{
+    return write(nullptr, true);
+}
+
+int SupabaseWriteCoalescer::write(Row *only, bool all)
+{
+    if (conflict.length())
+    {
+        // One request for every row due, `only` included (it is urgent)
+        return upsert(all);
+    }
+    if (only)
+    {
+        return patch(*only);
+    }
+    int httpCode = 0;
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < SUPABASE_COALESCE_MAX_ROWS; i++)
+    {
+        Row &r = rows[i];
+        if (all ? (r.used && r.pending.size() > 0) : due(r, now))
+        {
+            httpCode = patch(r);
+        }
+    }
+    return httpCode;
+}
+
+int SupabaseWriteCoalescer::patch(Row &r)
+{
+    char buffer[SUPABASE_COALESCE_QUERY_BYTES];
+    SupabaseQuery query(buffer, sizeof(buffer));
+    query.from(table.c_str()).where(r.filter.c_str());
+
+    String json;
+    serializeJson(r.pending, json);
+    int httpCode = db.doUpdate(query, json);
+    counted(httpCode);
+    written(r, httpCode);
+    return httpCode;
+}
+
+// `true` if both rows have the same columns
+static bool sameKeys(JsonObjectConst a, JsonObjectConst b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (JsonPairConst kv : a)
+    {
+        bool found = false;
+        for (JsonPairConst other : b)
+        {
+            if (strcmp(kv.key().c_str(), other.key().c_str()) == 0)
+            {
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int SupabaseWriteCoalescer::upsert(bool all)
+{
+    // Full state: an upsert writes every column it names
+    JsonDocument state;
+    JsonArray full = state.to<JsonArray>();
+    Row *picked[SUPABASE_COALESCE_MAX_ROWS];
+    uint8_t count = 0;
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < SUPABASE_COALESCE_MAX_ROWS; i++)
+    {
+        Row &r = rows[i];
+        if (!(all ? (r.used && r.pending.size() > 0) : due(r, now)))
+        {
+            continue;
+        }
+        JsonObject item = full.add<JsonObject>();
+        for (JsonPairConst kv : r.written.as<JsonObjectConst>())
+        {
+            item[kv.key()] = kv.value();
+        }
+        for (JsonPairConst kv : r.pending.as<JsonObjectConst>())
+        {
+            item[kv.key()] = kv.value();
+        }
+        picked[count++] = &r;
+    }
+
+    // PostgREST refuses a bulk upsert whose rows differ in their keys, and
+    // `columns=` would null the missing ones: one request per set of keys
+    int httpCode = 0;
+    bool done[SUPABASE_COALESCE_MAX_ROWS] = {};
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (done[i])
+        {
+            continue;
+        }
+        JsonObjectConst first = full[i].as<JsonObjectConst>();
+        JsonDocument batch;
+        JsonArray items = batch.to<JsonArray>();
+        Row *sent[SUPABASE_COALESCE_MAX_ROWS];
+        uint8_t group = 0;
+        for (uint8_t j = i; j < count; j++)
+        {
+            JsonObjectConst item = full[j].as<JsonObjectConst>();
+            if (!done[j] && sameKeys(first, item))
+            {
+                items.add(item);
+                sent[group++] = picked[j];
+                done[j] = true;
+            }
+        }
+
+        String json;
+        serializeJson(batch, json);
+        // In the target rather than `SupabasePrefer::onConflict`: a journaled
+        // upsert is replayed with it
+        String target = table + "?on_conflict=" + conflict;
+        httpCode = db.insert(target, json.c_str(), json.length(), true);
+        counted(httpCode);
+        for (uint8_t j = 0; j < group; j++)
+        {
+            written(*sent[j], httpCode);
+        }
+    }
+    return httpCode;
+}
+
+// Stored in the journal counts as written: it is delivered in order
+static bool writeOk(int httpCode)
+{
+    return (httpCode >= 200 && httpCode < 300) || httpCode == SUPABASE_JOURNALED;
+}
+
+void SupabaseWriteCoalescer::counted(int httpCode)
+{
+    writeCount++;
+    if (!writeOk(httpCode))
+    {
+        failedCount++;
+    }
+}
+
+void SupabaseWriteCoalescer::written(Row &r, int httpCode)
+{
+    r.lastWrite = millis();
+    r.urgent = false;
+    if (writeOk(httpCode))
+    {
+        for (JsonPairConst kv : r.pending.as<JsonObjectConst>())
+        {
+            r.written[kv.key()] = kv.value();
+        }
+        r.pending.clear();
+    }
+    if (callback)
+    {
+        callback(r.filter.c_str(), httpCode, callbackCtx);
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef SupabaseWriteCoalescer_h
+#define SupabaseWriteCoalescer_h
+
+#include "ESP32_Supabase.h"
+
+/** Rows a coalescer tracks at most */
+#ifndef SUPABASE_COALESCE_MAX_ROWS
+#define SUPABASE_COALESCE_MAX_ROWS 8
+#endif
+
+/** Fields with a change threshold, see `setThreshold()` */
+#ifndef SUPABASE_COALESCE_THRESHOLDS
+#define SUPABASE_COALESCE_THRESHOLDS 4
+#endif
+
+/** Room for `table?filter` of one PATCH */
+#ifndef SUPABASE_COALESCE_QUERY_BYTES
+#define SUPABASE_COALESCE_QUERY_BYTES 128
+#endif
+
+/** Called after a row was written (or the write failed). `filter` is the
+ * row as passed to `set()` */
+typedef void (*SupabaseCoalesceCallback)(const char *filter, int httpCode, void *ctx);
+
+/** Merges frequent partial updates of the same rows into one write per
+ * row and interval.
+ *
+ * Every row is keyed by its PostgREST filter (e.g. `"id=eq.7"`). `set()`
+ * merges the given fields into the row's pending changes, the latest value
+ * of a field wins. A field set back to the value last written is dropped
+ * from them, and a row without changes is not written at all. `loop()`
+ * sends a row's changes as one PATCH once `intervalMs` passed since its
+ * last write. A field with a threshold (`setThreshold()`) that moved at
+ * least that far from the value last written flushes the row at once.
+ *
+ * With `upsertOn()`, the rows due are sent as bulk upserts of their full
+ * known state instead, the conflict columns included. PostgREST refuses a
+ * bulk upsert whose rows have different keys (PGRST102), so rows are
+ * grouped by their set of fields, one request per group.
+ *
+ * A failed write keeps the changes: they are merged with newer ones and
+ * sent again after the next interval. Use the coalescer from one task.
+ *
+ *     SupabaseWriteCoalescer devices(db, "devices", 500);
+ *     devices.setThreshold("temp", 0.5);
+ *     devices.set("id=eq.7", "{\"temp\":21.3,\"fan\":2}");
+ *     devices.loop();
+ */
+class SupabaseWriteCoalescer
+{
+public:
+    SupabaseWriteCoalescer(Supabase &db, const String &table, unsigned long intervalMs = 1000);
+
+    /** Report the outcome of each row write */
+    void onFlush(SupabaseCoalesceCallback callback, void *ctx = nullptr);
+    /** Flush a row as soon as `field` moved by at least `delta`. Returns
+     * `false` when all `SUPABASE_COALESCE_THRESHOLDS` slots are taken */
+    bool setThreshold(const char *field, float delta);
+    /** Send due rows as one bulk upsert on these unique columns
+     * (comma-separated), `nullptr` for one PATCH per row */
+    void upsertOn(const char *conflictColumns);
+
+    /** Merge `fields` (a JSON object) into the row matching `filter`.
+     * Returns `false` if the JSON is not an object or all
+     * `SUPABASE_COALESCE_MAX_ROWS` rows have unsent changes */
+    bool set(const char *filter, const char *json, size_t length);
+    bool set(const char *filter, const String &json) { return set(filter, json.c_str(), json.length()); }
+    bool set(const char *filter, JsonObjectConst fields);
+
+    /** Call periodically: writes the rows whose interval passed */
+    void loop();
+    /** Write all pending changes now. Returns the last HTTP code, 0 if
+     * there was nothing to send */
+    int flush();
+
+    size_t pendingRows() const;
+
+    /** Totals since construction: `set()` calls, requests sent and
+     * requests failed */
+    unsigned long updates() const { return updateCount; }
+    unsigned long writes() const { return writeCount; }
+    unsigned long writesFailed() const { return failedCount; }
+
+private:
+    struct Row
+    {
+        String filter;
+        /** Fields changed since the last successful write */
+        JsonDocument pending;
+        /** Every field as last written */
+        JsonDocument written;
+        unsigned long lastWrite;
+        bool used;
+        bool urgent;
+    };
+    struct Threshold
+    {
+        String field;
+        float delta;
+    };
+
+    Supabase &db;
+    String table;
+    unsigned long intervalMs;
+    String conflict;
+    Row rows[SUPABASE_COALESCE_MAX_ROWS];
+    Threshold thresholds[SUPABASE_COALESCE_THRESHOLDS];
+    uint8_t thresholdCount;
+
+    SupabaseCoalesceCallback callback;
+    void *callbackCtx;
+
+    unsigned long updateCount;
+    unsigned long writeCount;
+    unsigned long failedCount;
+
+    Row *row(const char *filter);
+    bool crossed(const Row &row, const char *field, JsonVariantConst value) const;
+    bool due(const Row &row, unsigned long now) const;
+    /** `only` one row, or the rows due (`all`: every row with changes) */
+    int write(Row *only, bool all);
+    int patch(Row &row);
+    int upsert(bool all);
+    void counted(int httpCode);
+    void written(Row &row, int httpCode);
+};
+
+#endif
@@ -0,0 +1,311 @@
+/**
+ * Minimal Arduino core subset for the host-native (Linux) build.
+ *
+ * Only compiled when `SUPABASE_HOST` is defined (see `[env:native]` in
+ * `platformio.ini`). It provides just enough of `String`, `Print`, `Stream`,
+ * timing and FreeRTOS task API to run the library code unchanged on a PC.
+ */
+
+#ifndef SupabaseHost_Arduino_h
+#define SupabaseHost_Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+#include <functional>
+
+// ArduinoJson only enables its Arduino adapters when `ARDUINO` is defined
+#ifndef ARDUINOJSON_ENABLE_ARDUINO_STRING
+#define ARDUINOJSON_ENABLE_ARDUINO_STRING 1
+#endif
+#ifndef ARDUINOJSON_ENABLE_ARDUINO_STREAM
+#define ARDUINOJSON_ENABLE_ARDUINO_STREAM 1
+#endif
+#ifndef ARDUINOJSON_ENABLE_ARDUINO_PRINT
+#define ARDUINOJSON_ENABLE_ARDUINO_PRINT 1
+#endif
+
+// Flash strings are ordinary strings on the host
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+#define PROGMEM
+#define PSTR(s) (s)
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+
+class String
+{
+public:
+    String() {}
+    String(const char *cstr) { if (cstr) s = cstr; }
+    String(const char *cstr, unsigned int length) { if (cstr) s.assign(cstr, length); }
+    String(const String &str) : s(str.s) {}
+    String(const __FlashStringHelper *str) : String((const char *)str) {}
+    explicit String(char c) : s(1, c) {}
+    explicit String(int value, unsigned char base = 10) { fromLong(value, base); }
+    explicit String(unsigned int value, unsigned char base = 10) { fromULong(value, base); }
+    explicit String(long value, unsigned char base = 10) { fromLong(value, base); }
+    explicit String(unsigned long value, unsigned char base = 10) { fromULong(value, base); }
+    explicit String(float value, unsigned int decimals = 2) { fromDouble(value, decimals); }
+    explicit String(double value, unsigned int decimals = 2) { fromDouble(value, decimals); }
+
+    String &operator=(const String &rhs) { s = rhs.s; return *this; }
+    String &operator=(const char *cstr) { if (cstr) s = cstr; else s.clear(); return *this; }
+
+    bool reserve(unsigned int size) { s.reserve(size); return true; }
+    unsigned int length() const { return (unsigned int)s.length(); }
+    bool isEmpty() const { return s.empty(); }
+    const char *c_str() const { return s.c_str(); }
+    char *begin() { return &s[0]; }
+    char *end() { return &s[0] + s.length(); }
+
+    bool concat(const String &str) { s += str.s; return true; }
+    bool concat(const char *cstr) { if (cstr) s += cstr; return true; }
+    bool concat(const char *cstr, unsigned int length) { if (cstr) s.append(cstr, length); return true; }
+    bool concat(char c) { s += c; return true; }
+    bool concat(int value) { return concat(String(value)); }
+    bool concat(unsigned int value) { return concat(String(value)); }
+    bool concat(long value) { return concat(String(value)); }
+    bool concat(unsigned long value) { return concat(String(value)); }
+
+    String &operator+=(const String &rhs) { concat(rhs); return *this; }
+    String &operator+=(const char *cstr) { concat(cstr); return *this; }
+    String &operator+=(char c) { concat(c); return *this; }
+    String &operator+=(int value) { concat(value); return *this; }
+    String &operator+=(unsigned int value) { concat(value); return *this; }
+    String &operator+=(long value) { concat(value); return *this; }
+    String &operator+=(unsigned long value) { concat(value); return *this; }
+
+    bool equals(const String &str) const { return s == str.s; }
+    bool equals(const char *cstr) const { return s == (cstr ? cstr : ""); }
+    bool operator==(const String &rhs) const { return equals(rhs); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &rhs) const { return s < rhs.s; }
+
+    char charAt(unsigned int index) const { return index < s.length() ? s[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index) { return s[index]; }
+
+    bool startsWith(const String &prefix) const { return s.compare(0, prefix.s.length(), prefix.s) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return s.length() >= suffix.s.length() &&
+               s.compare(s.length() - suffix.s.length(), suffix.s.length(), suffix.s) == 0;
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { return toIndex(s.find(c, from)); }
+    int indexOf(const String &str, unsigned int from = 0) const { return toIndex(s.find(str.s, from)); }
+    int lastIndexOf(char c) const { return toIndex(s.rfind(c)); }
+    int lastIndexOf(const String &str) const { return toIndex(s.rfind(str.s)); }
+
+    String substring(unsigned int from) const { return substring(from, length()); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to) { unsigned int t = from; from = to; to = t; }
+        if (from >= s.length()) return String();
+        if (to > s.length()) to = length();
+        return String(s.c_str() + from, to - from);
+    }
+
+    void replace(const String &find, const String &replacement)
+    {
+        if (find.s.empty()) return;
+        size_t pos = 0;
+        while ((pos = s.find(find.s, pos)) != std::string::npos)
+        {
+            s.replace(pos, find.s.length(), replacement.s);
+            pos += replacement.s.length();
+        }
+    }
+    void remove(unsigned int index) { if (index < s.length()) s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < s.length()) s.erase(index, count); }
+    void toLowerCase() { for (size_t i = 0; i < s.length(); i++) s[i] = (char)tolower((unsigned char)s[i]); }
+    void toUpperCase() { for (size_t i = 0; i < s.length(); i++) s[i] = (char)toupper((unsigned char)s[i]); }
+    void trim();
+
+    long toInt() const { return atol(s.c_str()); }
+    float toFloat() const { return (float)atof(s.c_str()); }
+    double toDouble() const { return atof(s.c_str()); }
+
+private:
+    std::string s;
+
+    static int toIndex(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    void fromLong(long value, unsigned char base);
+    void fromULong(unsigned long value, unsigned char base);
+    void fromDouble(double value, unsigned int decimals);
+};
+
+/** Needed by ArduinoJson's `String` adapter */
+class StringSumHelper : public String
+{
+public:
+    StringSumHelper(const String &s) : String(s) {}
+    StringSumHelper(const char *p) : String(p) {}
+};
+
+inline String operator+(const String &lhs, const String &rhs) { String r(lhs); r += rhs; return r; }
+inline String operator+(const String &lhs, const char *rhs) { String r(lhs); r += rhs; return r; }
+inline String operator+(const char *lhs, const String &rhs) { String r(lhs); r += rhs; return r; }
+inline String operator+(const String &lhs, char rhs) { String r(lhs); r += rhs; return r; }
+inline String operator+(const String &lhs, int rhs) { String r(lhs); r += rhs; return r; }
+inline String operator+(const String &lhs, unsigned int rhs) { String r(lhs); r += rhs; return r; }
+inline String operator+(const String &lhs, long rhs) { String r(lhs); r += rhs; return r; }
+inline String operator+(const String &lhs, unsigned long rhs) { String r(lhs); r += rhs; return r; }
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--)
+        {
+            if (write(*buffer++) == 0) break;
+            n++;
+        }
+        return n;
+    }
+    size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+
+    size_t print(const String &s) { return write(s.c_str(), s.length()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(const __FlashStringHelper *s) { return write((const char *)s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int n) { return print(String(n)); }
+    size_t print(unsigned int n) { return print(String(n)); }
+    size_t print(long n) { return print(String(n)); }
+    size_t print(unsigned long n) { return print(String(n)); }
+    size_t print(double n, int digits = 2) { return print(String(n, digits)); }
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &value) { size_t n = print(value); return n + println(); }
+    size_t printf(const char *format, ...);
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout() const { return _timeout; }
+
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    String readString();
+    bool find(const char *target) { return findUntil(target, NULL); }
+    bool findUntil(const char *target, const char *terminator);
+
+protected:
+    unsigned long _timeout = 1000;
+    int timedRead();
+    int timedPeek();
+};
+
+/** Heap of the simulated board */
+#ifndef SUPABASE_HOST_HEAP
+#define SUPABASE_HOST_HEAP 320000
+#endif
+
+/** `ESP.getFreeHeap()`: `SUPABASE_HOST_HEAP` minus the bytes currently
+ * allocated with operator new (which is what `String` uses here) */
+class HostEsp
+{
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+};
+extern HostEsp ESP;
+
+/** stdout-backed `Serial` so examples can print on the host */
+class HostSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    int available() { return 0; }
+    int read() { return -1; }
+    int peek() { return -1; }
+    size_t write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+    using Print::write;
+};
+extern HostSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// FreeRTOS subset: tasks are backed by detached std::threads
+typedef void (*TaskFunction_t)(void *);
+typedef void *TaskHandle_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stackDepth,
+                       void *parameters, UBaseType_t priority, TaskHandle_t *createdTask);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackDepth,
+                                   void *parameters, UBaseType_t priority, TaskHandle_t *createdTask,
+                                   BaseType_t coreId);
+void vTaskDelete(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void vTaskDelay(TickType_t ticks);
+
+// FreeRTOS queues and semaphores, backed by std::mutex/condition_variable
+struct HostQueue;
+typedef HostQueue *QueueHandle_t;
+struct HostSemaphore;
+typedef HostSemaphore *SemaphoreHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+void vQueueDelete(QueueHandle_t queue);
+#define xQueueSendToBack xQueueSend
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t wait);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+
+// Host-only: number of heap allocations (operator new / malloc through
+// operator new) since program start, for allocation benchmarks
+unsigned long hostAllocations();
+
+#endif
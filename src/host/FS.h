@@ -0,0 +1,93 @@
+/**
+ * Host-native stand-in for the Arduino `FS` / `File` API.
+ *
+ * Paths are resolved below a directory of the host file system, so code
+ * written against `LittleFS` runs unchanged and leaves its files in
+ * `root` for inspection.
+ */
+
+#ifndef SupabaseHost_FS_h
+#define SupabaseHost_FS_h
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+
+enum SeekMode
+{
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+struct HostFileImpl;
+
+class File : public Stream
+{
+public:
+    File() {}
+    explicit File(std::shared_ptr<HostFileImpl> impl) : impl(impl) {}
+
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *buf, size_t size);
+    int available();
+    int read();
+    int peek();
+    void flush();
+    size_t read(uint8_t *buf, size_t size);
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    const char *name() const;
+    const char *path() const;
+    bool isDirectory() const;
+    File openNextFile(const char *mode = "r");
+
+private:
+    std::shared_ptr<HostFileImpl> impl;
+};
+
+class FS
+{
+public:
+    explicit FS(const std::string &root) : root(root) {}
+
+    File open(const char *path, const char *mode = "r", bool create = false);
+    File open(const String &path, const char *mode = "r", bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path);
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *from, const char *to);
+    bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char *path);
+    bool mkdir(const String &path) { return mkdir(path.c_str()); }
+    bool rmdir(const char *path);
+
+    /** Host directory the paths are resolved in */
+    void setRoot(const std::string &dir) { root = dir; }
+
+protected:
+    std::string root;
+    std::string resolve(const char *path) const;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
+
+#endif
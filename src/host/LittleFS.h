@@ -0,0 +1,29 @@
+/**
+ * Host-native stand-in for the ESP32 `LittleFS` object: a directory
+ * (`./littlefs` unless changed with `setRoot()`) of the host file system.
+ */
+
+#ifndef SupabaseHost_LittleFS_h
+#define SupabaseHost_LittleFS_h
+
+#include <FS.h>
+
+namespace fs
+{
+
+class LittleFSFS : public FS
+{
+public:
+    LittleFSFS() : FS("littlefs") {}
+
+    bool begin(bool formatOnFail = false, const char *basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char *partitionLabel = "spiffs");
+    bool format();
+    void end() {}
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif
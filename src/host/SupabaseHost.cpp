@@ -0,0 +1,922 @@
+/**
+ * Implementation of the host-native Arduino/ESP-IDF subset.
+ * Compiled to nothing unless `SUPABASE_HOST` is defined.
+ */
+
+#if defined(SUPABASE_HOST)
+
+#include <Arduino.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include <WiFi.h>
+#include <esp_timer.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+HostSerial Serial;
+HostEsp ESP;
+HostWiFiClass WiFi;
+fs::LittleFSFS LittleFS;
+
+// Allocation counter
+
+static std::atomic<unsigned long> hostAllocCount(0);
+// Bytes currently allocated through operator new, and their peak
+static std::atomic<size_t> hostLiveBytes(0);
+static std::atomic<size_t> hostPeakBytes(0);
+
+unsigned long hostAllocations()
+{
+    return hostAllocCount.load();
+}
+
+void *operator new(size_t size)
+{
+    hostAllocCount++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    size_t live = hostLiveBytes += malloc_usable_size(p);
+    size_t peak = hostPeakBytes.load();
+    while (live > peak && !hostPeakBytes.compare_exchange_weak(peak, live))
+    {
+    }
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+static void hostFree(void *p)
+{
+    if (p)
+    {
+        hostLiveBytes -= malloc_usable_size(p);
+        free(p);
+    }
+}
+
+void operator delete(void *p) noexcept
+{
+    hostFree(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    hostFree(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    hostFree(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    hostFree(p);
+}
+
+uint32_t HostEsp::getFreeHeap()
+{
+    size_t live = hostLiveBytes.load();
+    return live < SUPABASE_HOST_HEAP ? SUPABASE_HOST_HEAP - live : 0;
+}
+
+uint32_t HostEsp::getMinFreeHeap()
+{
+    size_t peak = hostPeakBytes.load();
+    return peak < SUPABASE_HOST_HEAP ? SUPABASE_HOST_HEAP - peak : 0;
+}
+
+static const std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - hostStart)
+        .count();
+}
+
+unsigned long micros()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - hostStart)
+        .count();
+}
+
+int64_t esp_timer_get_time()
+{
+    return (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - hostStart)
+        .count();
+}
+
+void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+static std::mt19937 &hostRng()
+{
+    static std::mt19937 rng(1);
+    return rng;
+}
+
+void randomSeed(unsigned long seed)
+{
+    hostRng().seed((std::mt19937::result_type)seed);
+}
+
+long random(long howbig)
+{
+    if (howbig <= 0)
+    {
+        return 0;
+    }
+    return (long)(hostRng()() % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig)
+{
+    if (howsmall >= howbig)
+    {
+        return howsmall;
+    }
+    return howsmall + random(howbig - howsmall);
+}
+
+// String
+
+void String::fromLong(long value, unsigned char base)
+{
+    if (base == 10)
+    {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%ld", value);
+        s = buf;
+        return;
+    }
+    fromULong((unsigned long)value, base);
+}
+
+void String::fromULong(unsigned long value, unsigned char base)
+{
+    char buf[8 * sizeof(unsigned long) + 1];
+    char *p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    if (base < 2)
+    {
+        base = 10;
+    }
+    do
+    {
+        unsigned long digit = value % base;
+        *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+        value /= base;
+    } while (value);
+    s = p;
+}
+
+void String::fromDouble(double value, unsigned int decimals)
+{
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, value);
+    s = buf;
+}
+
+void String::trim()
+{
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+    {
+        s.clear();
+        return;
+    }
+    size_t last = s.find_last_not_of(" \t\r\n");
+    s = s.substr(first, last - first + 1);
+}
+
+// Print / Stream
+
+size_t Print::printf(const char *format, ...)
+{
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0)
+    {
+        return 0;
+    }
+    return write((const uint8_t *)buf, (size_t)len < sizeof(buf) ? (size_t)len : sizeof(buf) - 1);
+}
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = read();
+        if (c >= 0)
+        {
+            return c;
+        }
+        yield();
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+int Stream::timedPeek()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = peek();
+        if (c >= 0)
+        {
+            return c;
+        }
+        yield();
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if (c < 0)
+        {
+            break;
+        }
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+String Stream::readString()
+{
+    String ret;
+    int c = timedRead();
+    while (c >= 0)
+    {
+        ret += (char)c;
+        c = timedRead();
+    }
+    return ret;
+}
+
+bool Stream::findUntil(const char *target, const char *terminator)
+{
+    size_t targetLen = strlen(target);
+    size_t termLen = terminator ? strlen(terminator) : 0;
+    size_t index = 0;
+    size_t termIndex = 0;
+
+    if (targetLen == 0)
+    {
+        return true;
+    }
+    int c;
+    while ((c = timedRead()) > 0)
+    {
+        if (c == target[index])
+        {
+            if (++index >= targetLen)
+            {
+                return true;
+            }
+        }
+        else
+        {
+            index = (c == target[0]) ? 1 : 0;
+        }
+
+        if (termLen > 0 && c == terminator[termIndex])
+        {
+            if (++termIndex >= termLen)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            termIndex = (termLen > 0 && c == terminator[0]) ? 1 : 0;
+        }
+    }
+    return false;
+}
+
+// FreeRTOS tasks
+
+struct HostTask
+{
+    TaskFunction_t fn;
+    void *arg;
+};
+
+static void hostTaskEntry(HostTask task)
+{
+    task.fn(task.arg);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stackDepth,
+                       void *parameters, UBaseType_t priority, TaskHandle_t *createdTask)
+{
+    HostTask t = {task, parameters};
+    std::thread th(hostTaskEntry, t);
+    if (createdTask)
+    {
+        *createdTask = (TaskHandle_t)(uintptr_t)std::hash<std::thread::id>()(th.get_id());
+    }
+    th.detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackDepth,
+                                   void *parameters, UBaseType_t priority, TaskHandle_t *createdTask,
+                                   BaseType_t coreId)
+{
+    return xTaskCreate(task, name, stackDepth, parameters, priority, createdTask);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    // Same value `xTaskCreate()` hands out for the thread
+    return (TaskHandle_t)(uintptr_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // A std::thread ends when its function returns; nothing to do here
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    delay(ticks * portTICK_PERIOD_MS);
+}
+
+// FreeRTOS queues and semaphores
+
+template <typename Pred>
+static bool hostWait(std::condition_variable &cv, std::unique_lock<std::mutex> &guard, TickType_t wait, Pred pred)
+{
+    if (wait == portMAX_DELAY)
+    {
+        cv.wait(guard, pred);
+        return true;
+    }
+    return cv.wait_for(guard, std::chrono::milliseconds(wait * portTICK_PERIOD_MS), pred);
+}
+
+struct HostQueue
+{
+    std::mutex lock;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<std::vector<uint8_t>> items;
+    size_t length;
+    size_t itemSize;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    HostQueue *q = new HostQueue();
+    q->length = length;
+    q->itemSize = itemSize;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    std::unique_lock<std::mutex> guard(q->lock);
+    if (!hostWait(q->notFull, guard, wait, [q]
+                  { return q->items.size() < q->length; }))
+    {
+        return pdFALSE;
+    }
+    const uint8_t *p = (const uint8_t *)item;
+    q->items.push_back(std::vector<uint8_t>(p, p + q->itemSize));
+    q->notEmpty.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *buffer, TickType_t wait)
+{
+    std::unique_lock<std::mutex> guard(q->lock);
+    if (!hostWait(q->notEmpty, guard, wait, [q]
+                  { return !q->items.empty(); }))
+    {
+        return pdFALSE;
+    }
+    memcpy(buffer, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    q->notFull.notify_one();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    std::lock_guard<std::mutex> guard(q->lock);
+    return (UBaseType_t)q->items.size();
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    delete q;
+}
+
+struct HostSemaphore
+{
+    std::mutex lock;
+    std::condition_variable cv;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+    bool recursive;
+    std::thread::id owner;
+    UBaseType_t depth;
+};
+
+static SemaphoreHandle_t hostSemaphore(UBaseType_t maxCount, UBaseType_t initialCount, bool recursive)
+{
+    HostSemaphore *sem = new HostSemaphore();
+    sem->count = initialCount;
+    sem->maxCount = maxCount;
+    sem->recursive = recursive;
+    sem->depth = 0;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return hostSemaphore(1, 1, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
+{
+    return hostSemaphore(1, 1, true);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return hostSemaphore(1, 0, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    return hostSemaphore(maxCount, initialCount, false);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+    std::unique_lock<std::mutex> guard(sem->lock);
+    if (!hostWait(sem->cv, guard, wait, [sem]
+                  { return sem->count > 0; }))
+    {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    std::lock_guard<std::mutex> guard(sem->lock);
+    if (sem->count >= sem->maxCount)
+    {
+        return pdFALSE;
+    }
+    sem->count++;
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t wait)
+{
+    std::unique_lock<std::mutex> guard(sem->lock);
+    std::thread::id self = std::this_thread::get_id();
+    if (sem->depth > 0 && sem->owner == self)
+    {
+        sem->depth++;
+        return pdTRUE;
+    }
+    if (!hostWait(sem->cv, guard, wait, [sem]
+                  { return sem->depth == 0; }))
+    {
+        return pdFALSE;
+    }
+    sem->owner = self;
+    sem->depth = 1;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem)
+{
+    std::lock_guard<std::mutex> guard(sem->lock);
+    if (sem->depth == 0 || sem->owner != std::this_thread::get_id())
+    {
+        return pdFALSE;
+    }
+    if (--sem->depth == 0)
+    {
+        sem->cv.notify_one();
+    }
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    delete sem;
+}
+
+// esp_timer
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    std::mutex lock;
+    std::condition_variable cv;
+    std::thread worker;
+    bool running = false;
+    bool periodic = false;
+    uint64_t period_us = 0;
+};
+
+static void espTimerRun(esp_timer *timer)
+{
+    std::unique_lock<std::mutex> guard(timer->lock);
+    while (timer->running)
+    {
+        if (timer->cv.wait_for(guard, std::chrono::microseconds(timer->period_us),
+                               [timer]
+                               { return !timer->running; }))
+        {
+            break;
+        }
+        guard.unlock();
+        timer->callback(timer->arg);
+        guard.lock();
+        if (!timer->periodic)
+        {
+            timer->running = false;
+        }
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (!create_args || !create_args->callback || !out_handle)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_timer *timer = new esp_timer();
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t espTimerStart(esp_timer_handle_t timer, uint64_t period_us, bool periodic)
+{
+    if (!timer)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> guard(timer->lock);
+    if (timer->running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (timer->worker.joinable())
+    {
+        timer->worker.join();
+    }
+    timer->running = true;
+    timer->periodic = periodic;
+    timer->period_us = period_us;
+    timer->worker = std::thread(espTimerRun, timer);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return espTimerStart(timer, period_us, true);
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return espTimerStart(timer, timeout_us, false);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    {
+        std::lock_guard<std::mutex> guard(timer->lock);
+        timer->running = false;
+    }
+    timer->cv.notify_all();
+    if (timer->worker.joinable() && timer->worker.get_id() != std::this_thread::get_id())
+    {
+        timer->worker.join();
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (!timer)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_timer_stop(timer);
+    if (timer->worker.joinable())
+    {
+        timer->worker.detach();
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+// FS
+
+namespace fs
+{
+
+struct HostFileImpl
+{
+    FILE *fp = nullptr;
+    DIR *dir = nullptr;
+    std::string path;
+    std::string hostPath;
+    std::string name;
+
+    ~HostFileImpl()
+    {
+        if (fp)
+        {
+            fclose(fp);
+        }
+        if (dir)
+        {
+            closedir(dir);
+        }
+    }
+};
+
+size_t File::write(const uint8_t *buf, size_t size)
+{
+    return impl && impl->fp ? fwrite(buf, 1, size, impl->fp) : 0;
+}
+
+int File::available()
+{
+    return impl && impl->fp ? (int)(size() - position()) : 0;
+}
+
+int File::read()
+{
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek()
+{
+    if (!impl || !impl->fp)
+    {
+        return -1;
+    }
+    int c = fgetc(impl->fp);
+    if (c != EOF)
+    {
+        ungetc(c, impl->fp);
+    }
+    return c == EOF ? -1 : c;
+}
+
+void File::flush()
+{
+    if (impl && impl->fp)
+    {
+        fflush(impl->fp);
+    }
+}
+
+size_t File::read(uint8_t *buf, size_t size)
+{
+    return impl && impl->fp ? fread(buf, 1, size, impl->fp) : 0;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode)
+{
+    int whence = mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END;
+    return impl && impl->fp && fseek(impl->fp, pos, whence) == 0;
+}
+
+size_t File::position() const
+{
+    return impl && impl->fp ? (size_t)ftell(impl->fp) : 0;
+}
+
+size_t File::size() const
+{
+    if (!impl || !impl->fp)
+    {
+        return 0;
+    }
+    fflush(impl->fp);
+    struct stat st;
+    return fstat(fileno(impl->fp), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::close()
+{
+    impl.reset();
+}
+
+File::operator bool() const
+{
+    return impl && (impl->fp || impl->dir);
+}
+
+const char *File::name() const
+{
+    return impl ? impl->name.c_str() : "";
+}
+
+const char *File::path() const
+{
+    return impl ? impl->path.c_str() : "";
+}
+
+bool File::isDirectory() const
+{
+    return impl && impl->dir;
+}
+
+static File hostOpen(const std::string &path, const std::string &hostPath, const char *mode)
+{
+    std::shared_ptr<HostFileImpl> impl(new HostFileImpl());
+    impl->path = path;
+    impl->hostPath = hostPath;
+    size_t slash = path.rfind('/');
+    impl->name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    struct stat st;
+    if (stat(hostPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        impl->dir = opendir(hostPath.c_str());
+        return impl->dir ? File(impl) : File();
+    }
+    std::string m = mode;
+    m += "b";
+    impl->fp = fopen(hostPath.c_str(), m.c_str());
+    return impl->fp ? File(impl) : File();
+}
+
+File File::openNextFile(const char *mode)
+{
+    if (!impl || !impl->dir)
+    {
+        return File();
+    }
+    struct dirent *entry;
+    while ((entry = readdir(impl->dir)) != nullptr)
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string parent = impl->path == "/" ? "" : impl->path;
+        return hostOpen(parent + "/" + name, impl->hostPath + "/" + name, mode);
+    }
+    return File();
+}
+
+std::string FS::resolve(const char *path) const
+{
+    return root + (path[0] == '/' ? "" : "/") + path;
+}
+
+File FS::open(const char *path, const char *mode, bool create)
+{
+    if (create)
+    {
+        // Create the missing parent directories, as LittleFS does
+        std::string p = path;
+        for (size_t at = p.find('/', 1); at != std::string::npos; at = p.find('/', at + 1))
+        {
+            ::mkdir(resolve(p.substr(0, at).c_str()).c_str(), 0755);
+        }
+    }
+    return hostOpen(path, resolve(path), mode);
+}
+
+bool FS::exists(const char *path)
+{
+    struct stat st;
+    return stat(resolve(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path)
+{
+    return ::unlink(resolve(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to)
+{
+    return ::rename(resolve(from).c_str(), resolve(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path)
+{
+    return ::mkdir(resolve(path).c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+bool FS::rmdir(const char *path)
+{
+    return ::rmdir(resolve(path).c_str()) == 0;
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles, const char *partitionLabel)
+{
+    return ::mkdir(root.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+static void hostRemoveTree(const std::string &dir)
+{
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+    {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(d)) != nullptr)
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string path = dir + "/" + name;
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+        {
+            hostRemoveTree(path);
+            ::rmdir(path.c_str());
+        }
+        else
+        {
+            ::unlink(path.c_str());
+        }
+    }
+    closedir(d);
+}
+
+bool LittleFSFS::format()
+{
+    hostRemoveTree(root);
+    return begin();
+}
+
+} // namespace fs
+
+#endif
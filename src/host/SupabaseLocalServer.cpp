@@ -0,0 +1,1279 @@
+/**
+ * In-process PostgREST / GoTrue / Phoenix stand-in for the host-native build.
+ * Compiled to nothing unless `SUPABASE_HOST` is defined.
+ */
+
+#if defined(SUPABASE_HOST)
+
+#include "SupabaseLocalServer.h"
+#include "../SupabaseGzip.h"
+
+#include <algorithm>
+
+namespace
+{
+
+    struct QueryParam
+    {
+        String name;
+        String value;
+    };
+
+    std::vector<QueryParam> splitQuery(const String &query)
+    {
+        std::vector<QueryParam> params;
+        unsigned int start = 0;
+        while (start < query.length())
+        {
+            int amp = query.indexOf('&', start);
+            unsigned int stop = amp < 0 ? query.length() : (unsigned int)amp;
+            String part = query.substring(start, stop);
+            int eq = part.indexOf('=');
+            if (part.length() > 0)
+            {
+                QueryParam p;
+                p.name = eq < 0 ? part : part.substring(0, eq);
+                p.value = eq < 0 ? String() : part.substring(eq + 1);
+                params.push_back(p);
+            }
+            start = stop + 1;
+        }
+        return params;
+    }
+
+    /** Compare a stored value with a filter operand: <0, 0, >0 */
+    int compareValue(JsonVariantConst v, const String &operand)
+    {
+        if (v.is<double>() || v.is<long>())
+        {
+            double a = v.as<double>();
+            double b = operand.toDouble();
+            return a < b ? -1 : (a > b ? 1 : 0);
+        }
+        if (v.is<bool>())
+        {
+            return (v.as<bool>() ? String("true") : String("false")) == operand ? 0 : 1;
+        }
+        String a = v.as<String>();
+        return strcmp(a.c_str(), operand.c_str());
+    }
+
+    /** Evaluate one PostgREST filter (`op.value`) against a row */
+    bool matches(JsonObjectConst row, const String &column, const String &filter)
+    {
+        int dot = filter.indexOf('.');
+        if (dot < 0)
+        {
+            return true;
+        }
+        String op = filter.substring(0, dot);
+        String operand = filter.substring(dot + 1);
+        JsonVariantConst v = row[column];
+
+        if (op == "is")
+        {
+            if (operand == "null")
+                return v.isNull();
+            if (operand == "true")
+                return v.is<bool>() && v.as<bool>();
+            if (operand == "false")
+                return v.is<bool>() && !v.as<bool>();
+            return false;
+        }
+        if (op == "in")
+        {
+            if (v.isNull())
+                return false;
+            String list = operand;
+            if (list.startsWith("("))
+                list = list.substring(1, list.length() - 1);
+            unsigned int start = 0;
+            while (start <= list.length())
+            {
+                int comma = list.indexOf(',', start);
+                unsigned int stop = comma < 0 ? list.length() : (unsigned int)comma;
+                String item = list.substring(start, stop);
+                item.trim();
+                if (item.startsWith("\"") && item.endsWith("\""))
+                    item = item.substring(1, item.length() - 1);
+                if (compareValue(v, item) == 0)
+                    return true;
+                start = stop + 1;
+            }
+            return false;
+        }
+        if (v.isNull())
+        {
+            return false;
+        }
+        int c = compareValue(v, operand);
+        if (op == "eq")
+            return c == 0;
+        if (op == "neq")
+            return c != 0;
+        if (op == "gt")
+            return c > 0;
+        if (op == "gte")
+            return c >= 0;
+        if (op == "lt")
+            return c < 0;
+        if (op == "lte")
+            return c <= 0;
+        // Range and array operators are accepted but not evaluated
+        return true;
+    }
+
+    bool isReserved(const String &name)
+    {
+        return name == "select" || name == "order" || name == "limit" || name == "offset" ||
+               name == "on_conflict" || name == "columns";
+    }
+
+    void copyProjected(JsonObject dst, JsonObjectConst src, const String &select)
+    {
+        if (select.length() == 0 || select == "*" || select.indexOf('(') >= 0)
+        {
+            dst.set(src);
+            return;
+        }
+        unsigned int start = 0;
+        while (start < select.length())
+        {
+            int comma = select.indexOf(',', start);
+            unsigned int stop = comma < 0 ? select.length() : (unsigned int)comma;
+            String column = select.substring(start, stop);
+            column.trim();
+            if (column.length() > 0 && !src[column].isUnbound())
+            {
+                dst[column] = src[column];
+            }
+            start = stop + 1;
+        }
+    }
+
+    /** One CSV field starting at `pos`, which is left after its separator.
+     * `quoted` fields may hold separators, newlines and doubled quotes */
+    String csvField(const String &csv, unsigned int &pos, bool &quoted, bool &lineEnd)
+    {
+        String field;
+        quoted = pos < csv.length() && csv[pos] == '"';
+        if (quoted)
+        {
+            pos++;
+            while (pos < csv.length())
+            {
+                if (csv[pos] == '"')
+                {
+                    if (pos + 1 < csv.length() && csv[pos + 1] == '"')
+                    {
+                        field += '"';
+                        pos += 2;
+                        continue;
+                    }
+                    pos++;
+                    break;
+                }
+                field += csv[pos++];
+            }
+        }
+        while (pos < csv.length() && csv[pos] != ',' && csv[pos] != '\n')
+        {
+            if (csv[pos] != '\r')
+            {
+                field += csv[pos];
+            }
+            pos++;
+        }
+        lineEnd = pos >= csv.length() || csv[pos] == '\n';
+        pos++;
+        return field;
+    }
+
+    /** Rows of a `text/csv` body, the first line naming the columns. Like
+     * Postgres casting the text to the column types: numbers become
+     * numbers and an empty unquoted field is null */
+    bool parseCsv(const String &csv, JsonArray out)
+    {
+        std::vector<String> columns;
+        unsigned int pos = 0;
+        bool quoted, lineEnd = false;
+        while (!lineEnd)
+        {
+            columns.push_back(csvField(csv, pos, quoted, lineEnd));
+        }
+        if (columns.size() == 1 && columns[0].length() == 0)
+        {
+            return false;
+        }
+        while (pos < csv.length())
+        {
+            JsonObject row = out.add<JsonObject>();
+            size_t column = 0;
+            lineEnd = false;
+            while (!lineEnd)
+            {
+                String value = csvField(csv, pos, quoted, lineEnd);
+                if (column >= columns.size())
+                {
+                    return false;
+                }
+                char *end;
+                double number = strtod(value.c_str(), &end);
+                if (!quoted && value.length() == 0)
+                {
+                    row[columns[column]] = nullptr;
+                }
+                else if (!quoted && *end == '\0')
+                {
+                    if (number == (long)number)
+                        row[columns[column]] = (long)number;
+                    else
+                        row[columns[column]] = number;
+                }
+                else
+                {
+                    row[columns[column]] = value;
+                }
+                column++;
+            }
+            if (column != columns.size())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace
+
+SupabaseLocalServer::SupabaseLocalServer()
+{
+    reset();
+}
+
+SupabaseLocalServer &SupabaseLocalServer::instance()
+{
+    static SupabaseLocalServer server;
+    return server;
+}
+
+void SupabaseLocalServer::reset()
+{
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    db.clear();
+    db.to<JsonObject>();
+    users.clear();
+    tokens.clear();
+    refreshTokens.clear();
+    refreshes = 0;
+    rpcs.clear();
+    joins.clear();
+    members.clear();
+    requests = 0;
+    nextId = 1;
+}
+
+JsonArray SupabaseLocalServer::table(const String &name)
+{
+    JsonArray rows = db[name].as<JsonArray>();
+    if (rows.isNull())
+    {
+        rows = db[name].to<JsonArray>();
+    }
+    return rows;
+}
+
+void SupabaseLocalServer::seed(const String &name, const String &json)
+{
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    JsonDocument in;
+    if (deserializeJson(in, json))
+    {
+        return;
+    }
+    JsonArray rows = table(name);
+    JsonDocument out;
+    JsonArray inserted = out.to<JsonArray>();
+    if (in.is<JsonArray>())
+    {
+        for (JsonObjectConst row : in.as<JsonArrayConst>())
+        {
+            insertRow(name, rows, row, String(), inserted);
+        }
+    }
+    else
+    {
+        insertRow(name, rows, in.as<JsonObjectConst>(), String(), inserted);
+    }
+}
+
+size_t SupabaseLocalServer::rowCount(const String &name)
+{
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    return db[name].as<JsonArrayConst>().size();
+}
+
+void SupabaseLocalServer::addUser(const String &login, const String &password)
+{
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    users.push_back(std::make_pair(login, password));
+}
+
+void SupabaseLocalServer::setRpc(const String &name, SupabaseLocalRpc fn)
+{
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    rpcs.push_back(std::make_pair(name, fn));
+}
+
+void SupabaseLocalServer::setLatency(unsigned long requestUs)
+{
+    latencyUs = requestUs;
+}
+
+void SupabaseLocalServer::setHandshakeLatency(unsigned long fullUs, unsigned long resumedUs)
+{
+    handshakeUs = fullUs;
+    resumeUs = resumedUs;
+}
+
+void SupabaseLocalServer::setKeepAliveTimeout(unsigned long ms)
+{
+    keepAliveMs = ms;
+}
+
+void SupabaseLocalServer::dropSockets()
+{
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    for (size_t i = 0; i < sockets.size(); i++)
+    {
+        sockets[i]->serverClose();
+    }
+    sockets.clear();
+    joins.clear();
+    members.clear();
+}
+
+String SupabaseLocalServer::header(const SupabaseLocalHeaders &headers, const char *name)
+{
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+        if (strcasecmp(headers[i].first.c_str(), name) == 0)
+        {
+            return headers[i].second;
+        }
+    }
+    return String();
+}
+
+String SupabaseLocalServer::urlDecode(const String &s)
+{
+    String out;
+    out.reserve(s.length());
+    for (unsigned int i = 0; i < s.length(); i++)
+    {
+        char c = s[i];
+        if (c == '%' && i + 2 < s.length())
+        {
+            char hex[3] = {s[i + 1], s[i + 2], 0};
+            out += (char)strtol(hex, NULL, 16);
+            i += 2;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+
+bool SupabaseLocalServer::authorized(const SupabaseLocalHeaders &headers)
+{
+    String auth = header(headers, "Authorization");
+    if (auth.length() == 0)
+    {
+        return true;
+    }
+    String token = auth.startsWith("Bearer ") ? auth.substring(7) : auth;
+    for (size_t i = 0; i < tokens.size(); i++)
+    {
+        if (tokens[i].first == token)
+        {
+            return (long)(millis() - tokens[i].second) < 0;
+        }
+    }
+    return false;
+}
+
+SupabaseLocalResponse SupabaseLocalServer::handle(const char *method, const String &url,
+                                                  const SupabaseLocalHeaders &headers, const String &body)
+{
+    SupabaseLocalResponse res;
+    if (header(headers, "Content-Encoding").indexOf("gzip") >= 0)
+    {
+        SupabaseStringStream compressed(body);
+        SupabaseInflateStream inflater;
+        String plain;
+        if (inflater.begin(&compressed))
+        {
+            int c;
+            while ((c = inflater.read()) >= 0)
+            {
+                plain += (char)c;
+            }
+        }
+        if (inflater.produced() == 0 || inflater.failed())
+        {
+            res.code = 400;
+            res.body = "{\"message\":\"Invalid gzip body\"}";
+            return res;
+        }
+        res = dispatch(method, url, headers, plain);
+    }
+    else
+    {
+        res = dispatch(method, url, headers, body);
+    }
+
+    // Like a gateway in front of PostgREST: compress what is worth it
+    if (header(headers, "Accept-Encoding").indexOf("gzip") >= 0 && res.body.length() >= 128)
+    {
+        std::vector<uint8_t> out(res.body.length());
+        size_t n = supabaseGzip((const uint8_t *)res.body.c_str(), res.body.length(), out.data(), out.size());
+        if (n)
+        {
+            res.body = String((const char *)out.data(), n);
+            res.headers.push_back(std::make_pair(String("Content-Encoding"), String("gzip")));
+        }
+    }
+    return res;
+}
+
+SupabaseLocalResponse SupabaseLocalServer::dispatch(const char *method, const String &url,
+                                                    const SupabaseLocalHeaders &headers, const String &body)
+{
+    if (latencyUs)
+    {
+        delayMicroseconds(latencyUs);
+    }
+
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    requests++;
+
+    int q = url.indexOf('?');
+    String path = q < 0 ? url : url.substring(0, q);
+    String query = q < 0 ? String() : url.substring(q + 1);
+
+    SupabaseLocalResponse res;
+    if (header(headers, "apikey").length() == 0)
+    {
+        res.code = 401;
+        res.body = "{\"message\":\"No API key found in request\"}";
+        return res;
+    }
+
+    int at;
+    if ((at = path.indexOf("/auth/v1/")) >= 0)
+    {
+        return handleAuth(path.substring(at + 9), query, body);
+    }
+    if (!authorized(headers))
+    {
+        res.code = 401;
+        res.body = "{\"code\":\"PGRST301\",\"message\":\"JWT expired\"}";
+        return res;
+    }
+    if ((at = path.indexOf("/rest/v1/rpc/")) >= 0)
+    {
+        return handleRpc(path.substring(at + 13), body);
+    }
+    if ((at = path.indexOf("/rpc/")) >= 0)
+    {
+        return handleRpc(path.substring(at + 5), body);
+    }
+    if ((at = path.indexOf("/rest/v1/")) >= 0)
+    {
+        return handleRest(method, path.substring(at + 9), query, headers, body);
+    }
+
+    res.code = 404;
+    return res;
+}
+
+SupabaseLocalResponse SupabaseLocalServer::handleAuth(const String &path, const String &query, const String &body)
+{
+    SupabaseLocalResponse res;
+    if (path != "token")
+    {
+        res.code = 404;
+        return res;
+    }
+
+    JsonDocument in;
+    if (deserializeJson(in, body))
+    {
+        res.code = 400;
+        res.body = "{\"error\":\"invalid_request\"}";
+        return res;
+    }
+
+    if (query.indexOf("grant_type=password") >= 0)
+    {
+        String login = in["email"].is<const char *>() ? in["email"].as<String>() : in["phone"].as<String>();
+        String password = in["password"].as<String>();
+        bool ok = users.empty();
+        for (size_t i = 0; i < users.size(); i++)
+        {
+            if (users[i].first == login && users[i].second == password)
+            {
+                ok = true;
+            }
+        }
+        if (!ok)
+        {
+            res.code = 400;
+            res.body = "{\"error\":\"invalid_grant\",\"error_description\":\"Invalid login credentials\"}";
+            return res;
+        }
+    }
+    else if (query.indexOf("grant_type=refresh_token") >= 0)
+    {
+        // Refresh tokens are single use: the response carries the next one
+        String presented = in["refresh_token"].as<String>();
+        std::vector<String>::iterator used = std::find(refreshTokens.begin(), refreshTokens.end(), presented);
+        if (used == refreshTokens.end())
+        {
+            res.code = 400;
+            res.body = "{\"error\":\"invalid_grant\",\"error_description\":\"Invalid Refresh Token\"}";
+            return res;
+        }
+        refreshTokens.erase(used);
+        refreshes++;
+    }
+    else
+    {
+        res.code = 400;
+        res.body = "{\"error\":\"unsupported_grant_type\"}";
+        return res;
+    }
+
+    String token = "local-access-" + String(++tokenSerial);
+    tokens.push_back(std::make_pair(token, millis() + tokenLifetime * 1000UL));
+    String refresh = "local-refresh-" + String(tokenSerial);
+    refreshTokens.push_back(refresh);
+
+    JsonDocument out;
+    out["access_token"] = token;
+    out["token_type"] = "bearer";
+    out["expires_in"] = tokenLifetime;
+    out["refresh_token"] = refresh;
+    res.code = 200;
+    serializeJson(out, res.body);
+    return res;
+}
+
+SupabaseLocalResponse SupabaseLocalServer::handleRpc(const String &name, const String &body)
+{
+    SupabaseLocalResponse res;
+    for (size_t i = 0; i < rpcs.size(); i++)
+    {
+        if (rpcs[i].first == name)
+        {
+            res.code = 200;
+            res.body = rpcs[i].second(body);
+            return res;
+        }
+    }
+    res.code = 404;
+    res.body = "{\"code\":\"PGRST202\",\"message\":\"Could not find the function\"}";
+    return res;
+}
+
+void SupabaseLocalServer::insertRow(const String &name, JsonArray rows, JsonObjectConst row, const String &conflict,
+                                    JsonArray out)
+{
+    // `conflict` lists the unique columns (`on_conflict`), empty = plain insert
+    bool keyed = conflict.length() > 0;
+    for (int start = 0; keyed && start < (int)conflict.length();)
+    {
+        int comma = conflict.indexOf(',', start);
+        int end = comma < 0 ? conflict.length() : comma;
+        keyed = !row[conflict.substring(start, end).c_str()].isNull();
+        start = end + 1;
+    }
+    if (keyed)
+    {
+        for (JsonObject existing : rows)
+        {
+            bool same = true;
+            for (int start = 0; same && start < (int)conflict.length();)
+            {
+                int comma = conflict.indexOf(',', start);
+                int end = comma < 0 ? conflict.length() : comma;
+                String column = conflict.substring(start, end);
+                same = existing[column.c_str()] == row[column.c_str()];
+                start = end + 1;
+            }
+            if (same)
+            {
+                JsonDocument old;
+                old.set(existing);
+                for (JsonPairConst kv : row)
+                {
+                    existing[kv.key()] = kv.value();
+                }
+                out.add(existing);
+                notify(name, "UPDATE", existing, old.as<JsonObjectConst>());
+                return;
+            }
+        }
+    }
+
+    JsonObject added = rows.add<JsonObject>();
+    added.set(row);
+    if (added["id"].isNull())
+    {
+        added["id"] = nextId++;
+    }
+    out.add(added);
+    notify(name, "INSERT", added, JsonObjectConst());
+}
+
+SupabaseLocalResponse SupabaseLocalServer::handleRest(const char *method, const String &name, const String &query,
+                                                      const SupabaseLocalHeaders &headers, const String &body)
+{
+    SupabaseLocalResponse res;
+    std::vector<QueryParam> params = splitQuery(query);
+    for (size_t i = 0; i < params.size(); i++)
+    {
+        params[i].value = urlDecode(params[i].value);
+    }
+
+    String prefer = header(headers, "Prefer");
+    bool representation = prefer.indexOf("return=representation") >= 0;
+    // Any count mode is answered exactly, the table is in memory anyway
+    bool counted = prefer.indexOf("count=") >= 0;
+    JsonArray rows = table(name);
+
+    JsonDocument out;
+    JsonArray result = out.to<JsonArray>();
+
+    if (strcmp(method, "POST") == 0)
+    {
+        JsonDocument in;
+        if (header(headers, "Content-Type").startsWith("text/csv"))
+        {
+            if (!parseCsv(body, in.to<JsonArray>()))
+            {
+                res.code = 400;
+                res.body = "{\"code\":\"22P04\",\"message\":\"Invalid CSV\"}";
+                return res;
+            }
+        }
+        else if (deserializeJson(in, body))
+        {
+            res.code = 400;
+            res.body = "{\"code\":\"PGRST102\",\"message\":\"Empty or invalid json\"}";
+            return res;
+        }
+        String conflict;
+        if (prefer.indexOf("resolution=merge-duplicates") >= 0)
+        {
+            conflict = "id";
+            for (size_t p = 0; p < params.size(); p++)
+            {
+                if (params[p].name == "on_conflict")
+                {
+                    conflict = params[p].value;
+                }
+            }
+        }
+        if (in.is<JsonArray>())
+        {
+            for (JsonObjectConst row : in.as<JsonArrayConst>())
+            {
+                insertRow(name, rows, row, conflict, result);
+            }
+        }
+        else
+        {
+            insertRow(name, rows, in.as<JsonObjectConst>(), conflict, result);
+        }
+        res.code = 201;
+        if (counted)
+        {
+            res.headers.push_back(std::make_pair(String("Content-Range"), "*/" + String((unsigned long)result.size())));
+        }
+        if (representation)
+        {
+            serializeJson(out, res.body);
+        }
+        return res;
+    }
+
+    // Collect the matching rows
+    std::vector<size_t> hits;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        JsonObjectConst row = rows[i];
+        bool ok = true;
+        for (size_t p = 0; p < params.size() && ok; p++)
+        {
+            if (!isReserved(params[p].name))
+            {
+                ok = matches(row, params[p].name, params[p].value);
+            }
+        }
+        if (ok)
+        {
+            hits.push_back(i);
+        }
+    }
+
+    if (strcmp(method, "PATCH") == 0)
+    {
+        JsonDocument in;
+        if (deserializeJson(in, body) || !in.is<JsonObject>())
+        {
+            res.code = 400;
+            res.body = "{\"code\":\"PGRST102\",\"message\":\"Empty or invalid json\"}";
+            return res;
+        }
+        for (size_t i = 0; i < hits.size(); i++)
+        {
+            JsonObject row = rows[hits[i]];
+            JsonDocument old;
+            old.set(row);
+            for (JsonPairConst kv : in.as<JsonObjectConst>())
+            {
+                row[kv.key()] = kv.value();
+            }
+            result.add(row);
+            notify(name, "UPDATE", row, old.as<JsonObjectConst>());
+        }
+        res.code = representation ? 200 : 204;
+        if (counted)
+        {
+            res.headers.push_back(std::make_pair(String("Content-Range"), "*/" + String((unsigned long)hits.size())));
+        }
+        if (representation)
+        {
+            serializeJson(out, res.body);
+        }
+        return res;
+    }
+
+    if (strcmp(method, "DELETE") == 0)
+    {
+        for (size_t i = hits.size(); i-- > 0;)
+        {
+            JsonDocument old;
+            old.set(rows[hits[i]]);
+            result.add(old.as<JsonObjectConst>());
+            rows.remove(hits[i]);
+            notify(name, "DELETE", JsonObjectConst(), old.as<JsonObjectConst>());
+        }
+        res.code = representation ? 200 : 204;
+        if (representation)
+        {
+            serializeJson(out, res.body);
+        }
+        return res;
+    }
+
+    if (strcmp(method, "GET") != 0)
+    {
+        res.code = 405;
+        return res;
+    }
+
+    String select = "*";
+    long limit = -1;
+    long offset = 0;
+    for (size_t p = 0; p < params.size(); p++)
+    {
+        if (params[p].name == "select")
+        {
+            select = params[p].value;
+        }
+        else if (params[p].name == "limit")
+        {
+            limit = params[p].value.toInt();
+        }
+        else if (params[p].name == "offset")
+        {
+            offset = params[p].value.toInt();
+        }
+        else if (params[p].name == "order")
+        {
+            // column.asc|desc[.nullsfirst|.nullslast]
+            String spec = params[p].value;
+            int dot = spec.indexOf('.');
+            String column = dot < 0 ? spec : spec.substring(0, dot);
+            bool desc = spec.indexOf(".desc") >= 0;
+            std::stable_sort(hits.begin(), hits.end(), [&](size_t a, size_t b)
+                             {
+                JsonVariantConst va = rows[a][column];
+                JsonVariantConst vb = rows[b][column];
+                int c = compareValue(va, vb.as<String>());
+                return desc ? c > 0 : c < 0; });
+        }
+    }
+
+    for (size_t i = (size_t)offset; i < hits.size(); i++)
+    {
+        if (limit >= 0 && (long)(i - offset) >= limit)
+        {
+            break;
+        }
+        copyProjected(result.add<JsonObject>(), rows[hits[i]], select);
+    }
+    res.code = 200;
+    serializeJson(out, res.body);
+
+    // `first-last/total`, PostgREST sends it on every read
+    String range = result.size() ? String(offset) + "-" + String(offset + (long)result.size() - 1) : String("*");
+    range += counted ? "/" + String((unsigned long)hits.size()) : String("/*");
+    res.headers.push_back(std::make_pair(String("Content-Range"), range));
+
+    // Weak validator over the body, as an HTTP cache in front of PostgREST would add
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < res.body.length(); i++)
+    {
+        hash = (hash ^ (uint8_t)res.body[i]) * 16777619u;
+    }
+    char etag[16];
+    snprintf(etag, sizeof(etag), "W/\"%08lx\"", (unsigned long)hash);
+    res.headers.push_back(std::make_pair(String("ETag"), String(etag)));
+    if (header(headers, "If-None-Match") == etag)
+    {
+        res.code = 304;
+        res.body = String();
+    }
+    return res;
+}
+
+// Realtime
+
+void SupabaseLocalServer::attach(SupabaseLocalSocket *socket)
+{
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    if (std::find(sockets.begin(), sockets.end(), socket) == sockets.end())
+    {
+        sockets.push_back(socket);
+    }
+}
+
+void SupabaseLocalServer::detach(SupabaseLocalSocket *socket)
+{
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    sockets.erase(std::remove(sockets.begin(), sockets.end(), socket), sockets.end());
+    for (size_t i = joins.size(); i-- > 0;)
+    {
+        if (joins[i].socket == socket)
+        {
+            joins.erase(joins.begin() + i);
+        }
+    }
+    for (size_t i = members.size(); i-- > 0;)
+    {
+        if (members[i].socket == socket)
+        {
+            members.erase(members.begin() + i);
+        }
+    }
+}
+
+void SupabaseLocalServer::handleSocketText(SupabaseLocalSocket *socket, const String &text)
+{
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    JsonDocument in;
+    if (realtimeStalled || deserializeJson(in, text))
+    {
+        return;
+    }
+    String event = in["event"].as<String>();
+    String topic = in["topic"].as<String>();
+
+    JsonDocument reply;
+    reply["event"] = "phx_reply";
+    reply["topic"] = topic;
+    reply["ref"] = in["ref"];
+    reply["payload"]["status"] = "ok";
+    JsonObject response = reply["payload"]["response"].to<JsonObject>();
+
+    if (event == "phx_join")
+    {
+        Member member;
+        member.socket = socket;
+        member.topic = topic;
+        member.self = in["payload"]["config"]["broadcast"]["self"] | false;
+        member.ack = in["payload"]["config"]["broadcast"]["ack"] | false;
+        members.push_back(member);
+
+        JsonArrayConst changes = in["payload"]["config"]["postgres_changes"];
+        JsonArray accepted = response["postgres_changes"].to<JsonArray>();
+        for (JsonObjectConst change : changes)
+        {
+            Join join;
+            join.socket = socket;
+            join.topic = topic;
+            join.event = change["event"] | "*";
+            join.table = change["table"].as<String>();
+            String filter = change["filter"].as<String>();
+            int eq = filter.indexOf("=eq.");
+            if (eq > 0)
+            {
+                join.filterColumn = filter.substring(0, eq);
+                join.filterValue = filter.substring(eq + 4);
+            }
+            joins.push_back(join);
+
+            JsonObject a = accepted.add<JsonObject>();
+            a.set(change);
+            a["id"] = (long)joins.size();
+        }
+    }
+    else if (event == "phx_leave")
+    {
+        for (size_t i = joins.size(); i-- > 0;)
+        {
+            if (joins[i].socket == socket && joins[i].topic == topic)
+            {
+                joins.erase(joins.begin() + i);
+            }
+        }
+        for (size_t i = members.size(); i-- > 0;)
+        {
+            if (members[i].socket == socket && members[i].topic == topic)
+            {
+                members.erase(members.begin() + i);
+            }
+        }
+    }
+    else if (event == "broadcast")
+    {
+        // Only from a member of the topic, to every member (the sender too
+        // if it asked for `self`). Answered only with `ack`
+        const Member *sender = nullptr;
+        for (size_t i = 0; i < members.size(); i++)
+        {
+            if (members[i].socket == socket && members[i].topic == topic)
+            {
+                sender = &members[i];
+            }
+        }
+        if (sender == nullptr)
+        {
+            reply["payload"]["status"] = "error";
+            response["reason"] = "not joined";
+        }
+        else
+        {
+            JsonDocument msg;
+            msg["event"] = "broadcast";
+            msg["topic"] = topic;
+            msg["payload"] = in["payload"];
+            msg["ref"] = nullptr;
+            String out;
+            serializeJson(msg, out);
+            for (size_t i = 0; i < members.size(); i++)
+            {
+                if (members[i].topic == topic && (members[i].socket != socket || sender->self))
+                {
+                    members[i].socket->push(out);
+                }
+            }
+            if (!sender->ack)
+            {
+                return;
+            }
+        }
+    }
+    else if (event != "heartbeat" && event != "access_token")
+    {
+        return;
+    }
+
+    String frame;
+    serializeJson(reply, frame);
+    socket->push(frame);
+}
+
+void SupabaseLocalServer::notify(const String &name, const char *type, JsonObjectConst record, JsonObjectConst oldRecord)
+{
+    if (realtimeStalled)
+    {
+        return;
+    }
+    for (size_t i = 0; i < joins.size(); i++)
+    {
+        const Join &join = joins[i];
+        if (join.table != name || (join.event != "*" && join.event != type))
+        {
+            continue;
+        }
+        if (join.filterColumn.length() > 0)
+        {
+            JsonObjectConst subject = record.isNull() ? oldRecord : record;
+            if (subject[join.filterColumn].isNull() || subject[join.filterColumn].as<String>() != join.filterValue)
+            {
+                continue;
+            }
+        }
+
+        JsonDocument msg;
+        msg["event"] = "postgres_changes";
+        msg["topic"] = join.topic;
+        msg["ref"] = nullptr;
+        JsonObject data = msg["payload"]["data"].to<JsonObject>();
+        data["schema"] = "public";
+        data["table"] = name;
+        data["type"] = type;
+        data["commit_timestamp"] = "1970-01-01T00:00:00Z";
+        data["errors"] = nullptr;
+        if (!record.isNull())
+        {
+            data["record"] = record;
+        }
+        if (!oldRecord.isNull())
+        {
+            data["old_record"] = oldRecord;
+        }
+        msg["payload"]["ids"].add((long)(i + 1));
+
+        String frame;
+        serializeJson(msg, frame);
+        join.socket->push(frame);
+    }
+}
+
+// SupabaseLocalHttp
+
+void SupabaseLocalHttp::saveState(SupabaseTransportState &state)
+{
+    memset(&state, 0, sizeof(state));
+    if (session)
+    {
+        memcpy(state.session, &session, sizeof(session));
+        state.sessionLength = sizeof(session);
+    }
+}
+
+void SupabaseLocalHttp::restoreState(const SupabaseTransportState &state)
+{
+    if (state.sessionLength == sizeof(session))
+    {
+        memcpy(&session, state.session, sizeof(session));
+    }
+}
+
+bool SupabaseLocalHttp::begin(const String &u)
+{
+    url = u;
+    headers.clear();
+    body.reset(nullptr);
+    response = SupabaseLocalResponse();
+    startTiming();
+    return url.length() > 0;
+}
+
+void SupabaseLocalHttp::addHeader(const String &name, const String &value)
+{
+    headers.push_back(std::make_pair(name, value));
+}
+
+void SupabaseLocalHttp::connect()
+{
+    unsigned long now = millis();
+    bool idle = idleTimeout > 0 && now - lastUse > idleTimeout;
+    bool expired = server->keepAliveMs > 0 && now - lastUse > server->keepAliveMs;
+    if (open && (idle || expired))
+    {
+        open = false;
+        connStats.drops++;
+    }
+
+    connStats.requests++;
+    if (open)
+    {
+        connStats.reused++;
+        return;
+    }
+
+    // No name lookup here: only the handshake is simulated
+    connStats.handshakes++;
+    if (session == server->sessionEpoch)
+    {
+        connStats.resumed++;
+        if (server->resumeUs)
+        {
+            delayMicroseconds(server->resumeUs);
+        }
+    }
+    else if (server->handshakeUs)
+    {
+        delayMicroseconds(server->handshakeUs);
+    }
+    session = server->sessionEpoch;
+    open = true;
+    lap(lastTiming.connectUs);
+}
+
+int SupabaseLocalHttp::sendRequest(const char *method, const uint8_t *body, size_t size)
+{
+    phaseStart = micros();
+    connect();
+    response = server->handle(method, url, headers, String((const char *)body, size));
+    lap(lastTiming.requestUs);
+    connStats.bytesSent += size;
+    connStats.bytesReceived += response.body.length();
+    lastUse = millis();
+    return response.code;
+}
+
+String SupabaseLocalHttp::getString()
+{
+    return response.body;
+}
+
+Stream *SupabaseLocalHttp::getStream()
+{
+    body.reset(&response.body);
+    return &body;
+}
+
+void SupabaseLocalHttp::end()
+{
+    lap(lastTiming.responseUs);
+    headers.clear();
+}
+
+void SupabaseLocalHttp::stop()
+{
+    open = false;
+}
+
+// SupabaseLocalSocket
+
+SupabaseLocalSocket::~SupabaseLocalSocket()
+{
+    server->detach(this);
+}
+
+void SupabaseLocalSocket::begin(const String &host, int port, const String &path)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    inbox.clear();
+    pendingConnect = true;
+    pendingClose = false;
+}
+
+void SupabaseLocalSocket::onEvent(SupabaseSocketHandler h, void *ctx)
+{
+    handler = h;
+    handlerCtx = ctx;
+}
+
+bool SupabaseLocalSocket::sendTXT(const String &payload)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!connected)
+        {
+            return false;
+        }
+    }
+    server->handleSocketText(this, payload);
+    return true;
+}
+
+void SupabaseLocalSocket::push(const String &frame)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    inbox.push_back(frame);
+}
+
+void SupabaseLocalSocket::serverClose()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    pendingClose = true;
+}
+
+void SupabaseLocalSocket::loop()
+{
+    bool connecting = false;
+    bool closing = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closing = pendingClose && connected;
+        if (closing)
+        {
+            pendingClose = false;
+            connected = false;
+            inbox.clear();
+        }
+    }
+    if (closing)
+    {
+        if (handler)
+        {
+            handler(handlerCtx, SUPABASE_SOCKET_DISCONNECTED, NULL, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        connecting = pendingConnect;
+        pendingConnect = false;
+        if (connecting)
+        {
+            connected = true;
+        }
+    }
+    if (connecting)
+    {
+        server->attach(this);
+        if (handler)
+        {
+            handler(handlerCtx, SUPABASE_SOCKET_CONNECTED, (uint8_t *)"/realtime/v1/websocket", 22);
+        }
+    }
+
+    while (true)
+    {
+        String frame;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (inbox.empty())
+            {
+                break;
+            }
+            frame = inbox.front();
+            inbox.pop_front();
+        }
+        if (handler)
+        {
+            handler(handlerCtx, SUPABASE_SOCKET_TEXT, (uint8_t *)frame.begin(), frame.length());
+        }
+    }
+}
+
+void SupabaseLocalSocket::disconnect()
+{
+    bool wasConnected;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        wasConnected = connected;
+        connected = false;
+        pendingConnect = false;
+        inbox.clear();
+    }
+    server->detach(this);
+    if (wasConnected && handler)
+    {
+        handler(handlerCtx, SUPABASE_SOCKET_DISCONNECTED, NULL, 0);
+    }
+}
+
+#endif
@@ -0,0 +1,216 @@
+/**
+ * In-process stand-in for a Supabase project, used by the host-native build.
+ *
+ * It answers the subset of `/rest/v1` (PostgREST), `/auth/v1/token` and
+ * `/realtime/v1/websocket` (Phoenix) that this library uses, entirely in
+ * memory. `SupabaseLocalHttp` and `SupabaseLocalSocket` are the transports
+ * the client uses to reach it, so the real library code paths run end to end
+ * without a network.
+ */
+
+#ifndef SupabaseLocalServer_h
+#define SupabaseLocalServer_h
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "../SupabaseTransport.h"
+
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class SupabaseLocalSocket;
+
+typedef std::vector<std::pair<String, String>> SupabaseLocalHeaders;
+
+/** Response of a REST call served by the stand-in */
+struct SupabaseLocalResponse
+{
+    int code = 0;
+    String body;
+    SupabaseLocalHeaders headers;
+};
+
+/** RPC handler: receives the JSON params, returns the JSON result */
+typedef String (*SupabaseLocalRpc)(const String &params);
+
+class SupabaseLocalServer
+{
+public:
+    SupabaseLocalServer();
+
+    /** Server used by the default host transports */
+    static SupabaseLocalServer &instance();
+
+    /** Drop all tables, users, tokens and counters */
+    void reset();
+    /** Add rows (JSON object or array of objects) to `table` without HTTP */
+    void seed(const String &table, const String &json);
+    /** Number of rows currently stored in `table` */
+    size_t rowCount(const String &table);
+    /** Restrict password logins to registered users (any login succeeds otherwise) */
+    void addUser(const String &login, const String &password);
+    void setRpc(const String &name, SupabaseLocalRpc fn);
+    /** Simulated server processing time added to every REST call */
+    void setLatency(unsigned long requestUs);
+    /** Simulated cost of opening a connection: full TCP + TLS handshake,
+     * and a handshake resuming a cached TLS session */
+    void setHandshakeLatency(unsigned long fullUs, unsigned long resumeUs);
+    /** Close keep-alive connections idle for longer than `ms` (0 = never) */
+    void setKeepAliveTimeout(unsigned long ms);
+    /** Invalidate all TLS sessions, e.g. to simulate a server restart */
+    void dropSessions() { sessionEpoch++; }
+    /** Close every realtime socket from the server side */
+    void dropSockets();
+    /** While stalled the realtime side accepts frames but never answers
+     * or pushes anything: a half-dead link */
+    void setRealtimeStalled(bool stalled) { realtimeStalled = stalled; }
+
+    /** Number of REST calls served since the last `reset()` */
+    unsigned long requestCount() const { return requests; }
+    /** `expires_in` of issued access tokens (default 3600 s); REST calls
+     * with an expired token get 401 */
+    void setTokenLifetime(unsigned long seconds) { tokenLifetime = seconds; }
+    /** Number of `grant_type=refresh_token` logins since the last `reset()` */
+    unsigned long refreshCount() const { return refreshes; }
+
+    SupabaseLocalResponse handle(const char *method, const String &url,
+                                 const SupabaseLocalHeaders &headers, const String &body);
+
+    // Realtime side, called by `SupabaseLocalSocket`
+    void attach(SupabaseLocalSocket *socket);
+    void detach(SupabaseLocalSocket *socket);
+    void handleSocketText(SupabaseLocalSocket *socket, const String &text);
+
+private:
+    struct Join
+    {
+        SupabaseLocalSocket *socket;
+        String topic;
+        String event;
+        String table;
+        String filterColumn;
+        String filterValue;
+    };
+    /** A socket on a topic with its broadcast config */
+    struct Member
+    {
+        SupabaseLocalSocket *socket;
+        String topic;
+        bool self;
+        bool ack;
+    };
+
+    std::recursive_mutex lock;
+    JsonDocument db;
+    std::vector<std::pair<String, String>> users;
+    /** Access tokens and when (millis) they expire */
+    std::vector<std::pair<String, unsigned long>> tokens;
+    std::vector<String> refreshTokens;
+    std::vector<std::pair<String, SupabaseLocalRpc>> rpcs;
+    std::vector<SupabaseLocalSocket *> sockets;
+    std::vector<Join> joins;
+    std::vector<Member> members;
+
+    friend class SupabaseLocalHttp;
+    unsigned long latencyUs = 0;
+    unsigned long handshakeUs = 0;
+    unsigned long resumeUs = 0;
+    unsigned long keepAliveMs = 0;
+    bool realtimeStalled = false;
+    unsigned long sessionEpoch = 1;
+    unsigned long requests = 0;
+    long nextId = 1;
+    unsigned long tokenSerial = 0;
+    unsigned long tokenLifetime = 3600;
+    unsigned long refreshes = 0;
+
+    /** `handle()` after the request body was decompressed */
+    SupabaseLocalResponse dispatch(const char *method, const String &url,
+                                   const SupabaseLocalHeaders &headers, const String &body);
+    SupabaseLocalResponse handleAuth(const String &path, const String &query, const String &body);
+    SupabaseLocalResponse handleRpc(const String &name, const String &body);
+    SupabaseLocalResponse handleRest(const char *method, const String &table, const String &query,
+                                     const SupabaseLocalHeaders &headers, const String &body);
+
+    bool authorized(const SupabaseLocalHeaders &headers);
+    JsonArray table(const String &name);
+    void insertRow(const String &table, JsonArray rows, JsonObjectConst row, const String &conflict, JsonArray out);
+    void notify(const String &table, const char *type, JsonObjectConst record, JsonObjectConst oldRecord);
+
+    static String header(const SupabaseLocalHeaders &headers, const char *name);
+    static String urlDecode(const String &s);
+};
+
+/** REST transport that dispatches to a `SupabaseLocalServer` */
+class SupabaseLocalHttp : public SupabaseHttpTransport
+{
+public:
+    SupabaseLocalHttp() : server(&SupabaseLocalServer::instance()) {}
+    explicit SupabaseLocalHttp(SupabaseLocalServer &s) : server(&s) {}
+
+    /** The simulated TLS session: resumed after a restore until
+     * `dropSessions()` */
+    void saveState(SupabaseTransportState &state);
+    void restoreState(const SupabaseTransportState &state);
+
+    bool begin(const String &url);
+    void addHeader(const String &name, const String &value);
+    using SupabaseHttpTransport::sendRequest;
+    int sendRequest(const char *method, const uint8_t *body, size_t size);
+    String getString();
+    String header(const char *name) { return SupabaseLocalServer::header(response.headers, name); }
+    Stream *getStream();
+    void end();
+    void stop();
+
+private:
+    SupabaseLocalServer *server;
+    String url;
+    SupabaseLocalHeaders headers;
+    SupabaseLocalResponse response;
+    SupabaseStringStream body;
+
+    // Simulated keep-alive connection and cached TLS session
+    bool open = false;
+    unsigned long lastUse = 0;
+    unsigned long session = 0;
+
+    void connect();
+};
+
+/** Realtime transport connected to a `SupabaseLocalServer` */
+class SupabaseLocalSocket : public SupabaseSocketTransport
+{
+public:
+    SupabaseLocalSocket() : server(&SupabaseLocalServer::instance()) {}
+    explicit SupabaseLocalSocket(SupabaseLocalServer &s) : server(&s) {}
+    ~SupabaseLocalSocket();
+
+    void begin(const String &host, int port, const String &path);
+    void onEvent(SupabaseSocketHandler handler, void *ctx);
+    bool sendTXT(const String &payload);
+    void loop();
+    void disconnect();
+
+    /** Queue a frame from the server; delivered on the next `loop()` */
+    void push(const String &frame);
+    /** Close from the server side; reported on the next `loop()` */
+    void serverClose();
+
+private:
+    SupabaseLocalServer *server;
+    SupabaseSocketHandler handler = nullptr;
+    void *handlerCtx = nullptr;
+    std::mutex lock;
+    std::deque<String> inbox;
+    bool connected = false;
+    bool pendingConnect = false;
+    bool pendingClose = false;
+};
+
+typedef SupabaseLocalHttp SupabaseDefaultHttp;
+typedef SupabaseLocalSocket SupabaseDefaultSocket;
+
+#endif
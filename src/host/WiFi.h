@@ -0,0 +1,68 @@
+/**
+ * Host-native stand-in for the Arduino `WiFi` object.
+ *
+ * The host is always "connected". `simulateEvent()` lets a test or
+ * benchmark drive the same GOT_IP / DISCONNECTED callbacks the library
+ * receives on the device.
+ */
+
+#ifndef SupabaseHost_WiFi_h
+#define SupabaseHost_WiFi_h
+
+#include <Arduino.h>
+#include <vector>
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum
+{
+    SYSTEM_EVENT_STA_CONNECTED = 4,
+    SYSTEM_EVENT_STA_DISCONNECTED = 5,
+    SYSTEM_EVENT_STA_GOT_IP = 7,
+} WiFiEvent_t;
+
+typedef struct
+{
+    int reason;
+} WiFiEventInfo_t;
+
+typedef std::function<void(WiFiEvent_t event, WiFiEventInfo_t info)> WiFiEventFuncCb;
+
+class HostWiFiClass
+{
+public:
+    wl_status_t status() const { return _status; }
+    void begin(const char *, const char *) { _status = WL_CONNECTED; }
+    int onEvent(WiFiEventFuncCb cb)
+    {
+        _handlers.push_back(cb);
+        return (int)_handlers.size() - 1;
+    }
+
+    /** Change the link status and dispatch the matching event */
+    void simulateEvent(WiFiEvent_t event)
+    {
+        _status = event == SYSTEM_EVENT_STA_DISCONNECTED ? WL_DISCONNECTED : WL_CONNECTED;
+        WiFiEventInfo_t info = {0};
+        for (size_t i = 0; i < _handlers.size(); i++)
+        {
+            _handlers[i](event, info);
+        }
+    }
+
+private:
+    wl_status_t _status = WL_CONNECTED;
+    std::vector<WiFiEventFuncCb> _handlers;
+};
+
+extern HostWiFiClass WiFi;
+
+#endif